@@ -0,0 +1,372 @@
+#include "bot_client.h"
+#include "../game/utils.h"
+#include <SFML/Network/Packet.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Waypoints keep a margin from the edges of the world
+static constexpr float WORLD_MARGIN = 64.f;
+
+static constexpr float PI = 3.14159265f;
+
+static float ToDegrees(float radians)
+{
+    return radians * 180.f / PI;
+}
+
+// Shortest signed difference from one angle to another, in degrees
+static float AngleDelta(float from, float to)
+{
+    float delta = std::fmod(to - from + 540.f, 360.f) - 180.f;
+    return delta < -180.f ? delta + 360.f : delta;
+}
+
+bot_client::bot_client(sf::IpAddress serverIp, unsigned short serverPort, std::string name, uint32_t seed, std::size_t maxPayload)
+    : serverIp(serverIp), serverPort(serverPort), name(std::move(name)), batch(maxPayload), rng(seed)
+{
+    if (socketUDP.bind(sf::Socket::AnyPort) != sf::Socket::Status::Done) {
+        Utils::printMsg("Failed to bind UDP socket for " + this->name, error);
+    }
+    socketUDP.setBlocking(false);
+
+    snapShot.players.reserve(MAX_SNAPSHOT_PLAYERS);
+    snapShot.bullets.reserve(MAX_SNAPSHOT_BULLETS);
+
+    PickWaypoint();
+}
+
+bool bot_client::Connect()
+{
+    socketTCP.setBlocking(true);
+    if (socketTCP.connect(serverIp, serverPort, sf::seconds(10)) != sf::Socket::Status::Done)
+    {
+        Utils::printMsg(name + " failed to connect to server via TCP", error);
+        return false;
+    }
+    socketTCP.setBlocking(false);
+
+    JoinRequestMessage joinMsg;
+    joinMsg.playerName = name;
+    joinMsg.udpPort = socketUDP.getLocalPort();
+
+    sf::Packet packet;
+    WriteMessage(packet, joinMsg);
+
+    if (socketTCP.send(packet) != sf::Socket::Status::Done)
+    {
+        Utils::printMsg(name + " failed to send join request", error);
+        return false;
+    }
+
+    sf::Clock timeout;
+    sf::Packet responsePacket;
+
+    while (timeout.getElapsedTime().asSeconds() < 5.0f)
+    {
+        const sf::Socket::Status status = socketTCP.receive(responsePacket);
+
+        if (status == sf::Socket::Status::Disconnected)
+        {
+            Utils::printMsg(name + ": server disconnected during join", error);
+            return false;
+        }
+
+        uint8_t typeMessage;
+        if (status == sf::Socket::Status::Done && responsePacket >> typeMessage)
+        {
+            if (static_cast<MessageTypeProtocole>(typeMessage) == MessageTypeProtocole::JOIN_ACCEPTED)
+            {
+                JoinAcceptedMessage acceptMsg;
+                if (responsePacket >> acceptMsg)
+                {
+                    playerId = acceptMsg.assignedPlayerId;
+                    isConnected = true;
+                    return true;
+                }
+            }
+            else if (static_cast<MessageTypeProtocole>(typeMessage) == MessageTypeProtocole::JOIN_REJECTED)
+            {
+                JoinRejectedMessage rejectMsg;
+                if (responsePacket >> rejectMsg)
+                {
+                    Utils::printMsg(name + " rejected: " + rejectMsg.message, error);
+                }
+                return false;
+            }
+        }
+
+        sf::sleep(sf::milliseconds(5));
+    }
+
+    Utils::printMsg(name + ": connection timeout - server did not respond", error);
+    return false;
+}
+
+void bot_client::Disconnect()
+{
+    if (!isConnected)
+        return;
+
+    DisconnectMessage msg;
+    msg.playerId = static_cast<uint8_t>(playerId);
+
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, msg);
+    SendDatagram(writer.GetData(), writer.GetSize());
+
+    isConnected = false;
+}
+
+void bot_client::Update(float now, float dt)
+{
+    if (!isConnected)
+        return;
+
+    ReceiveMessagesTCP();
+    ReceiveMessages(now);
+
+    Drive(now, dt);
+
+    if (now >= nextSend)
+    {
+        nextSend = now + SEND_RATE;
+        SendTankUpdate(now);
+    }
+
+    channel.Flush(now, [this](const MessageWriter& message) {
+        batch.Add(message, [this](const std::byte* data, std::size_t size) { SendDatagram(data, size); });
+    });
+
+    batch.Flush([this](const std::byte* data, std::size_t size) {
+        SendDatagram(data, size);
+    });
+
+    stats.Update(now);
+}
+
+void bot_client::TakeRttSamples(std::vector<float>& out)
+{
+    out.insert(out.end(), rttSamples.begin(), rttSamples.end());
+    rttSamples.clear();
+}
+
+void bot_client::SendDatagram(const std::byte* data, std::size_t size)
+{
+    stats.OnSent(size);
+    socketUDP.send(data, size, serverIp, serverPort);
+}
+
+// Obstacles and pickups come over TCP, a bot only needs the size of the world but the
+// socket must be drained
+void bot_client::ReceiveMessagesTCP()
+{
+    sf::Packet packet;
+    sf::Socket::Status status;
+
+    while ((status = socketTCP.receive(packet)) == sf::Socket::Status::Done)
+    {
+        uint8_t typeMessage;
+        if (!(packet >> typeMessage) || static_cast<MessageTypeProtocole>(typeMessage) != MessageTypeProtocole::OBSTACLE_SEED)
+            continue;
+
+        ObstacleSeedMessage msg;
+        if (packet >> msg)
+        {
+            const ChunkLayout chunks(msg.chunkColumns, msg.chunkRows);
+            worldSize = chunks.GetWorldSize();
+            position = chunks.GetSpawnPoint();
+            PickWaypoint();
+        }
+    }
+
+    if (status == sf::Socket::Status::Disconnected)
+    {
+        Utils::printMsg(name + " lost the TCP connection", error);
+        isConnected = false;
+    }
+}
+
+void bot_client::ReceiveMessages(float now)
+{
+    MessageBuffer& buffer = GetReceiveBuffer();
+    std::size_t received = 0;
+    std::optional<sf::IpAddress> sender;
+    unsigned short port;
+
+    while (socketUDP.receive(buffer.data(), buffer.size(), received, sender, port) == sf::Socket::Status::Done)
+    {
+        stats.OnReceived(received);
+
+        UnpackDatagram(buffer.data(), received, [this, now](MessageReader& packet) {
+            ProcessMessageUDP(packet, now);
+        });
+    }
+
+    channel.Deliver([this](MessageReader& message) {
+        ProcessReliableMessage(message);
+    });
+}
+
+void bot_client::ProcessMessageUDP(MessageReader& packet, float now)
+{
+    uint8_t typeMessage;
+    if (!(packet >> typeMessage))
+        return;
+
+    switch (static_cast<MessageTypeProtocole>(typeMessage))
+    {
+        case MessageTypeProtocole::GAME_STATE:
+        {
+            AckHeader header;
+            PingHeader ping;
+            SnapshotPartHeader part;
+            if (packet >> header >> ping >> part >> snapShot)
+            {
+                channel.OnAckHeader(header, now);
+                stats.OnPingHeader(ping, now);
+
+                // Not every header carries an echo, only keep the ones that made a sample
+                if (stats.GetRttSampleCount() != lastRttSampleCount)
+                {
+                    lastRttSampleCount = stats.GetRttSampleCount();
+                    rttSamples.push_back(stats.GetLastRttSample());
+                }
+
+                // A snapshot split in parts counts once
+                if (part.part == 0)
+                    snapshotsReceived++;
+
+                HandleGameSnapShot(snapShot);
+            }
+            break;
+        }
+
+        case MessageTypeProtocole::RELIABLE:
+        {
+            uint16_t sequence;
+            if (packet >> sequence)
+            {
+                channel.OnReceive(sequence, packet.GetRemainingData(), packet.GetRemainingSize());
+            }
+            break;
+        }
+
+        default:
+            // Bullet spawns and the rest only matter to a renderer
+            break;
+    }
+}
+
+void bot_client::ProcessReliableMessage(MessageReader& packet)
+{
+    uint8_t typeMessage;
+    if (!(packet >> typeMessage))
+        return;
+
+    // Only our own respawn changes what the bot does, it starts over from the spawn point
+    if (static_cast<MessageTypeProtocole>(typeMessage) == MessageTypeProtocole::PLAYER_RESPAWNED)
+    {
+        PlayerRespawnedMessage msg;
+        if (packet >> msg && msg.playerId == playerId)
+        {
+            position = {msg.x, msg.y};
+            PickWaypoint();
+        }
+    }
+}
+
+// Aims at the closest other tank of the snapshot and keeps track of our ammo
+void bot_client::HandleGameSnapShot(const GameSnapMessage& msg)
+{
+    float closest = 0.f;
+    hasTarget = false;
+
+    for (const auto& player : msg.players)
+    {
+        if (player.playerId == playerId)
+        {
+            ammo = player.ammo;
+            continue;
+        }
+
+        if (!player.isAlive)
+            continue;
+
+        const float dx = player.x - position.x;
+        const float dy = player.y - position.y;
+        const float distance = dx * dx + dy * dy;
+
+        if (!hasTarget || distance < closest)
+        {
+            hasTarget = true;
+            closest = distance;
+            target = {player.x, player.y};
+        }
+    }
+}
+
+void bot_client::PickWaypoint()
+{
+    std::uniform_real_distribution<float> x(WORLD_MARGIN, worldSize.x - WORLD_MARGIN);
+    std::uniform_real_distribution<float> y(WORLD_MARGIN, worldSize.y - WORLD_MARGIN);
+    waypoint = {x(rng), y(rng)};
+}
+
+void bot_client::Drive(float now, float dt)
+{
+    // Body forward is rotation - 90 like Tank, so turn towards the waypoint and drive
+    const sf::Vector2f toWaypoint = waypoint - position;
+    if (toWaypoint.x * toWaypoint.x + toWaypoint.y * toWaypoint.y < 32.f * 32.f)
+        PickWaypoint();
+
+    const float heading = ToDegrees(std::atan2(toWaypoint.y, toWaypoint.x)) + 90.f;
+    const float turn = std::clamp(AngleDelta(bodyRotation, heading), -TURN_SPEED * dt, TURN_SPEED * dt);
+    bodyRotation = std::fmod(bodyRotation + turn + 360.f, 360.f);
+
+    const float forward = (bodyRotation - 90.f) * PI / 180.f;
+    position.x = std::clamp(position.x + std::cos(forward) * SPEED * dt, 0.f, worldSize.x);
+    position.y = std::clamp(position.y + std::sin(forward) * SPEED * dt, 0.f, worldSize.y);
+
+    // Barrel tip is rotation + 90, swing it round when there is nobody to aim at
+    if (hasTarget)
+        barrelRotation = ToDegrees(std::atan2(target.y - position.y, target.x - position.x)) - 90.f;
+    else
+        barrelRotation = std::fmod(barrelRotation + 45.f * dt, 360.f);
+
+    // The server fires on the press, so a shot is one update with the button down
+    // (SendTankUpdate lets go of it once sent)
+    if (!shootPressed && now >= nextShot)
+    {
+        std::exponential_distribution<float> interval(1.f / FIRE_INTERVAL);
+        nextShot = now + interval(rng);
+
+        if (ammo > 0)
+        {
+            shootPressed = true;
+            shotsFired++;
+        }
+    }
+}
+
+void bot_client::SendTankUpdate(float now)
+{
+    TankMessage msg;
+    msg.playerId = static_cast<uint8_t>(playerId);
+    msg.x = position.x;
+    msg.y = position.y;
+    msg.rotationBody = bodyRotation;
+    msg.rotationBarrel = barrelRotation;
+    msg.shootPressed = shootPressed;
+    msg.isAlive = true;
+
+    MessageWriter writer(GetSendBuffer());
+    writer << static_cast<uint8_t>(TankMessage::ID) << channel.GetAckHeader() << stats.MakePingHeader(now) << msg;
+
+    batch.Add(writer, [this](const std::byte* data, std::size_t size) {
+        SendDatagram(data, size);
+    });
+
+    shootPressed = false;
+}
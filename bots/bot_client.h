@@ -0,0 +1,95 @@
+#pragma once
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../game/protocole_message.h"
+#include "../game/message_stream.h"
+#include "../game/reliable_channel.h"
+#include "../game/message_batch.h"
+#include "../game/snapshot_parts.h"
+#include "../game/link_stats.h"
+#include "../game/world_chunks.h"
+
+// Headless player for load tests. Speaks the same protocol as client_main (TCP join,
+// tank updates with acks and ping headers, reliable channel, snapshot parts) but has no
+// window, no textures and no Game, it drives around the map and shoots on a script
+class bot_client
+{
+    public:
+        bot_client(sf::IpAddress serverIp, unsigned short serverPort, std::string name, uint32_t seed, std::size_t maxPayload);
+
+        // Blocking join, like client_main::Connect without the name prompt
+        bool Connect();
+        void Disconnect();
+
+        // now is seconds since the swarm started, shared by every bot
+        void Update(float now, float dt);
+
+        [[nodiscard]] bool IsConnected() const { return isConnected; }
+        [[nodiscard]] int GetPlayerId() const { return playerId; }
+
+        [[nodiscard]] const LinkStats& GetStats() const { return stats; }
+        [[nodiscard]] uint64_t GetSnapshotsReceived() const { return snapshotsReceived; }
+        [[nodiscard]] uint32_t GetShotsFired() const { return shotsFired; }
+
+        // RTT samples (seconds) taken since the last call, the swarm gathers them for percentiles
+        void TakeRttSamples(std::vector<float>& out);
+
+    private:
+        // Network
+        sf::UdpSocket socketUDP;
+        sf::TcpSocket socketTCP;
+        sf::IpAddress serverIp;
+        unsigned short serverPort;
+        bool isConnected = false;
+
+        std::string name;
+        int playerId = -1;
+
+        ReliableChannel channel;
+        MessageBatch batch;
+        LinkStats stats;
+
+        GameSnapMessage snapShot;
+        uint64_t snapshotsReceived = 0;
+
+        uint32_t lastRttSampleCount = 0;
+        std::vector<float> rttSamples;
+
+        void ReceiveMessages(float now);
+        void ReceiveMessagesTCP();
+        void ProcessMessageUDP(MessageReader& packet, float now);
+        void ProcessReliableMessage(MessageReader& packet);
+        void HandleGameSnapShot(const GameSnapMessage& msg);
+        void SendDatagram(const std::byte* data, std::size_t size);
+
+        // Script: drive towards a random waypoint, aim at the closest tank, fire now and then
+        std::mt19937 rng;
+        sf::Vector2f position = ChunkLayout().GetSpawnPoint();
+        sf::Vector2f worldSize = ChunkLayout().GetWorldSize();   // from ObstacleSeedMessage
+        float bodyRotation = 0.f;
+        float barrelRotation = 0.f;
+        sf::Vector2f waypoint;
+        sf::Vector2f target;
+        bool hasTarget = false;
+        bool shootPressed = false;
+        float nextShot = 0.f;
+        uint8_t ammo = 0;
+        uint32_t shotsFired = 0;
+
+        float nextSend = 0.f;
+
+        void Drive(float now, float dt);
+        void PickWaypoint();
+        void SendTankUpdate(float now);
+
+        const float SEND_RATE = 1.0f / 60.0f;   // same as client_main
+        const float SPEED = 120.f;              // pixels per second
+        const float TURN_SPEED = 180.f;         // degrees per second
+        const float FIRE_INTERVAL = 1.5f;       // average seconds between shots
+};
@@ -0,0 +1,178 @@
+// tank_bots: N headless bot_clients in one process against a running server, for finding
+// how many players a server core holds. Prints throughput every second and RTT
+// percentiles at the end
+//
+//   tank_bots [bots=16] [seconds=60] [joins per second=10]
+//
+// Server address, port and MAX_PAYLOAD come from config.txt like the game. The server
+// only takes MAX_PLAYERS (4 by default), raise it there first
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bot_client.h"
+#include "../game/utils.h"
+#include "../config.h"
+
+// Seconds between two progress lines
+static constexpr float REPORT_INTERVAL = 1.0f;
+
+static int ReadArgument(int argc, char* argv[], int index, int defaultValue)
+{
+    if (index >= argc)
+        return defaultValue;
+
+    try {
+        return std::max(1, std::stoi(argv[index]));
+    }
+    catch (const std::exception&) {
+        Utils::printMsg("Bad argument " + std::string(argv[index]) + ", using " + std::to_string(defaultValue), warning);
+        return defaultValue;
+    }
+}
+
+// Nearest rank on an already sorted list, in milliseconds
+static float Percentile(const std::vector<float>& sorted, float percent)
+{
+    if (sorted.empty())
+        return 0.f;
+
+    const std::size_t rank = static_cast<std::size_t>(percent / 100.f * static_cast<float>(sorted.size() - 1) + 0.5f);
+    return sorted[std::min(rank, sorted.size() - 1)] * 1000.f;
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::SetLevel(Logger::ParseLevel(Config::getLogLevel()));
+
+    const int botCount = ReadArgument(argc, argv, 1, 16);
+    const int duration = ReadArgument(argc, argv, 2, 60);
+    const int joinRate = ReadArgument(argc, argv, 3, 10);
+
+    std::optional<sf::IpAddress> serverIP = sf::IpAddress::resolve(Config::getServerIP());
+    if (!serverIP.has_value()) {
+        Utils::printMsg("Failed to resolve server address " + Config::getServerIP(), error);
+        return 1;
+    }
+
+    const unsigned short serverPort = Config::getServerPort();
+    const std::size_t maxPayload = std::clamp(Config::getMaxPayload(), MIN_PAYLOAD_SIZE, MAX_MESSAGE_SIZE);
+
+    Utils::printMsg("Starting " + std::to_string(botCount) + " bots against " + serverIP->toString() + ":" +
+                    std::to_string(serverPort) + " for " + std::to_string(duration) + " s", success);
+
+    std::vector<std::unique_ptr<bot_client>> bots;
+    bots.reserve(botCount);
+
+    std::vector<float> rttSamples;
+    int joinFailures = 0;
+
+    sf::Clock clock;
+    float lastFrame = 0.f;
+    float nextJoin = 0.f;
+    float nextReport = REPORT_INTERVAL;
+
+    uint64_t reportBytesIn = 0;
+    uint64_t reportBytesOut = 0;
+    uint64_t reportSnapshots = 0;
+
+    while (true)
+    {
+        const float now = clock.getElapsedTime().asSeconds();
+        const float dt = now - lastFrame;
+        lastFrame = now;
+
+        if (now >= static_cast<float>(duration))
+            break;
+
+        // Ramp up, joining is blocking so do a few at a time and let the others keep playing
+        if (static_cast<int>(bots.size()) < botCount && now >= nextJoin)
+        {
+            nextJoin = now + 1.f / static_cast<float>(joinRate);
+
+            const int index = static_cast<int>(bots.size());
+            auto bot = std::make_unique<bot_client>(*serverIP, serverPort, "bot_" + std::to_string(index),
+                                                    static_cast<uint32_t>(index + 1), maxPayload);
+            if (!bot->Connect())
+                joinFailures++;
+
+            bots.push_back(std::move(bot));
+        }
+
+        for (auto& bot : bots)
+        {
+            bot->Update(now, dt);
+        }
+
+        if (now >= nextReport)
+        {
+            nextReport += REPORT_INTERVAL;
+
+            int connected = 0;
+            uint64_t bytesIn = 0;
+            uint64_t bytesOut = 0;
+            uint64_t snapshots = 0;
+
+            for (auto& bot : bots)
+            {
+                connected += bot->IsConnected() ? 1 : 0;
+                bytesIn += bot->GetStats().GetTotalBytesIn();
+                bytesOut += bot->GetStats().GetTotalBytesOut();
+                snapshots += bot->GetSnapshotsReceived();
+                bot->TakeRttSamples(rttSamples);
+            }
+
+            const float perBot = connected > 0 ? static_cast<float>(snapshots - reportSnapshots) / connected / REPORT_INTERVAL : 0.f;
+            Utils::printMsg(std::to_string(connected) + " bots | in " +
+                            std::to_string((bytesIn - reportBytesIn) / 1024) + " KB/s | out " +
+                            std::to_string((bytesOut - reportBytesOut) / 1024) + " KB/s | " +
+                            std::to_string(perBot) + " snapshots/s per bot", info);
+
+            reportBytesIn = bytesIn;
+            reportBytesOut = bytesOut;
+            reportSnapshots = snapshots;
+        }
+
+        sf::sleep(sf::milliseconds(1));
+    }
+
+    // Leave properly so the server frees the slots right away instead of timing them out
+    uint64_t totalIn = 0;
+    uint64_t totalOut = 0;
+    uint64_t totalSnapshots = 0;
+    uint64_t totalShots = 0;
+    int connected = 0;
+
+    for (auto& bot : bots)
+    {
+        connected += bot->IsConnected() ? 1 : 0;
+        totalIn += bot->GetStats().GetTotalBytesIn();
+        totalOut += bot->GetStats().GetTotalBytesOut();
+        totalSnapshots += bot->GetSnapshotsReceived();
+        totalShots += bot->GetShotsFired();
+        bot->TakeRttSamples(rttSamples);
+        bot->Disconnect();
+    }
+
+    std::sort(rttSamples.begin(), rttSamples.end());
+
+    const float elapsed = std::max(lastFrame, 0.001f);
+
+    Logger::Flush();
+    std::cout << "\n------- tank_bots results -------\n"
+              << "Bots: " << bots.size() << " started, " << connected << " connected at the end, "
+              << joinFailures << " failed to join\n"
+              << "RTT (ms, " << rttSamples.size() << " samples): p50 " << Percentile(rttSamples, 50.f)
+              << "  p90 " << Percentile(rttSamples, 90.f) << "  p99 " << Percentile(rttSamples, 99.f)
+              << "  max " << Percentile(rttSamples, 100.f) << "\n"
+              << "Received: " << totalIn / 1024 << " KB (" << totalIn / 1024 / elapsed << " KB/s), "
+              << totalSnapshots << " snapshots (" << totalSnapshots / elapsed << "/s)\n"
+              << "Sent: " << totalOut / 1024 << " KB (" << totalOut / 1024 / elapsed << " KB/s), "
+              << totalShots << " shots\n";
+
+    return 0;
+}
@@ -4,14 +4,30 @@
 
 #include "client_main.h"
 #include "../game/utils.h"
+#include "../config.h"
+#include "../game/profiler.h"
+#include <iostream>
 
 client_main::client_main(sf::IpAddress serverIp, unsigned short serverPort)
-    : serverIp(serverIp), serverPort(serverPort), isConnected(false), playerId(-1)
+    : serverIp(serverIp), serverPort(serverPort), isConnected(false),
+      batch(std::clamp(Config::getMaxPayload(), MIN_PAYLOAD_SIZE, MAX_MESSAGE_SIZE)),
+      emulator(Config::getNetworkConditions()), playerId(-1)
 {
     if (socketUDP.bind(sf::Socket::AnyPort) != sf::Socket::Status::Done) {
         Utils::printMsg("Failed to bind UDP socket", error);
     }
     socketUDP.setBlocking(false);
+
+    if (emulator.IsEnabled()) {
+        const NetworkConditions& conditions = emulator.GetConditions();
+        Utils::printMsg("Emulating network: " + std::to_string(conditions.delay * 1000.f) + " ms delay, " +
+                        std::to_string(conditions.jitter * 1000.f) + " ms jitter, " +
+                        std::to_string(conditions.loss * 100.f) + "% loss", warning);
+    }
+
+    // Biggest snapshot the schema allows, so decoding never has to grow
+    snapShot.players.reserve(MAX_SNAPSHOT_PLAYERS);
+    snapShot.bullets.reserve(MAX_SNAPSHOT_BULLETS);
 }
 
 bool client_main::Connect()
@@ -36,11 +52,16 @@ bool client_main::Connect()
     JoinRequestMessage joinMsg;
     joinMsg.udpPort = socketUDP.getLocalPort();
 
+    Logger::Flush();
     std::cout << "Enter player name: ";
     std::getline(std::cin, joinMsg.playerName);
 
+    // Server rejects anything longer
+    if (joinMsg.playerName.size() > MAX_NAME_LENGTH)
+        joinMsg.playerName.resize(MAX_NAME_LENGTH);
+
     sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::JOIN_REQUEST) << joinMsg;
+    WriteMessage(packet, joinMsg);
 
     if (socketTCP.send(packet) != sf::Socket::Status::Done)
     {
@@ -54,12 +75,21 @@ bool client_main::Connect()
     // I could a logic for trying multiple times to join but dint have time
     sf::Clock timeout;
 
+    // With the emulator on, the answer is held for a round trip so the timeout can be hit
+    const float responseDelay = emulator.IsEnabled() ? emulator.SampleDelay() + emulator.SampleDelay() : 0.f;
+    sf::Packet responsePacket;
+    bool hasResponse = false;
+
     while (timeout.getElapsedTime().asSeconds() < 5.0f)
     {
-        sf::Packet responsePacket;
-        sf::Socket::Status receiveStatus = socketTCP.receive(responsePacket);
+        sf::Socket::Status receiveStatus = sf::Socket::Status::NotReady;
+        if (!hasResponse)
+        {
+            receiveStatus = socketTCP.receive(responsePacket);
+            hasResponse = receiveStatus == sf::Socket::Status::Done;
+        }
 
-        if (receiveStatus == sf::Socket::Status::Done)
+        if (hasResponse && timeout.getElapsedTime().asSeconds() >= responseDelay)
         {
             uint8_t typeMessage;
             if (responsePacket >> typeMessage)
@@ -104,9 +134,14 @@ void client_main::Disconnect()
     if (!isConnected)
         return;
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::DISCONNECT) << playerId;
-    socketUDP.send(packet, serverIp, serverPort);
+    DisconnectMessage msg;
+    msg.playerId = playerId;
+
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, msg);
+
+    // Straight to the socket, the window closes right after so the emulator would never let it out
+    socketUDP.send(writer.GetData(), writer.GetSize(), serverIp, serverPort);
 
     isConnected = false;
     Utils::printMsg("Disconnected from server", warning);
@@ -114,9 +149,68 @@ void client_main::Disconnect()
 
 void client_main::Update()
 {
+    PROFILE_ZONE("client_main::Update");
+
     ReceiveMessages();
     ReceiveMessagesTCP();
     SendPosition();
+    FlushReliable();
+    FlushBatch();
+
+    stats.Update(netClock.getElapsedTime().asSeconds());
+}
+
+void client_main::FlushReliable()
+{
+    if (!isConnected)
+        return;
+
+    channel.Flush(netClock.getElapsedTime().asSeconds(), [this](const MessageWriter& message) {
+        SendBatched(message);
+    });
+}
+
+void client_main::SendBatched(const MessageWriter& message)
+{
+    batch.Add(message, [this](const std::byte* data, std::size_t size) {
+        SendDatagram(data, size);
+    });
+}
+
+void client_main::FlushBatch()
+{
+    batch.Flush([this](const std::byte* data, std::size_t size) {
+        SendDatagram(data, size);
+    });
+
+    ReleaseEmulated();
+}
+
+void client_main::SendDatagram(const std::byte* data, std::size_t size)
+{
+    stats.OnSent(size);
+
+    if (emulator.IsEnabled())
+    {
+        emulator.Queue(data, size, serverIp, serverPort);
+        return;
+    }
+
+    if (socketUDP.send(data, size, serverIp, serverPort) != sf::Socket::Status::Done)
+    {
+        PRINT_MSG("UDP SEND FAILED", error);
+    }
+}
+
+// Lets out what the emulator held long enough, called every frame
+void client_main::ReleaseEmulated()
+{
+    emulator.Release([this](const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) {
+        if (socketUDP.send(data, size, address, port) != sf::Socket::Status::Done)
+        {
+            PRINT_MSG("UDP SEND FAILED", error);
+        }
+    });
 }
 
 void client_main::SendPosition()
@@ -131,13 +225,12 @@ void client_main::SendPosition()
 
     TankMessage msg = TankPositionMessage();
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::TANK_UPDATE) << msg;
+    // Acks for the server events ride along with every position update
+    MessageWriter writer(GetSendBuffer());
+    writer << static_cast<uint8_t>(TankMessage::ID) << channel.GetAckHeader()
+           << stats.MakePingHeader(netClock.getElapsedTime().asSeconds()) << msg;
 
-    if (socketUDP.send(packet, serverIp, serverPort) != sf::Socket::Status::Done)
-    {
-        Utils::printMsg("UDP SEND FAILED", error);
-    }
+    SendBatched(writer);
 }
 
 void client_main::ReceiveMessagesTCP()
@@ -157,42 +250,61 @@ void client_main::ReceiveMessagesTCP()
 
         switch (msg)
         {
-            case MessageTypeProtocole::PLAYER_JOINED:
+            case MessageTypeProtocole::OBSTACLE_SEED:
                     {
-                        PlayerJoinedMessage msg;
+                        ObstacleSeedMessage msg;
                         if (packet >> msg)
                         {
-                            HandlePlayerJoined(msg);
+                            HandleObstacles(msg);
                         }
                         break;
                     }
 
-            case MessageTypeProtocole::PLAYER_LEFT:
+            case MessageTypeProtocole::PickUP_DATA:
                     {
-                        PlayerLeftMessage msg;
+                        PickUpMessage msg;
                         if (packet >> msg)
                         {
-                            HandlePlayerLeft(msg);
+                            HandlePickUpData(msg);
                         }
                         break;
                     }
 
-            case MessageTypeProtocole::OBSTACLE_SEED:
+            default:
+                PRINT_MSGF(warning, "Unknown message type: %d", typeMessage);
+                break;
+
+        }
+    }
+}
+
+// Game events sent through the reliable channel, already in the order the server sent them
+void client_main::ProcessReliableMessage(MessageReader& packet)
+{
+    uint8_t typeMessage;
+    if (!(packet >> typeMessage))
+        return;
+
+    MessageTypeProtocole msg = static_cast<MessageTypeProtocole>(typeMessage);
+
+    switch (msg)
+    {
+            case MessageTypeProtocole::PLAYER_JOINED:
                     {
-                        ObstacleSeedMessage msg;
+                        PlayerJoinedMessage msg;
                         if (packet >> msg)
                         {
-                            HandleObstacles(msg);
+                            HandlePlayerJoined(msg);
                         }
                         break;
                     }
 
-            case MessageTypeProtocole::PickUP_DATA:
+            case MessageTypeProtocole::PLAYER_LEFT:
                     {
-                        PickUpMessage msg;
+                        PlayerLeftMessage msg;
                         if (packet >> msg)
                         {
-                            HandlePickUpData(msg);
+                            HandlePlayerLeft(msg);
                         }
                         break;
                     }
@@ -229,10 +341,8 @@ void client_main::ReceiveMessagesTCP()
                     }
 
             default:
-                Utils::printMsg("Unknown message type: " + std::to_string(typeMessage), warning);
+                PRINT_MSGF(warning, "Unknown reliable message type: %d", typeMessage);
                 break;
-
-        }
     }
 }
 
@@ -241,44 +351,85 @@ void client_main::ReceiveMessages()
     if (!isConnected)
         return;
 
-    sf::Packet packet;
+    MessageBuffer& buffer = GetReceiveBuffer();
+    std::size_t received = 0;
     std::optional<sf::IpAddress> sender;
     unsigned short port;
 
-    while (socketUDP.receive(packet, sender, port) == sf::Socket::Status::Done)
+    while (socketUDP.receive(buffer.data(), buffer.size(), received, sender, port) == sf::Socket::Status::Done)
     {
-        uint8_t typeMessage;
-        if (!(packet >> typeMessage))
-            continue;
+        stats.OnReceived(received);
 
-        MessageTypeProtocole msg = static_cast<MessageTypeProtocole>(typeMessage);
+        // The server packs everything of a tick in as few datagrams as it can
+        UnpackDatagram(buffer.data(), received, [this](MessageReader& packet) {
+            ProcessMessageUDP(packet);
+        });
+    }
 
-        switch (msg)
+    channel.Deliver([this](MessageReader& message) {
+        ProcessReliableMessage(message);
+    });
+}
+
+void client_main::ProcessMessageUDP(MessageReader& packet)
+{
+    uint8_t typeMessage;
+    if (!(packet >> typeMessage))
+        return;
+
+    MessageTypeProtocole msg = static_cast<MessageTypeProtocole>(typeMessage);
+
+    switch (msg)
+    {
+        case MessageTypeProtocole::GAME_STATE:
         {
-            case MessageTypeProtocole::GAME_STATE:
+            AckHeader header;
+            PingHeader ping;
+            SnapshotPartHeader part;
+            if (packet >> header >> ping >> part >> snapShot)
             {
-                GameSnapMessage msg;
-                if (packet >> msg)
+                const float now = netClock.getElapsedTime().asSeconds();
+                channel.OnAckHeader(header, now);
+                stats.OnPingHeader(ping, now);
+
+                // Every part is complete on its own, only parts of an older snapshot are skipped
+                if (!hasSnapshot || SequenceLessEqual(latestSnapshotId, part.snapshotId))
                 {
-                    HandleGameSnapShot(msg);
+                    // A snapshot split in parts arrives once, on its first part
+                    if (!hasSnapshot || part.snapshotId != latestSnapshotId)
+                        GetPerfCounters().OnSnapshot(part.stateHash);
+
+                    hasSnapshot = true;
+                    latestSnapshotId = part.snapshotId;
+                    HandleGameSnapShot(snapShot);
                 }
-                break;
             }
+            break;
+        }
 
-            case MessageTypeProtocole::BULLET_SPAWNED:
+        case MessageTypeProtocole::RELIABLE:
+        {
+            uint16_t sequence;
+            if (packet >> sequence)
             {
-                BulletSpawnedMessage msg;
-                if (packet >> msg)
-                {
-                    HandleBulletSpawned(msg);
-                }
-                break;
+                channel.OnReceive(sequence, packet.GetRemainingData(), packet.GetRemainingSize());
             }
+            break;
+        }
 
-            default:
-                Utils::printMsg("Unknown message type: " + std::to_string(typeMessage), warning);
-                break;
+        case MessageTypeProtocole::BULLET_SPAWNED:
+        {
+            BulletSpawnedMessage msg;
+            if (packet >> msg)
+            {
+                HandleBulletSpawned(msg);
+            }
+            break;
         }
+
+        default:
+            PRINT_MSGF(warning, "Unknown message type: %d", typeMessage);
+            break;
     }
 }
 
@@ -288,18 +439,17 @@ void client_main::HandleJoinAccepted(JoinAcceptedMessage msg)
     playerColour = msg.tankColor;
     isConnected = true;
 
-    game = std::make_unique<Game>(playerId);
+    game = std::make_unique<Game>(playerId, JobSystem::WorkersFor(Config::getJobThreads()));
     game->AddTank(playerId, playerColour);
 
-    game->OnPickupCollected = [this](uint8_t pickupId, uint8_t pickupType) {
-        SendPickupHit(pickupId, pickupType);
-    };
+    game->AddHudWidget(std::make_unique<hudNetStats>(game->GetUIFont(), stats));
+    game->SetPerfOverlay(std::make_unique<hudPerfOverlay>(game->GetUIFont(), stats));
 
     Utils::printMsg("Connected Player ID: " + std::to_string(playerId) +
                    " Color: " + playerColour, success);
 }
 
-void client_main::HandleGameSnapShot(GameSnapMessage msg)
+void client_main::HandleGameSnapShot(const GameSnapMessage& msg)
 {
     for (const auto& playerState : msg.players)
     {
@@ -308,7 +458,7 @@ void client_main::HandleGameSnapShot(GameSnapMessage msg)
             continue;
 
         // Add tank if missing
-        if (game->tanks.find(playerState.playerId) == game->tanks.end())
+        if (!game->FindTank(playerState.playerId))
         {
             game->AddTank(playerState.playerId, playerState.color);
         }
@@ -320,7 +470,7 @@ void client_main::HandleGameSnapShot(GameSnapMessage msg)
 
 void client_main::HandlePlayerDied(PlayerDiedMessage msg)
 {
-    Utils::printMsg("Player with id: " + std::to_string(msg.victimId) + " died", info);
+    PRINT_MSGF(info, "Player with id: %d died", msg.victimId);
 }
 
 void client_main::HandlePlayerJoined(PlayerJoinedMessage msg)
@@ -337,11 +487,9 @@ void client_main::HandlePlayerLeft(PlayerLeftMessage msg)
     if (!game)
         return;
 
-    auto  missingTank = game->tanks.find(msg.playerId);
-    if (missingTank != game->tanks.end())
+    if (game->players.Remove(msg.playerId))
     {
-        game->tanks.erase(missingTank);
-        Utils::printMsg("Player " + std::to_string(msg.playerId) + " left", warning);
+        PRINT_MSGF(warning, "Player %d left", msg.playerId);
     }
 }
 
@@ -355,16 +503,13 @@ void client_main::HandleBulletSpawned(BulletSpawnedMessage msg)
     sf::Angle bulletRotation = sf::degrees(msg.rotation);
 
     // Find the owner tank
-    auto tankShooter = game->tanks.find(msg.ownerId);
-    if (tankShooter != game->tanks.end())
+    if (Tank* tankShooter = game->FindTank(msg.ownerId))
     {
-        // Add bullet to the tank's bullet list
-        tankShooter->second->bullets.push_back(
-            std::make_unique<bullet>(bulletPos, bulletRotation, 400.f)
-        );
+        // Add bullet to the tank's bullet list, reusing a spent one when there is one
+        tankShooter->FireBullet(bulletPos, bulletRotation, BULLET_SPEED);
 
 
-        tankShooter->second->DecreaseAmmo(1);
+        tankShooter->DecreaseAmmo(1);
     }
 }
 
@@ -373,17 +518,21 @@ TankMessage client_main::TankPositionMessage()
     if (!game || playerId == -1)
         return {};
 
+    const Tank* tank = game->FindTank(playerId);
+    if (!tank)
+        return {};
+
     TankMessage msg;
 
     msg.playerId = playerId;
-    msg.x = game->tanks[playerId]->position.x;
-    msg.y = game->tanks[playerId]->position.y;
-    msg.rotationBody = game->tanks[playerId]->bodyRotation.asDegrees();
-    msg.rotationBarrel = game->tanks[playerId]->barrelRotation.asDegrees();
+    msg.x = tank->position.x;
+    msg.y = tank->position.y;
+    msg.rotationBody = tank->bodyRotation.asDegrees();
+    msg.rotationBarrel = tank->barrelRotation.asDegrees();
 
-    msg.shootPressed = game->tanks[playerId]->wantsToShoot;
+    msg.shootPressed = tank->wantsToShoot;
 
-    msg.isAlive = game->tanks[playerId]->IsAlive();
+    msg.isAlive = tank->IsAlive();
 
     return msg;
 }
@@ -395,57 +544,33 @@ void client_main::HandleObstacles(ObstacleSeedMessage msg)
 
     Utils::printMsg("Obs data received", debug);
 
-    int numRocks = 10;
-    int minSize = 3;
-    int maxSize = 6;
-
-    // SEED sent by the server for optimization, instead of the server creating the entire world
-
-    std::mt19937 gen(msg.seed);
-    std::uniform_real_distribution<float> posX(0.f, 800.f);
-    std::uniform_real_distribution<float> posY(0.f, 600);
-    std::uniform_int_distribution<int> sizeDist(minSize, maxSize);
-
-    sf::Vector2f spawnPoint(640.f, 480.f);
-
-    // This variable is to keep clear the center since that is the spawn point, that way I avoid collision issues
-    float spawnDistance = 100.f;
-
-    for (int i = 0; i < numRocks; i++)
+    // SEED sent by the server for optimization, instead of the server creating the entire world.
+    // The server builds the same rocks from it, see world_gen.h, and the chunks stream in around the camera
+    if (msg.mapName.empty())
     {
-        sf::Vector2f pos;
-        bool validPosition = false;
-
-        while (!validPosition)
-        {
-            pos = {posX(gen),posY(gen)};
-
-            float dist = std::sqrt(
-                std::pow(pos.x - spawnPoint.x, 2) + std::pow(pos.y - spawnPoint.y, 2)
-                );
-
-            if (dist > spawnDistance)
-            {
-                validPosition = true;
-            }
-        }
-
-        int size = sizeDist(gen);
-        sf::Vector2f scale(size, size);
-
-        auto rock = std::make_unique<obstacle>(
-            "../Assets/Rock.png",
-            pos,
-            sf::Vector2f(0,0),
-            sf::Vector2f(0,0),
-            scale);
+        game->SetWorld(msg.seed, ChunkLayout(msg.chunkColumns, msg.chunkRows));
+        return;
+    }
 
-        // Add it to the collision manager
-        game->collisionManager.AddStaticCollider(rock->GetBounds());
+    // A handcrafted map, the server only sends its name. Never anything with a folder in it
+    std::unique_ptr<MapFile> map;
+    if (msg.mapName.find_first_of("/\\") == std::string::npos && msg.mapName.find("..") == std::string::npos)
+    {
+        map = MapFile::Open(Config::getMapFolder() + "/" + msg.mapName);
+    }
 
-        game->obstacles.push_back(std::move(rock));
+    if (map && map->GetHeader().checksum != msg.mapChecksum)
+    {
+        Utils::printMsg("Map " + msg.mapName + " is not the same as the server's", error);
+        map.reset();
+    }
 
+    if (!map)
+    {
+        Utils::printMsg("Playing without map " + msg.mapName + ", walls will not match the server", error);
     }
+
+    game->SetWorld(msg.seed, ChunkLayout(msg.chunkColumns, msg.chunkRows), std::move(map));
 }
 
 
@@ -454,15 +579,13 @@ void client_main::HandlePlayerRespawned(PlayerRespawnedMessage msg)
     if (!game)
         return;
 
-    auto tank = game->tanks.find(msg.playerId);
-    if (tank != game->tanks.end())
+    if (Tank* tank = game->FindTank(msg.playerId))
     {
-        // Retorn tank to spaen pos
-        tank->second->position = {msg.x, msg.y};
+        // Retorn tank to spaen pos, the sprites too so the bounds are right before its next Update
+        tank->SetPose({msg.x, msg.y}, tank->bodyRotation, tank->barrelRotation);
 
-        // Clear bullets
-        tank->second->bullets.clear();
-        tank->second->Reset();
+        // Clears the bullets too
+        tank->Reset();
     }
 }
 
@@ -476,28 +599,14 @@ void client_main::HandlePickUpData(PickUpMessage& msg)
     game->CreatePickups(msg);
 }
 
-void client_main::SendPickupHit(uint8_t pickupId, uint8_t pickupType)
-{
-    if (!isConnected)
-        return;
-
-
-    PickUpHitMessage hitMsg;
-    hitMsg.playerId = playerId;
-    hitMsg.pickUpId = pickupId;
-    hitMsg.pickUpType = pickupType;
-
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::PickUP_HIT) << hitMsg;
-
-    socketUDP.send(packet, serverIp, serverPort);
-}
-
 void client_main::HandlePickUpUpdated(PickUpUpdatedMessage& msg)
 {
     if (!game)
         return;
 
+    // The server already gave it to this tank, the same amount is added here so the HUD agrees
+    Tank* collector = msg.collectorId != NO_COLLECTOR ? game->FindTank(msg.collectorId) : nullptr;
+
     // Find the pickup by its stored ID
     if (msg.pickUpType == 0)
     {
@@ -506,10 +615,12 @@ void client_main::HandlePickUpUpdated(PickUpUpdatedMessage& msg)
         {
             if (ammoBox->GetPickupId() == msg.pickUpId)
             {
+                if (collector)
+                    collector->AddAmmo(ammoBox->GetAmmoAmount());
+
                 ammoBox->SetPosition({msg.x, msg.y});
                 ammoBox->SetActive(true);
-                Utils::printMsg("AmmoBox repositioned to: " + std::to_string(msg.x) +
-                               "," + std::to_string(msg.y), success);
+                PRINT_MSGF(success, "AmmoBox repositioned to: %f,%f", msg.x, msg.y);
                 break;
             }
         }
@@ -521,12 +632,17 @@ void client_main::HandlePickUpUpdated(PickUpUpdatedMessage& msg)
         {
             if (healthKit->GetPickupId() == msg.pickUpId)
             {
+                if (collector)
+                    collector->AddHealth(healthKit->GetHealAmount());
+
                 healthKit->SetPosition({msg.x, msg.y});
                 healthKit->SetActive(true);
-                Utils::printMsg("HealthKit repositioned to: " + std::to_string(msg.x) +
-                               "," + std::to_string(msg.y), success);
+                PRINT_MSGF(success, "HealthKit repositioned to: %f,%f", msg.x, msg.y);
                 break;
             }
         }
     }
+
+    // It may have moved to another chunk
+    game->UpdatePickupChunks();
 }
\ No newline at end of file
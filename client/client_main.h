@@ -10,6 +10,12 @@
 #include <SFML/Network/UdpSocket.hpp>
 
 #include "../game/protocole_message.h"
+#include "../game/message_stream.h"
+#include "../game/reliable_channel.h"
+#include "../game/message_batch.h"
+#include "../game/snapshot_parts.h"
+#include "../game/network_emulator.h"
+#include "../game/link_stats.h"
 #include "../game/game.h"
 
 class client_main
@@ -28,8 +34,6 @@ class client_main
         [[nodiscard]] int GetPlayerId() const { return playerId; }
 
 
-        void SendPickupHit(uint8_t pickupId, uint8_t pickupType);
-
         // Game state
         std::unique_ptr<Game> game;
 
@@ -43,6 +47,26 @@ class client_main
 
         void ReceiveMessages();
         void ReceiveMessagesTCP();
+        void ProcessMessageUDP(MessageReader& packet);
+        void ProcessReliableMessage(MessageReader& packet);
+
+        // Game events to and from the server, TCP is only used to join
+        ReliableChannel channel;
+        sf::Clock netClock;
+        void FlushReliable();
+
+        // Tank update and reliable messages of a frame leave in one datagram
+        MessageBatch batch;
+        void SendBatched(const MessageWriter& message);
+        void FlushBatch();
+
+        // RTT, loss and bandwidth to the server, shown on the HUD
+        LinkStats stats;
+
+        // Every UDP send goes through here, and through the emulator when it is on
+        NetworkEmulator emulator;
+        void SendDatagram(const std::byte* data, std::size_t size);
+        void ReleaseEmulated();
 
         // Input Logic
         void SendPosition();
@@ -54,7 +78,7 @@ class client_main
         void HandlePickUpUpdated(PickUpUpdatedMessage& msg);
 
         void HandleJoinAccepted(JoinAcceptedMessage msg);
-        void HandleGameSnapShot(GameSnapMessage msg);
+        void HandleGameSnapShot(const GameSnapMessage& msg);
         void HandlePlayerJoined(PlayerJoinedMessage msg);
         void HandlePlayerLeft(PlayerLeftMessage msg);
         void HandleBulletSpawned(BulletSpawnedMessage msg);
@@ -63,6 +87,13 @@ class client_main
         int playerId;
         std::string playerColour;
 
+        // Reused for every snapshot received so decoding does not allocate
+        GameSnapMessage snapShot;
+
+        // Newest snapshot we applied a part of, parts of older ones are stale
+        bool hasSnapshot = false;
+        uint16_t latestSnapshotId = 0;
+
         // Timing
         sf::Clock clock;
         const float SEND_RATE = 1.0f / 60.0f;  // 60 updates per second
@@ -2,6 +2,7 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include "game/network_emulator.h"
 
 class Config {
 public:
@@ -14,6 +15,93 @@ public:
         return static_cast<unsigned short>(std::stoi(port));
     }
 
+    // Biggest UDP payload we send, keep it under the path MTU to avoid IP fragmentation
+    static std::size_t getMaxPayload() {
+        const std::string payload = readValue("MAX_PAYLOAD", "1200");
+        return static_cast<std::size_t>(std::stoul(payload));
+    }
+
+    // Joins past this are rejected, raise it for load tests with tank_bots
+    static std::size_t getMaxPlayers() {
+        return static_cast<std::size_t>(std::stoul(readValue("MAX_PLAYERS", "4")));
+    }
+
+    // Tanks the server drives itself, for quiet hours and load tests
+    static std::size_t getServerBots() {
+        return static_cast<std::size_t>(std::stoul(readValue("SERVER_BOTS", "0")));
+    }
+
+    // Server: bots and bullets move in fixed point (fixed_math.h) and every tick hashes its state
+    static bool getDeterministicSim() {
+        return readValue("DETERMINISTIC_SIM", "0") == "1";
+    }
+
+    // Worker threads for the entity loops of the server and client, -1 is one less than the cores
+    // and 0 keeps everything on the main thread
+    static int getJobThreads() {
+        return std::stoi(readValue("JOB_THREADS", "-1"));
+    }
+
+    // World size in 320 px chunks, the server sends it to every client. 4 x 3 is the original map
+    static int getWorldChunksX() {
+        return std::stoi(readValue("WORLD_CHUNKS_X", "4"));
+    }
+
+    static int getWorldChunksY() {
+        return std::stoi(readValue("WORLD_CHUNKS_Y", "3"));
+    }
+
+    // Server: a .tmap made by tank_map_convert, empty for a generated world
+    static std::string getMapFile() {
+        return readValue("MAP_FILE", "");
+    }
+
+    // Client: where maps named by the server are looked for
+    static std::string getMapFolder() {
+        return readValue("MAP_FOLDER", "maps");
+    }
+
+    // Lowest level printed: debug, info, success, warning or error
+    static std::string getLogLevel() {
+        return readValue("LOG_LEVEL", "debug");
+    }
+
+    // Prometheus metrics on 127.0.0.1:<port>/metrics, 0 turns it off
+    static unsigned short getMetricsPort() {
+        return static_cast<unsigned short>(std::stoi(readValue("METRICS_PORT", "0")));
+    }
+
+    // Prometheus metrics rewritten to this file every METRICS_INTERVAL seconds, empty turns it off
+    static std::string getMetricsFile() {
+        return readValue("METRICS_FILE", "");
+    }
+
+    static float getMetricsInterval() {
+        return std::stof(readValue("METRICS_INTERVAL", "5"));
+    }
+
+    // TANK_ALLOC_TRACKING builds abort when a tick or frame allocates after the warm-up (1 to turn on)
+    static bool getAllocStrict() {
+        return readValue("ALLOC_STRICT", "0") == "1";
+    }
+
+    // Server records every inbound message here when set, replay it with option [3] or --replay
+    static std::string getCaptureFile() {
+        return readValue("CAPTURE_FILE", "");
+    }
+
+    // Emulated bad network on outgoing UDP, all off by default
+    static NetworkConditions getNetworkConditions() {
+        NetworkConditions conditions;
+        conditions.delay = std::stof(readValue("NET_DELAY_MS", "0")) / 1000.f;
+        conditions.jitter = std::stof(readValue("NET_JITTER_MS", "0")) / 1000.f;
+        conditions.loss = std::stof(readValue("NET_LOSS_PERCENT", "0")) / 100.f;
+        conditions.duplicate = std::stof(readValue("NET_DUPLICATE_PERCENT", "0")) / 100.f;
+        conditions.reorder = std::stof(readValue("NET_REORDER_PERCENT", "0")) / 100.f;
+        conditions.seed = static_cast<uint32_t>(std::stoul(readValue("NET_SEED", "1")));
+        return conditions;
+    }
+
 private:
     static std::string readValue(const std::string& key, const std::string& defaultValue) {
         std::ifstream config("config.txt");
@@ -3,10 +3,9 @@
 //
 #include "tank.h"
 
-#include "ammoBox.h"
 #include "utils.h"
 #include "collision_manager.h"
-#include "healthKit.h"
+#include "perf_counters.h"
 
 Tank::Tank(std::string colour)
 {
@@ -40,6 +39,15 @@ Tank::Tank(std::string colour)
 
 	body.setRotation(bodyRotation);
 	barrel.setRotation(barrelRotation);
+
+	// A full magazine of spent bullets, so the first shots after joining reuse them instead of
+	// allocating in the middle of a frame
+	bullets.reserve(MAX_AMMO);
+	for (int i = 0; i < MAX_AMMO; i++)
+	{
+		bullets.push_back(std::make_unique<bullet>(position, barrelRotation));
+		bullets.back()->Deactivate();
+	}
 }
 
 void Tank::Update(const float dt, const CollisionManager& collisionManager)
@@ -95,6 +103,18 @@ sf::FloatRect Tank::GetBounds() const
 	return body.getGlobalBounds();
 }
 
+void Tank::SetPose(sf::Vector2f newPosition, sf::Angle newBodyRotation, sf::Angle newBarrelRotation)
+{
+	position = newPosition;
+	bodyRotation = newBodyRotation;
+	barrelRotation = newBarrelRotation;
+
+	body.setRotation(bodyRotation);
+	barrel.setRotation(barrelRotation);
+	body.setPosition(position);
+	barrel.setPosition(position);
+}
+
 void Tank::Shoot()
 {
 	if (ammo <= 0 && !IsAlive())
@@ -109,65 +129,43 @@ void Tank::Shoot()
 		std::sin(tipRotation) * barrelLength
 	};
 
-	bullets.push_back(std::make_unique<bullet>(barrelTip, barrelRotation));
+	FireBullet(barrelTip, barrelRotation, 800.f);
 }
 
-void Tank::UpdateBullets(float dt, CollisionManager& collisionManager)
+void Tank::FireBullet(sf::Vector2f start, sf::Angle direction, float speed)
 {
-	for (auto i = bullets.begin(); i != bullets.end();)
+	for (auto& spent : bullets)
 	{
-		(*i)->Update(dt, collisionManager);
-
-		// Remove bullet if  no longer active
-		if (!(*i)->IsActive())
-		{
-			i = bullets.erase(i);
-		}
-		else
+		if (!spent->IsActive())
 		{
-			++i;
+			spent->Reset(start, direction, speed);
+			return;
 		}
 	}
-}
 
-const void Tank::Render(sf::RenderWindow &window) {
-	window.draw(body);
-	window.draw(barrel);
+	bullets.push_back(std::make_unique<bullet>(start, direction, speed));
 }
 
-void Tank::RenderBullets(sf::RenderWindow& window)
+void Tank::UpdateBullets(float dt, CollisionManager& collisionManager)
 {
+	// Inactive bullets stay in the vector for FireBullet to reuse, Update skips them
 	for (auto& bullet : bullets)
 	{
-		bullet->Render(window);
+		bullet->Update(dt, collisionManager);
 	}
 }
 
-bool Tank::CheckPickupCollision(pickUp* pickup)
-{
-	if (!pickup || !pickup->IsActive())
-		return false;
+const void Tank::Render(sf::RenderWindow &window) {
+	CountedDraw(window, body);
+	CountedDraw(window, barrel);
+}
 
-	if (pickup->CheckCollision(GetBounds()))
+void Tank::RenderBullets(sf::RenderWindow& window)
+{
+	for (auto& bullet : bullets)
 	{
-		// Determine what type of pickup this is and handle accordingly
-		if (auto* ammoBox = dynamic_cast<::ammoBox*>(pickup))
-		{
-			AddAmmo(ammoBox->GetAmmoAmount());
-			ammoBox->Respawn();
-
-			return true;
-		}
-		else if (auto* healthKit = dynamic_cast<::healthKit*>(pickup))
-		{
-			AddHealth(healthKit->GetHealAmount());
-			healthKit->Respawn();
-
-			return true;
-		}
+		bullet->Render(window);
 	}
-
-	return false;
 }
 
 void Tank::TakeDamage(const int damage)
@@ -176,12 +174,11 @@ void Tank::TakeDamage(const int damage)
 	if (health < 0)
 		health = 0;
 
-	Utils::printMsg("Tank took " + std::to_string(damage) + " damage. Health: " +
-				   std::to_string(health), warning);
+	PRINT_MSGF(warning, "Tank took %d damage. Health: %d", damage, health);
 
 	if (health == 0)
 	{
-		Utils::printMsg("Tank Died =(", error);
+		PRINT_MSG("Tank Died =(", error);
 		body.setColor(sf::Color(255, 0, 0));
 		barrel.setColor(sf::Color(255, 0, 0));
 	}
@@ -248,5 +245,9 @@ void Tank::Reset()
 	body.setColor(sf::Color(255, 255, 255));
 	barrel.setColor(sf::Color(255, 255, 255));
 
-	bullets.clear();
+	// Kept for reuse, just no longer flying
+	for (auto& bullet : bullets)
+	{
+		bullet->Deactivate();
+	}
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "alloc_tracker.h"
+#include "logger.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+    // Frames of every site that are allowed to allocate: first connections, buffers growing
+    // to their working size, textures... Five seconds at 60 Hz
+    constexpr uint64_t WARMUP_FRAMES = 300;
+
+    // Frames between two reports of the same site, strict mode stops at the first one anyway
+    constexpr uint64_t REPORT_INTERVAL = 60;
+
+    constexpr std::size_t MAX_ZONES = 16;
+
+    struct ZoneCounts
+    {
+        const char* name;
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    // Plain data so the thread_local needs no constructor, operator new can run before anything
+    struct ThreadState
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+
+        const char* zone;
+        bool inFrame;
+
+        // Allocations made inside an ALLOC_EXEMPT scope, taken off the frame's count
+        bool exempt;
+        uint64_t exemptAllocations;
+
+        // Allocations of the current frame by zone, names compared by pointer (they are literals)
+        std::array<ZoneCounts, MAX_ZONES> zones;
+        std::size_t zoneCount;
+    };
+
+    thread_local ThreadState state = {};
+
+    std::atomic<bool> strictMode{false};
+    std::atomic<uint64_t> allocatingFrames{0};
+
+    void Attribute(uint64_t allocations, uint64_t bytes)
+    {
+        for (std::size_t i = 0; i < state.zoneCount; i++)
+        {
+            if (state.zones[i].name == state.zone)
+            {
+                state.zones[i].allocations += allocations;
+                state.zones[i].bytes += bytes;
+                return;
+            }
+        }
+
+        // Out of slots, the last one takes the rest
+        if (state.zoneCount == MAX_ZONES)
+        {
+            state.zones[MAX_ZONES - 1].allocations += allocations;
+            state.zones[MAX_ZONES - 1].bytes += bytes;
+            return;
+        }
+
+        state.zones[state.zoneCount++] = {state.zone, allocations, bytes};
+    }
+}
+
+AllocTracker::Counts AllocTracker::GetThreadCounts()
+{
+    return {state.allocations, state.bytes};
+}
+
+void AllocTracker::SetStrict(bool strict)
+{
+    strictMode.store(strict, std::memory_order_relaxed);
+}
+
+uint64_t AllocTracker::GetAllocatingFrames()
+{
+    return allocatingFrames.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::OnAllocation(std::size_t size)
+{
+    state.allocations++;
+    state.bytes += size;
+
+    if (state.exempt)
+        state.exemptAllocations++;
+
+    if (state.inFrame)
+        Attribute(1, size);
+}
+
+void AllocTracker::AddToThread(Counts counts)
+{
+    if (counts.allocations == 0)
+        return;
+
+    state.allocations += counts.allocations;
+    state.bytes += counts.bytes;
+
+    if (state.inFrame)
+        Attribute(counts.allocations, counts.bytes);
+}
+
+AllocTracker::ExemptScope::ExemptScope()
+    : previous(state.exempt)
+{
+    state.exempt = true;
+}
+
+AllocTracker::ExemptScope::~ExemptScope()
+{
+    state.exempt = previous;
+}
+
+AllocTracker::ZoneScope::ZoneScope(const char* name)
+    : previous(state.zone)
+{
+    state.zone = name;
+}
+
+AllocTracker::ZoneScope::~ZoneScope()
+{
+    state.zone = previous;
+}
+
+AllocTracker::FrameScope::FrameScope(FrameSite& site)
+    : site(site), start(GetThreadCounts()), exemptStart(state.exemptAllocations), zone(site.name)
+{
+    state.zoneCount = 0;
+    state.inFrame = true;
+}
+
+AllocTracker::FrameScope::~FrameScope()
+{
+    const Counts end = GetThreadCounts();
+    state.inFrame = false;
+    site.frames++;
+
+    const uint64_t allocations = end.allocations - start.allocations - (state.exemptAllocations - exemptStart);
+    if (allocations == 0 || site.frames <= WARMUP_FRAMES)
+        return;
+
+    site.allocatingFrames++;
+    allocatingFrames.fetch_add(1, std::memory_order_relaxed);
+
+    const bool strict = strictMode.load(std::memory_order_relaxed);
+    if (!strict && site.lastReport != 0 && site.frames - site.lastReport < REPORT_INTERVAL)
+        return;
+    site.lastReport = site.frames;
+
+    // Formatted in place, a std::string here would count against the next frame
+    char message[Logger::MAX_TEXT];
+    int length = std::snprintf(message, sizeof(message), "%s allocated %llu times (%llu bytes) after warm-up, %llu of %llu frames so far:",
+                               site.name, static_cast<unsigned long long>(allocations),
+                               static_cast<unsigned long long>(end.bytes - start.bytes),
+                               static_cast<unsigned long long>(site.allocatingFrames),
+                               static_cast<unsigned long long>(site.frames));
+
+    for (std::size_t i = 0; i < state.zoneCount && length > 0 && static_cast<std::size_t>(length) < sizeof(message); i++)
+    {
+        length += std::snprintf(message + length, sizeof(message) - length, " %s %llu", state.zones[i].name,
+                                static_cast<unsigned long long>(state.zones[i].allocations));
+    }
+
+    if (length < 0)
+        return;
+
+    const std::size_t size = static_cast<std::size_t>(length) < sizeof(message) ? static_cast<std::size_t>(length) : sizeof(message) - 1;
+    Logger::Write(std::string_view(message, size), strict ? error : warning);
+
+    if (strict)
+    {
+        Logger::Flush();
+        std::abort();
+    }
+}
+
+#ifdef TANK_ALLOC_TRACKING
+
+// Only the plain and the aligned forms are replaced (and the sized deletes, compilers warn
+// otherwise), the array and nothrow versions of the standard library call these
+void* operator new(std::size_t size)
+{
+    AllocTracker::OnAllocation(size);
+
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    AllocTracker::OnAllocation(size);
+
+    const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants a size that is a multiple of the alignment
+    void* memory = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+    if (memory)
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation accounting, opt in with the TANK_ALLOC_TRACKING CMake option (it replaces
+// the global operator new / delete, so it is off by default). Counts are per thread.
+//
+//   ALLOC_FRAME("Name");   sums what the rest of a tick or frame allocates. After a warm-up,
+//                          a frame that allocated is logged with the zones it happened in,
+//                          and aborts in strict mode (ALLOC_STRICT=1), which is how we check
+//                          the steady state allocates nothing
+//   ALLOC_ZONE("Name");    attributes allocations of the rest of the scope to Name, every
+//                          PROFILE_ZONE / PROFILE_BUDGET does this already
+//   ALLOC_EXEMPT();        allocations of the rest of the scope do not make the frame an
+//                          allocating one. Only for diagnostics that run once something
+//                          already went wrong, never for work done every frame
+namespace AllocTracker
+{
+    struct Counts
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Everything this thread allocated since it started
+    Counts GetThreadCounts();
+
+    // Counts allocations another thread made for this one into it, and into its frame. Job
+    // workers report back to the thread that waited on them this way
+    void AddToThread(Counts counts);
+
+    // Frames that allocate after the warm-up abort instead of only being logged
+    void SetStrict(bool strict);
+
+    // Frames of every ALLOC_FRAME site, on every thread, that allocated after their warm-up
+    uint64_t GetAllocatingFrames();
+
+    // Called by the operator new replacement, not meant for anything else
+    void OnAllocation(std::size_t size);
+
+    class ExemptScope
+    {
+    public:
+        ExemptScope();
+        ~ExemptScope();
+
+        ExemptScope(const ExemptScope&) = delete;
+        ExemptScope& operator=(const ExemptScope&) = delete;
+
+    private:
+        bool previous;
+    };
+
+    class ZoneScope
+    {
+    public:
+        explicit ZoneScope(const char* name);
+        ~ZoneScope();
+
+        ZoneScope(const ZoneScope&) = delete;
+        ZoneScope& operator=(const ZoneScope&) = delete;
+
+    private:
+        const char* previous;
+    };
+
+    // One per ALLOC_FRAME call site, lives as long as the program
+    struct FrameSite
+    {
+        const char* name;
+        uint64_t frames = 0;
+        uint64_t allocatingFrames = 0;
+        uint64_t lastReport = 0;
+    };
+
+    class FrameScope
+    {
+    public:
+        explicit FrameScope(FrameSite& site);
+        ~FrameScope();
+
+        FrameScope(const FrameScope&) = delete;
+        FrameScope& operator=(const FrameScope&) = delete;
+
+    private:
+        FrameSite& site;
+        Counts start;
+        uint64_t exemptStart;
+        ZoneScope zone;
+    };
+}
+
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+
+#ifdef TANK_ALLOC_TRACKING
+#define ALLOC_FRAME(name)                                                                        \
+    static AllocTracker::FrameSite ALLOC_CONCAT(allocSite, __LINE__){name};                     \
+    AllocTracker::FrameScope ALLOC_CONCAT(allocFrame, __LINE__)(ALLOC_CONCAT(allocSite, __LINE__))
+#define ALLOC_ZONE(name) AllocTracker::ZoneScope ALLOC_CONCAT(allocZone, __LINE__)(name)
+#define ALLOC_EXEMPT() AllocTracker::ExemptScope ALLOC_CONCAT(allocExempt, __LINE__)
+#else
+#define ALLOC_FRAME(name) ((void)0)
+#define ALLOC_ZONE(name) ((void)0)
+#define ALLOC_EXEMPT() ((void)0)
+#endif
@@ -5,10 +5,8 @@
 #include "ammoBox.h"
 
 ammoBox::ammoBox(sf::Vector2f position,
-                 float worldWidth,
-                 float worldHeight,
                  int ammoAmount)
-    : pickUp("Assets/AmmoBox.png", position, worldWidth, worldHeight),
+    : pickUp("Assets/AmmoBox.png", position),
       ammoAmount(ammoAmount)
 {
 }
@@ -6,23 +6,18 @@
 #define TANK_GAME_AMMOBOX_H
 #include "pickUp.h"
 
+constexpr int AMMO_BOX_AMOUNT = 5;
+
 
 class ammoBox: public pickUp
 {
     public:
         ammoBox(sf::Vector2f position,
-                float worldWidth = 1280.f,
-                float worldHeight = 960.f,
-                int ammoAmount = 5);
+                int ammoAmount = AMMO_BOX_AMOUNT);
 
         // Get the amount of ammo this box provides
         int GetAmmoAmount() const { return ammoAmount; }
 
-        void SetPosition(sf::Vector2f position)
-        {
-            sprite.setPosition(position);
-            this->position = position;
-        };
     private:
         int ammoAmount;
 
@@ -6,19 +6,39 @@
 #include "tank.h"
 #include <cmath>
 #include "collision_manager.h"
+#include "perf_counters.h"
 
-bullet::bullet(sf::Vector2f startPosition, sf::Angle direction, float speed, int damage)
-    : position(startPosition), rotation(direction), speed(speed), isActive(true), damage(damage)
+// Loaded once and shared, every shot used to read the file and upload its own copy
+static const sf::Texture& BulletTexture()
 {
-    // Load bullet texture
-    if (!texture.loadFromFile("Assets/bullet.png"))
-    {
-        Utils::printMsg("Could not load texture: Assets/bullet.png", warning);
-    }
+    static const sf::Texture texture = [] {
+        sf::Texture loaded;
+        if (!loaded.loadFromFile("Assets/bullet.png"))
+        {
+            Utils::printMsg("Could not load texture: Assets/bullet.png", warning);
+        }
+        return loaded;
+    }();
 
-    sprite.setTexture(texture);
-    sprite.setTextureRect(sf::IntRect({0, 0}, (sf::Vector2i)texture.getSize()));
+    return texture;
+}
+
+bullet::bullet(sf::Vector2f startPosition, sf::Angle direction, float speed, int damage)
+    : damage(damage), sprite(BulletTexture())
+{
+    sprite.setTextureRect(sf::IntRect({0, 0}, (sf::Vector2i)BulletTexture().getSize()));
     sprite.setOrigin((sf::Vector2f)sprite.getTextureRect().getCenter());
+
+    Reset(startPosition, direction, speed);
+}
+
+void bullet::Reset(sf::Vector2f startPosition, sf::Angle direction, float newSpeed)
+{
+    position = startPosition;
+    rotation = direction;
+    speed = newSpeed;
+    isActive = true;
+
     sprite.setPosition(position);
     sprite.setRotation(rotation);
 
@@ -44,23 +64,20 @@ void bullet::Update(float dt, CollisionManager& collisionManager)
 
     if (collisionManager.CheckCollision(bounds, pushback))
     {
-        Utils::printMsg("Bullet collided with obstacle, destroying bullet. Detection locally in bullet.cpp", success);
+        PRINT_MSG("Bullet collided with obstacle, destroying bullet. Detection locally in bullet.cpp", success);
         isActive = false;
     }
 }
 
-bool bullet::CheckTankCollision(Tank* tank)
+bool bullet::CheckTankCollision(Tank* tank, const sf::FloatRect& tankBounds, const sf::FloatRect& bulletBounds)
 {
     if (!isActive || !tank || !tank->IsAlive())
         return false;
 
-    sf::FloatRect bulletBounds = GetBounds();
-    sf::FloatRect tankBounds = tank->GetBounds();
-
     // Check if bullet intersects with tank
     if (bulletBounds.findIntersection(tankBounds).has_value())
     {
-        Utils::printMsg("Bullet hit tank", warning);
+        PRINT_MSG("Bullet hit tank", warning);
         tank->TakeDamage(damage);
         isActive = false;
         return true;
@@ -74,6 +91,6 @@ void bullet::Render(sf::RenderWindow& window)
 {
     if (isActive)
     {
-        window.draw(sprite);
+        CountedDraw(window, sprite);
     }
 }
\ No newline at end of file
@@ -8,10 +8,17 @@
 class CollisionManager;
 class Tank;
 
+// Every shot in the game, the server moves its copy at the same speed the clients draw theirs
+constexpr float BULLET_SPEED = 400.f;
+constexpr int BULLET_DAMAGE = 10;
+
 class bullet
 {
 public:
-    bullet(sf::Vector2f startPosition, sf::Angle direction, float speed = 800.f, int damage = 10);
+    bullet(sf::Vector2f startPosition, sf::Angle direction, float speed = 800.f, int damage = BULLET_DAMAGE);
+
+    // Fire an inactive bullet again instead of allocating a new one
+    void Reset(sf::Vector2f startPosition, sf::Angle direction, float newSpeed = 800.f);
 
     void Update(float dt, CollisionManager& collisionManager);
     void Render(sf::RenderWindow& window);
@@ -24,8 +31,9 @@ public:
     sf::Vector2f GetPosition() const { return position; }
     sf::FloatRect GetBounds() const { return sprite.getGlobalBounds(); }
 
-    // Check collision with tank
-    bool CheckTankCollision(Tank* tank);
+    // Check collision with tank, both bounds worked out by the caller so every bullet and tank
+    // only pays for its own once a frame
+    bool CheckTankCollision(Tank* tank, const sf::FloatRect& tankBounds, const sf::FloatRect& bulletBounds);
 
     // Get damage amount
     int GetDamage() const { return damage; }
@@ -38,10 +46,6 @@ private:
     bool isActive;
     int damage;
 
-    sf::Texture texture;
-    sf::Sprite sprite = sf::Sprite(texture);
-
-    // World boundaries
-    const float WORLD_WIDTH = 1280.f;
-    const float WORLD_HEIGHT = 960.f;
+    // Shared texture, see BulletTexture in bullet.cpp
+    sf::Sprite sprite;
 };
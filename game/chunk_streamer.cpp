@@ -0,0 +1,165 @@
+#include "chunk_streamer.h"
+#include "profiler.h"
+#include "world_gen.h"
+
+ChunkStreamer::ChunkStreamer()
+    : chunks(static_cast<std::size_t>(layout.GetCount()))
+{
+}
+
+void ChunkStreamer::Reset(uint32_t newSeed, const ChunkLayout& newLayout, std::unique_ptr<MapFile> newMap,
+                          CollisionManager& collisions)
+{
+    while (!loadedChunks.empty())
+    {
+        Unload(loadedChunks.back(), collisions);
+    }
+    ClearPickups();
+
+    seed = newSeed;
+    layout = newLayout;
+    map = std::move(newMap);
+    hasWorld = true;
+
+    chunks.clear();
+    chunks.resize(static_cast<std::size_t>(layout.GetCount()));
+}
+
+void ChunkStreamer::Update(const sf::FloatRect& view, CollisionManager& collisions, const decorations& decoration)
+{
+    PROFILE_ZONE("ChunkStreamer::Update");
+
+    if (!hasWorld)
+        return;
+
+    // Unload first, a chunk that goes out of range and comes back in the same frame is rare
+    const ChunkRange keep = layout.Overlapping(view, 2);
+    for (std::size_t i = 0; i < loadedChunks.size();)
+    {
+        const int index = loadedChunks[i];
+        if (ChunkLayout::Contains(keep, index % layout.GetColumns(), index / layout.GetColumns()))
+        {
+            i++;
+            continue;
+        }
+
+        Unload(index, collisions);
+    }
+
+    layout.ForEach(layout.Overlapping(view), [&](int index) {
+        if (!chunks[index].loaded)
+            Load(index, collisions, decoration);
+    });
+
+    int ringLoads = MAX_RING_LOADS;
+    layout.ForEach(layout.Overlapping(view, 1), [&](int index) {
+        if (ringLoads > 0 && !chunks[index].loaded)
+        {
+            Load(index, collisions, decoration);
+            ringLoads--;
+        }
+    });
+}
+
+void ChunkStreamer::Load(int index, CollisionManager& collisions, const decorations& decoration)
+{
+    Chunk& chunk = chunks[index];
+
+    if (map)
+    {
+        // Straight from the mapped file, rocks and fences are tiles drawn by the batch
+        for (const MapRect& rect : map->GetChunkColliders(index))
+        {
+            collisions.AddStaticCollider({{rect.x, rect.y}, {rect.width, rect.height}});
+        }
+        decoration.BuildChunk(*map, index, chunk.decoration);
+    }
+    else
+    {
+        BuildObstacles(GenerateChunk(seed, layout, index), chunk.obstacles, collisions);
+        decoration.BuildChunk(layout.GetBounds(index), layout.GetWorldSize(), chunk.decoration);
+    }
+
+    chunk.loaded = true;
+    loadedChunks.push_back(index);
+}
+
+void ChunkStreamer::Unload(int index, CollisionManager& collisions)
+{
+    Chunk& chunk = chunks[index];
+
+    collisions.ClearChunkColliders(index);
+    chunk.obstacles.clear();
+    chunk.decoration = decorationBatch();
+    chunk.loaded = false;
+
+    // Order of loadedChunks does not matter, swap with the last one
+    for (std::size_t i = 0; i < loadedChunks.size(); i++)
+    {
+        if (loadedChunks[i] == index)
+        {
+            loadedChunks[i] = loadedChunks.back();
+            loadedChunks.pop_back();
+            break;
+        }
+    }
+}
+
+void ChunkStreamer::Render(sf::RenderWindow& window, const sf::FloatRect& view, const decorations& decoration) const
+{
+    // One ring more than the view, a rock or pickup can reach in from the next chunk
+    const ChunkRange visible = layout.Overlapping(view, 1);
+
+    layout.ForEach(visible, [&](int index) {
+        if (chunks[index].loaded)
+            decoration.RenderGround(window, chunks[index].decoration);
+    });
+
+    layout.ForEach(visible, [&](int index) {
+        const Chunk& chunk = chunks[index];
+        if (!chunk.loaded)
+            return;
+
+        decoration.RenderProps(window, chunk.decoration);
+        for (const auto& obstacle : chunk.obstacles)
+        {
+            obstacle->Render(window, false);
+        }
+    });
+
+    layout.ForEach(visible, [&](int index) {
+        for (const pickUp* pickup : chunks[index].pickups)
+        {
+            pickup->Render(window);
+        }
+    });
+}
+
+void ChunkStreamer::SetPickups(const std::vector<std::unique_ptr<ammoBox>>& ammoBoxes,
+                               const std::vector<std::unique_ptr<healthKit>>& healthKits)
+{
+    ClearPickups();
+
+    auto add = [this](const pickUp& pickup) {
+        const int index = layout.IndexAt(pickup.GetPosition());
+        if (chunks[index].pickups.empty())
+            pickupChunks.push_back(index);
+
+        chunks[index].pickups.push_back(&pickup);
+    };
+
+    for (const auto& ammoBox : ammoBoxes)
+        add(*ammoBox);
+
+    for (const auto& healthKit : healthKits)
+        add(*healthKit);
+}
+
+void ChunkStreamer::ClearPickups()
+{
+    for (int index : pickupChunks)
+    {
+        chunks[index].pickups.clear();
+    }
+    pickupChunks.clear();
+}
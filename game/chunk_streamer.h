@@ -0,0 +1,64 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ammoBox.h"
+#include "collision_manager.h"
+#include "decorations.h"
+#include "healthKit.h"
+#include "map_file.h"
+#include "obstacle.h"
+#include "world_chunks.h"
+
+// Client side of the chunked world. Rocks (generated from the seed or read from a map file),
+// their colliders and the decoration batch of a chunk only exist while the camera is close, so the work per frame depends on the view
+// and not on the size of the map. Pickups all come from the server and are only sorted
+// into chunks, so drawing them stays local too
+class ChunkStreamer
+{
+public:
+    ChunkStreamer();
+
+    // New world from the server, drops everything loaded so far. With a map the seed is unused
+    void Reset(uint32_t seed, const ChunkLayout& layout, std::unique_ptr<MapFile> map, CollisionManager& collisions);
+
+    const MapFile* GetMap() const { return map.get(); }
+
+    // Chunks the view touches load at once, the ring around them a few per frame so a fast
+    // camera does not stall on a row of new chunks. Anything two rings out is unloaded
+    void Update(const sf::FloatRect& view, CollisionManager& collisions, const decorations& decoration);
+
+    void Render(sf::RenderWindow& window, const sf::FloatRect& view, const decorations& decoration) const;
+
+    // Sort the pickups into chunks again, after they were created or one moved
+    void SetPickups(const std::vector<std::unique_ptr<ammoBox>>& ammoBoxes,
+                    const std::vector<std::unique_ptr<healthKit>>& healthKits);
+
+    std::size_t GetLoadedCount() const { return loadedChunks.size(); }
+
+private:
+    // Ring loads allowed per frame, about one row of chunks per second at 60 fps
+    static constexpr int MAX_RING_LOADS = 2;
+
+    struct Chunk
+    {
+        bool loaded = false;
+        std::vector<std::unique_ptr<obstacle>> obstacles;
+        decorationBatch decoration;
+        std::vector<const pickUp*> pickups;
+    };
+
+    ChunkLayout layout;
+    uint32_t seed = 0;
+    std::unique_ptr<MapFile> map;
+    bool hasWorld = false;
+
+    std::vector<Chunk> chunks;
+    std::vector<int> loadedChunks;
+    std::vector<int> pickupChunks;   // chunks holding pickups, so a resort does not walk the world
+
+    void Load(int index, CollisionManager& collisions, const decorations& decoration);
+    void Unload(int index, CollisionManager& collisions);
+    void ClearPickups();
+};
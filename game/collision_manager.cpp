@@ -4,41 +4,46 @@
 
 #include "collision_manager.h"
 #include <cmath>
+#include "profiler.h"
 
-CollisionManager::CollisionManager(float worldWidth, float worldHeight)
-    : worldWidth(worldWidth), worldHeight(worldHeight) {
+CollisionManager::CollisionManager(const ChunkLayout& layout)
+    : chunkColliders(static_cast<std::size_t>(layout.GetCount())), layout(layout) {
     // Create walls on start
     CreateBoundaryWalls();
 }
 
 bool CollisionManager::CheckCollision(const sf::FloatRect& rect, sf::Vector2f& pushback) const {
+    PROFILE_ZONE("CheckCollision");
+
     pushback = {0, 0};
     bool collisionDetected = false;
     float smallestMagnitude = INFINITY;
 
-    // Check against all static colliders
-    for (const auto& collider : staticColliders) {
-        if (IsColliding(rect, collider.bounds)) {
-            sf::Vector2f currentPushback = CalculatePushback(rect, collider.bounds);
-            float magnitude = std::sqrt(currentPushback.x * currentPushback.x +
-                                      currentPushback.y * currentPushback.y);
+    // Walls at the edges of the world
+    collisionDetected |= CheckAgainst(boundaryColliders, rect, pushback, smallestMagnitude);
 
-            // keep the smallest one so it doesnt over calculate
-            if (magnitude < smallestMagnitude) {
-                smallestMagnitude = magnitude;
-                pushback = currentPushback;
-                collisionDetected = true;
-            }
-        }
-    }
+    // Static colliders of the chunks under the rectangle and their neighbours
+    layout.ForEach(layout.Overlapping(rect, 1), [&](int chunk) {
+        collisionDetected |= CheckAgainst(chunkColliders[chunk], rect, pushback, smallestMagnitude);
+    });
 
     // Check against all dynamic colliders
-    for (const auto& collider : dynamicColliders) {
+    collisionDetected |= CheckAgainst(dynamicColliders, rect, pushback, smallestMagnitude);
+
+    return collisionDetected;
+}
+
+bool CollisionManager::CheckAgainst(const std::vector<CollisionBox>& colliders, const sf::FloatRect& rect,
+                                    sf::Vector2f& pushback, float& smallestMagnitude) {
+    bool collisionDetected = false;
+
+    for (const auto& collider : colliders) {
         if (IsColliding(rect, collider.bounds)) {
             sf::Vector2f currentPushback = CalculatePushback(rect, collider.bounds);
             float magnitude = std::sqrt(currentPushback.x * currentPushback.x +
                                       currentPushback.y * currentPushback.y);
 
+            // keep the smallest one so it doesnt over calculate
             if (magnitude < smallestMagnitude) {
                 smallestMagnitude = magnitude;
                 pushback = currentPushback;
@@ -110,7 +115,11 @@ sf::Vector2f CollisionManager::CalculatePushback(const sf::FloatRect& movingRect
 }
 
 void CollisionManager::AddStaticCollider(const sf::FloatRect& rect, int layer) {
-    staticColliders.emplace_back(rect, true, layer);
+    chunkColliders[layout.IndexAt(rect.getCenter())].emplace_back(rect, true, layer);
+}
+
+void CollisionManager::ClearChunkColliders(int chunk) {
+    chunkColliders[chunk].clear();
 }
 
 void CollisionManager::ClearDynamicColliders() {
@@ -122,16 +131,17 @@ void CollisionManager::AddDynamicCollider(const sf::FloatRect& rect, int layer)
 }
 
 void CollisionManager::CreateBoundaryWalls(float thickness) {
+    const sf::Vector2f world = layout.GetWorldSize();
 
     // Top wall
-    AddStaticCollider(sf::FloatRect(sf::Vector2f(0, -thickness), sf::Vector2f(worldWidth, thickness)));
+    boundaryColliders.emplace_back(sf::FloatRect(sf::Vector2f(0, -thickness), sf::Vector2f(world.x, thickness)));
 
     // Bottom wall
-    AddStaticCollider(sf::FloatRect(sf::Vector2f(0, worldHeight), sf::Vector2f(worldWidth, thickness)));
+    boundaryColliders.emplace_back(sf::FloatRect(sf::Vector2f(0, world.y), sf::Vector2f(world.x, thickness)));
 
     // Left wall
-    AddStaticCollider(sf::FloatRect(sf::Vector2f(-thickness, 0), sf::Vector2f(thickness, worldHeight)));
+    boundaryColliders.emplace_back(sf::FloatRect(sf::Vector2f(-thickness, 0), sf::Vector2f(thickness, world.y)));
 
     // Right wall
-    AddStaticCollider(sf::FloatRect(sf::Vector2f(worldWidth, 0), sf::Vector2f(thickness, worldHeight)));
+    boundaryColliders.emplace_back(sf::FloatRect(sf::Vector2f(world.x, 0), sf::Vector2f(thickness, world.y)));
 }
\ No newline at end of file
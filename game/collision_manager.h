@@ -4,6 +4,7 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include <vector>
+#include "world_chunks.h"
 
 // I created  this script based on the collision system AABB with help of this YouTube tutorial and AI Claude
 // https://www.youtube.com/watch?v=IaUcAt0jDqs&t=607s
@@ -19,7 +20,7 @@ struct CollisionBox {
 
 class CollisionManager {
 public:
-    CollisionManager(float worldWidth = 1280.f, float worldHeight = 960.f);
+    explicit CollisionManager(const ChunkLayout& layout = ChunkLayout());
 
     // Check if a rectangle collides with any static or dynamic collider
     bool CheckCollision(const sf::FloatRect& rect, sf::Vector2f& pushback) const;
@@ -30,9 +31,12 @@ public:
     // Calculate the pushback vector to separate two overlapping rectangles
     static sf::Vector2f CalculatePushback(const sf::FloatRect& movingRect, const sf::FloatRect& staticRect);
 
-    // Add a static collision box (walls, fences)
+    // Add a static collision box (walls, fences), kept with the chunk its centre is in
     void AddStaticCollider(const sf::FloatRect& rect, int layer = 0);
 
+    // Drop the static colliders of a chunk when it is unloaded, the boundary walls stay
+    void ClearChunkColliders(int chunk);
+
     // Clear all dynamic colliders (call at start of each frame)
     void ClearDynamicColliders();
 
@@ -42,11 +46,30 @@ public:
     // Create invisible walls at world edges
     void CreateBoundaryWalls(float thickness = 50.f);
 
+    // Calls function(bounds) for every static collider, the boundary walls too
+    template <typename Function>
+    void ForEachStaticCollider(Function&& function) const
+    {
+        for (const auto& chunk : chunkColliders)
+        {
+            for (const CollisionBox& box : chunk)
+                function(box.bounds);
+        }
+        for (const CollisionBox& box : boundaryColliders)
+            function(box.bounds);
+    }
+
+    const ChunkLayout& GetLayout() const { return layout; }
+    sf::Vector2f GetWorldSize() const { return layout.GetWorldSize(); }
 
 private:
-    std::vector<CollisionBox> staticColliders;   // Walls, fences, static obstacles
-    std::vector<CollisionBox> dynamicColliders;  // Tanks, moving objects
+    // Static colliders by chunk, a check only looks at the chunks around it
+    std::vector<std::vector<CollisionBox>> chunkColliders;
+    std::vector<CollisionBox> boundaryColliders;  // Longer than a chunk, always checked
+    std::vector<CollisionBox> dynamicColliders;   // Tanks, moving objects
+
+    ChunkLayout layout;
 
-    float worldWidth;
-    float worldHeight;
+    static bool CheckAgainst(const std::vector<CollisionBox>& colliders, const sf::FloatRect& rect,
+                             sf::Vector2f& pushback, float& smallestMagnitude);
 };
\ No newline at end of file
@@ -4,119 +4,184 @@
 
 #include "decorations.h"
 #include "utils.h"
+#include "perf_counters.h"
+#include <algorithm>
 
-decorations::decorations(float worldWidth, float worldHeight)
-    : worldWidth(worldWidth), worldHeight(worldHeight)
+// Two triangles, texture coordinates in pixels (the sand texture repeats)
+static void AddQuad(sf::VertexArray& vertices, const sf::FloatRect& rect, sf::Vector2f texCoords)
 {
-    CreateSand();
-    CreateFences();
+    const sf::Vector2f size = rect.size;
+    const sf::Vector2f corners[6] = {{0, 0}, {size.x, 0}, {0, size.y}, {0, size.y}, {size.x, 0}, size};
+
+    for (const sf::Vector2f& corner : corners)
+    {
+        vertices.append(sf::Vertex{rect.position + corner, sf::Color::White, texCoords + corner});
+    }
 }
 
-void decorations::CreateSand()
+// Whole texture drawn over rect whatever their sizes
+static void AddStretchedQuad(sf::VertexArray& vertices, const sf::FloatRect& rect, sf::Vector2f textureSize)
 {
-    const float sandVectorWidth = 64.f;
+    const sf::Vector2f size = rect.size;
+    const sf::Vector2f corners[6] = {{0, 0}, {1, 0}, {0, 1}, {0, 1}, {1, 0}, {1, 1}};
 
-    sandTexture.loadFromFile("Assets/tileSand1.png");
+    for (const sf::Vector2f& corner : corners)
+    {
+        vertices.append(sf::Vertex{rect.position + sf::Vector2f(corner.x * size.x, corner.y * size.y), sf::Color::White,
+                                   sf::Vector2f(corner.x * textureSize.x, corner.y * textureSize.y)});
+    }
+}
+
+static void LoadTexture(sf::Texture& texture, const std::string& path)
+{
+    if (!texture.loadFromFile(path))
+    {
+        Utils::printMsg("Could not load texture: " + path, warning);
+    }
+}
 
+decorations::decorations()
+{
+    LoadTexture(sandTexture, "Assets/tileSand1.png");
     sandTexture.setRepeated(true);
 
-    // Top sand strip
-    sf::Sprite topSand(sandTexture);
-    topSand.setTextureRect(sf::IntRect({0, 0}, {static_cast<int>(worldWidth), static_cast<int>(sandVectorWidth)}));
-    topSand.setPosition({0,0});
-    sandVector.push_back(topSand);
-
-    // Bottom sand strip
-    sf::Sprite bottomSand(sandTexture);
-    bottomSand.setTextureRect(sf::IntRect({0, 0}, {static_cast<int>(worldWidth), static_cast<int>(sandVectorWidth)}));
-    bottomSand.setPosition({0, worldHeight - sandVectorWidth});
-    sandVector.push_back(bottomSand);
-
-    // Left sand strip
-    sf::Sprite leftSand(sandTexture);
-    leftSand.setTextureRect(sf::IntRect({0, 0}, {static_cast<int>(sandVectorWidth), static_cast<int>(worldHeight)}));
-    leftSand.setPosition({0, 0});
-    sandVector.push_back(leftSand);
-
-    // Right sand strip
-    sf::Sprite rightSand(sandTexture);
-    rightSand.setTextureRect(sf::IntRect({0, 0}, {static_cast<int>(sandVectorWidth), static_cast<int>(worldHeight)}));
-    rightSand.setPosition({worldWidth - sandVectorWidth, 0});
-    sandVector.push_back(rightSand);
+    LoadTexture(horizontalFenceTexture, "Assets/Horizontal Fence.png");
+    LoadTexture(verticalFenceTexture, "Assets/Vertical Fence.png");
+    LoadTexture(rockTexture, "../Assets/Rock.png");
+}
+
+void decorations::BuildChunk(const sf::FloatRect& chunk, sf::Vector2f worldSize, decorationBatch& batch) const
+{
+    batch.sand.clear();
+    batch.horizontalFences.clear();
+    batch.verticalFences.clear();
+    batch.rocks.clear();
+
+    AddSand(chunk, worldSize, batch.sand);
+    AddFences(chunk, worldSize, batch);
+}
+
+void decorations::BuildChunk(const MapFile& map, int chunk, decorationBatch& batch) const
+{
+    batch.sand.clear();
+    batch.horizontalFences.clear();
+    batch.verticalFences.clear();
+    batch.rocks.clear();
+
+    const ChunkLayout layout = map.GetLayout();
+    const int firstX = (chunk % layout.GetColumns()) * MAP_TILES_PER_CHUNK;
+    const int firstY = (chunk / layout.GetColumns()) * MAP_TILES_PER_CHUNK;
+    const sf::Vector2f tileSize = {MAP_TILE_SIZE, MAP_TILE_SIZE};
+
+    for (int layer = 0; layer < map.GetLayerCount(); layer++)
+    {
+        for (int y = firstY; y < firstY + MAP_TILES_PER_CHUNK; y++)
+        {
+            for (int x = firstX; x < firstX + MAP_TILES_PER_CHUNK; x++)
+            {
+                const sf::FloatRect tile = {{x * MAP_TILE_SIZE, y * MAP_TILE_SIZE}, tileSize};
+
+                // Sand repeats in world coordinates, the others are stretched over the tile
+                switch (map.GetTile(layer, x, y))
+                {
+                    case MapTile::Sand:
+                        AddQuad(batch.sand, tile, tile.position);
+                        break;
+                    case MapTile::HorizontalFence:
+                        AddStretchedQuad(batch.horizontalFences, tile, static_cast<sf::Vector2f>(horizontalFenceTexture.getSize()));
+                        break;
+                    case MapTile::VerticalFence:
+                        AddStretchedQuad(batch.verticalFences, tile, static_cast<sf::Vector2f>(verticalFenceTexture.getSize()));
+                        break;
+                    case MapTile::Rock:
+                        AddStretchedQuad(batch.rocks, tile, static_cast<sf::Vector2f>(rockTexture.getSize()));
+                        break;
+                    default:
+                        // None, or a tile this build does not know
+                        break;
+                }
+            }
+        }
+    }
 }
 
-void decorations::CreateFences()
+void decorations::AddSand(const sf::FloatRect& chunk, sf::Vector2f worldSize, sf::VertexArray& vertices) const
+{
+    const float sandVectorWidth = 64.f;
+
+    // Top, bottom, left and right strips, each cut to the part inside the chunk
+    const sf::FloatRect strips[4] = {
+        {{0, 0}, {worldSize.x, sandVectorWidth}},
+        {{0, worldSize.y - sandVectorWidth}, {worldSize.x, sandVectorWidth}},
+        {{0, 0}, {sandVectorWidth, worldSize.y}},
+        {{worldSize.x - sandVectorWidth, 0}, {sandVectorWidth, worldSize.y}},
+    };
+
+    for (const sf::FloatRect& strip : strips)
+    {
+        if (const auto part = strip.findIntersection(chunk))
+        {
+            AddQuad(vertices, *part, part->position - strip.position);
+        }
+    }
+}
+
+void decorations::AddFences(const sf::FloatRect& chunk, sf::Vector2f worldSize, decorationBatch& batch) const
 {
     const float fenceSize = 32.f;
 
+    const sf::Vector2f horizontalSize = static_cast<sf::Vector2f>(horizontalFenceTexture.getSize());
+    const sf::Vector2f verticalSize = static_cast<sf::Vector2f>(verticalFenceTexture.getSize());
+
+    // A fence goes to the chunk its centre is in, like the obstacles used to be placed
+    auto addFence = [&chunk](sf::VertexArray& vertices, sf::Vector2f centre, sf::Vector2f size) {
+        if (chunk.contains(centre))
+            AddQuad(vertices, {centre - size / 2.f, size}, {0, 0});
+    };
+
+    // Only the fences along the chunk, not the whole edge of the world
+    auto firstFence = [fenceSize](float from) { return std::max(0, static_cast<int>(from / fenceSize)); };
+    auto lastFence = [fenceSize](float to, int count) { return std::min(count, static_cast<int>(to / fenceSize) + 1); };
+
     // Create horizontal fences (top and bottom)
-    int numHorizontalFences = static_cast<int>(worldWidth / fenceSize);
+    int numHorizontalFences = static_cast<int>(worldSize.x / fenceSize);
+    int lastHorizontal = lastFence(chunk.position.x + chunk.size.x, numHorizontalFences);
 
-    for (int i = 0; i < numHorizontalFences; ++i)
+    for (int i = firstFence(chunk.position.x); i < lastHorizontal; ++i)
     {
         float x = i * fenceSize;
 
-        // Top fence
-        auto topFence = std::make_unique<obstacle>(
-            "Assets/Horizontal Fence.png",
-            sf::Vector2f(x + fenceSize/2, fenceSize/2),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(1, 1)
-        );
-        fencesVector.push_back(std::move(topFence));
-
-        // Bottom fence
-        auto bottomFence = std::make_unique<obstacle>(
-            "Assets/Horizontal Fence.png",
-            sf::Vector2f(x + fenceSize/2, worldHeight - fenceSize/2),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(1, 1)
-        );
-        fencesVector.push_back(std::move(bottomFence));
+        addFence(batch.horizontalFences, {x + fenceSize/2, fenceSize/2}, horizontalSize);
+        addFence(batch.horizontalFences, {x + fenceSize/2, worldSize.y - fenceSize/2}, horizontalSize);
     }
 
     // Create vertical fences (left and right)
-    int numVerticalFences = static_cast<int>(worldHeight / fenceSize);
+    int numVerticalFences = static_cast<int>(worldSize.y / fenceSize);
+    int lastVertical = lastFence(chunk.position.y + chunk.size.y, numVerticalFences);
 
-    for (int i = 0; i < numVerticalFences; ++i)
+    for (int i = firstFence(chunk.position.y); i < lastVertical; ++i)
     {
         float y = i * fenceSize;
 
-        // Left fence
-        auto leftFence = std::make_unique<obstacle>(
-            "Assets/Vertical Fence.png",
-            sf::Vector2f(fenceSize/2, y + fenceSize/2),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(1, 1)
-        );
-        fencesVector.push_back(std::move(leftFence));
-
-        // Right fence
-        auto rightFence = std::make_unique<obstacle>(
-            "Assets/Vertical Fence.png",
-            sf::Vector2f(worldWidth - fenceSize/2, y + fenceSize/2),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(0, 0),
-            sf::Vector2f(1, 1)
-        );
-        fencesVector.push_back(std::move(rightFence));
+        addFence(batch.verticalFences, {fenceSize/2, y + fenceSize/2}, verticalSize);
+        addFence(batch.verticalFences, {worldSize.x - fenceSize/2, y + fenceSize/2}, verticalSize);
     }
 }
 
-void decorations::Render(sf::RenderWindow& window)
+void decorations::RenderGround(sf::RenderWindow& window, const decorationBatch& batch) const
 {
-    // Draw sand border strips
-    for (const auto& sand : sandVector)
-    {
-        window.draw(sand);
-    }
+    if (batch.sand.getVertexCount() > 0)
+        CountedDraw(window, batch.sand, &sandTexture);
+}
 
-    // Draw fences
-    for (const auto& fence : fencesVector)
-    {
-        fence->Render(window, false);
-    }
-}
\ No newline at end of file
+void decorations::RenderProps(sf::RenderWindow& window, const decorationBatch& batch) const
+{
+    if (batch.horizontalFences.getVertexCount() > 0)
+        CountedDraw(window, batch.horizontalFences, &horizontalFenceTexture);
+
+    if (batch.verticalFences.getVertexCount() > 0)
+        CountedDraw(window, batch.verticalFences, &verticalFenceTexture);
+
+    if (batch.rocks.getVertexCount() > 0)
+        CountedDraw(window, batch.rocks, &rockTexture);
+}
@@ -4,27 +4,39 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
-#include "obstacle.h"
+#include "map_file.h"
 
+// Sand, fences and map rocks of one chunk, a vertex array per texture so a chunk is a few draws
+struct decorationBatch
+{
+    sf::VertexArray sand{sf::PrimitiveType::Triangles};
+    sf::VertexArray horizontalFences{sf::PrimitiveType::Triangles};
+    sf::VertexArray verticalFences{sf::PrimitiveType::Triangles};
+    sf::VertexArray rocks{sf::PrimitiveType::Triangles};
+};
 
 class decorations
 {
     public:
-    decorations(float worldWidth, float worldHeight);
+    decorations();
 
-    void Render(sf::RenderWindow& window);
+    // Fills batch with what lies in the chunk, for a world of the given size
+    void BuildChunk(const sf::FloatRect& chunk, sf::Vector2f worldSize, decorationBatch& batch) const;
 
-    private:
-    float worldWidth;
-    float worldHeight;
+    // Same from the tile layers of a map, every layer of the chunk in one batch
+    void BuildChunk(const MapFile& map, int chunk, decorationBatch& batch) const;
 
-    sf::Texture sandTexture;
-    std::vector<sf::Sprite> sandVector;
-
-    std::vector<std::unique_ptr<obstacle>> fencesVector;
+    // Ground first for every chunk on screen, then fences and rocks, so nothing gets drawn over them
+    void RenderGround(sf::RenderWindow& window, const decorationBatch& batch) const;
+    void RenderProps(sf::RenderWindow& window, const decorationBatch& batch) const;
 
+    private:
+    sf::Texture sandTexture;
+    sf::Texture horizontalFenceTexture;
+    sf::Texture verticalFenceTexture;
+    sf::Texture rockTexture;
 
-    void CreateFences();
-    void CreateSand();
+    void AddSand(const sf::FloatRect& chunk, sf::Vector2f worldSize, sf::VertexArray& vertices) const;
+    void AddFences(const sf::FloatRect& chunk, sf::Vector2f worldSize, decorationBatch& batch) const;
 
 };
@@ -0,0 +1,186 @@
+#include "entity_store.h"
+#include <cmath>
+
+EntityId EntityStore::Create(EntityKind entityKind, int entityNetId, sf::Vector2f entityPosition)
+{
+    uint32_t slot;
+    if (!freeIds.empty())
+    {
+        slot = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(sparse.size());
+        sparse.push_back(NO_INDEX);
+        generations.push_back(0);
+    }
+
+    sparse[slot] = static_cast<uint32_t>(ids.size());
+    const EntityId id = {slot, generations[slot]};
+
+    ids.push_back(id);
+    kind.push_back(entityKind);
+    netId.push_back(entityNetId);
+    owner.push_back(-1);
+    position.push_back(entityPosition);
+    bodyRotation.push_back(0.f);
+    barrelRotation.push_back(0.f);
+    velocity.push_back({0.f, 0.f});
+    health.push_back(0);
+    ammo.push_back(0);
+    render.push_back(0);
+    fixedPosition.push_back({});
+    fixedVelocity.push_back({});
+    fixedBody.push_back(0);
+    fixedBarrel.push_back(0);
+
+    return id;
+}
+
+void EntityStore::Destroy(EntityId id)
+{
+    if (Contains(id))
+        DestroyAt(sparse[id.slot]);
+}
+
+void EntityStore::DestroyAt(std::size_t index)
+{
+    const std::size_t last = ids.size() - 1;
+
+    sparse[ids[index].slot] = NO_INDEX;
+    generations[ids[index].slot]++;
+    freeIds.push_back(ids[index].slot);
+
+    if (index != last)
+    {
+        ids[index] = ids[last];
+        kind[index] = kind[last];
+        netId[index] = netId[last];
+        owner[index] = owner[last];
+        position[index] = position[last];
+        bodyRotation[index] = bodyRotation[last];
+        barrelRotation[index] = barrelRotation[last];
+        velocity[index] = velocity[last];
+        health[index] = health[last];
+        ammo[index] = ammo[last];
+        render[index] = render[last];
+        fixedPosition[index] = fixedPosition[last];
+        fixedVelocity[index] = fixedVelocity[last];
+        fixedBody[index] = fixedBody[last];
+        fixedBarrel[index] = fixedBarrel[last];
+
+        sparse[ids[index].slot] = static_cast<uint32_t>(index);
+    }
+
+    ids.pop_back();
+    kind.pop_back();
+    netId.pop_back();
+    owner.pop_back();
+    position.pop_back();
+    bodyRotation.pop_back();
+    barrelRotation.pop_back();
+    velocity.pop_back();
+    health.pop_back();
+    ammo.pop_back();
+    render.pop_back();
+    fixedPosition.pop_back();
+    fixedVelocity.pop_back();
+    fixedBody.pop_back();
+    fixedBarrel.pop_back();
+}
+
+void EntityStore::Reserve(std::size_t count)
+{
+    ids.reserve(count);
+    kind.reserve(count);
+    netId.reserve(count);
+    owner.reserve(count);
+    position.reserve(count);
+    bodyRotation.reserve(count);
+    barrelRotation.reserve(count);
+    velocity.reserve(count);
+    health.reserve(count);
+    ammo.reserve(count);
+    render.reserve(count);
+    fixedPosition.reserve(count);
+    fixedVelocity.reserve(count);
+    fixedBody.reserve(count);
+    fixedBarrel.reserve(count);
+    sparse.reserve(count);
+    generations.reserve(count);
+    freeIds.reserve(count);
+}
+
+sf::FloatRect EntityBounds(sf::Vector2f position, float size, float rotation)
+{
+    const float radians = rotation * 3.14159265f / 180.f;
+    const float extent = (std::abs(std::cos(radians)) + std::abs(std::sin(radians))) * size * 0.5f;
+
+    return {{position.x - extent, position.y - extent}, {extent * 2.f, extent * 2.f}};
+}
+
+sf::FloatRect FixedEntityBounds(FixedVec position, float size, FixedAngle rotation)
+{
+    const Fixed turned = std::abs(FixedCos(rotation)) + std::abs(FixedSin(rotation));
+    const float extent = ToFloat(FixedMul(turned, ToFixed(size * 0.5f)));
+    const sf::Vector2f centre = {ToFloat(position.x), ToFloat(position.y)};
+
+    return {{centre.x - extent, centre.y - extent}, {extent * 2.f, extent * 2.f}};
+}
+
+void IntegrateVelocities(EntityStore& store, float dt)
+{
+    IntegrateVelocities(store, dt, 0, store.GetCount());
+}
+
+void IntegrateVelocities(EntityStore& store, float dt, std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; i++)
+    {
+        store.position[i] += store.velocity[i] * dt;
+    }
+}
+
+void SnapToFixed(EntityStore& store, std::size_t index)
+{
+    store.fixedPosition[index] = {ToFixed(store.position[index].x), ToFixed(store.position[index].y)};
+    store.fixedBody[index] = AngleFromDegrees(store.bodyRotation[index]);
+    store.fixedBarrel[index] = AngleFromDegrees(store.barrelRotation[index]);
+    SyncFromFixed(store, index);
+}
+
+void IntegrateFixedVelocities(EntityStore& store)
+{
+    IntegrateFixedVelocities(store, 0, store.GetCount());
+}
+
+void IntegrateFixedVelocities(EntityStore& store, std::size_t begin, std::size_t end)
+{
+    for (std::size_t i = begin; i < end; i++)
+    {
+        store.fixedPosition[i] += store.fixedVelocity[i];
+        store.position[i] = {ToFloat(store.fixedPosition[i].x), ToFloat(store.fixedPosition[i].y)};
+    }
+}
+
+void SyncFromFixed(EntityStore& store, std::size_t index)
+{
+    store.position[index] = {ToFloat(store.fixedPosition[index].x), ToFloat(store.fixedPosition[index].y)};
+    store.bodyRotation[index] = AngleToDegrees(store.fixedBody[index]);
+    store.barrelRotation[index] = AngleToDegrees(store.fixedBarrel[index]);
+}
+
+void HashEntities(StateHash& hash, const EntityStore& store)
+{
+    hash.Add(static_cast<uint32_t>(store.GetCount()));
+
+    for (std::size_t i = 0; i < store.GetCount(); i++)
+    {
+        hash.Add(static_cast<uint32_t>(store.netId[i]));
+        hash.Add(store.fixedPosition[i]);
+        hash.Add(store.fixedVelocity[i]);
+        hash.Add(static_cast<uint32_t>(store.fixedBody[i]) << 16 | store.fixedBarrel[i]);
+        hash.Add(static_cast<uint32_t>(static_cast<uint16_t>(store.health[i])) << 16 | static_cast<uint16_t>(store.ammo[i]));
+    }
+}
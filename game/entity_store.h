@@ -0,0 +1,109 @@
+#pragma once
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <vector>
+#include "fixed_math.h"
+#include "slot_map.h"
+
+enum class EntityKind : uint8_t
+{
+    Tank,
+    Bullet,
+    AmmoBox,
+    HealthKit
+};
+
+// Stable name of an entity, its column index changes when another one is destroyed. Same
+// generation check as a SlotMap, an id kept past Destroy is no longer Contained
+using EntityId = SlotHandle;
+constexpr EntityId NO_ENTITY = {};
+
+// What a client draws the entity with, the colour index for tanks
+using RenderHandle = uint8_t;
+
+// Square collision sizes, the sizes of the textures the clients draw. Tank textures vary by a
+// couple of pixels between colours, one size is close enough on the server
+constexpr float TANK_SIZE = 40.f;
+constexpr float BULLET_SIZE = 16.f;
+constexpr float PICKUP_SIZE = 32.f;
+
+// Entities as parallel columns, one element per entity. Systems walk the columns they need
+// from 0 to GetCount(), nothing is behind a pointer and a dead entity leaves no hole: Destroy
+// moves the last one into its place. Keep one store per kind of entity (tanks, bullets,
+// pickups) so every walk only touches the entities it is about
+class EntityStore
+{
+public:
+    EntityId Create(EntityKind kind, int netId, sf::Vector2f position);
+    void Destroy(EntityId id);
+    void DestroyAt(std::size_t index);
+    void Reserve(std::size_t count);
+
+    bool Contains(EntityId id) const
+    {
+        return id.slot < sparse.size() && generations[id.slot] == id.generation && sparse[id.slot] != NO_INDEX;
+    }
+    std::size_t IndexOf(EntityId id) const { return sparse[id.slot]; }
+    std::size_t GetCount() const { return ids.size(); }
+
+    // Identity
+    std::vector<EntityId> ids;
+    std::vector<EntityKind> kind;
+    std::vector<int> netId;      // id in the protocol: player, bullet or pickup id
+    std::vector<int> owner;      // player that fired a bullet, -1 for the rest
+
+    // Transform, rotations in degrees
+    std::vector<sf::Vector2f> position;
+    std::vector<float> bodyRotation;
+    std::vector<float> barrelRotation;
+    std::vector<sf::Vector2f> velocity;
+
+    // Vitals, only tanks use them
+    std::vector<int16_t> health;
+    std::vector<int16_t> ammo;
+
+    std::vector<RenderHandle> render;
+
+    // Deterministic simulation (DETERMINISTIC_SIM), the real state when it is on and the float
+    // transform above only follows it. Velocity is per tick
+    std::vector<FixedVec> fixedPosition;
+    std::vector<FixedVec> fixedVelocity;
+    std::vector<FixedAngle> fixedBody;
+    std::vector<FixedAngle> fixedBarrel;
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    // By slot
+    std::vector<uint32_t> sparse;   // column index
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> freeIds;
+};
+
+// Axis aligned box around a square of that size turned by rotation, what sf::Sprite's global
+// bounds give for a centred origin
+sf::FloatRect EntityBounds(sf::Vector2f position, float size, float rotation);
+
+// EntityBounds from the fixed columns, with table trigonometry
+sf::FloatRect FixedEntityBounds(FixedVec position, float size, FixedAngle rotation);
+
+// position += velocity * dt for every entity of the store, or for the columns [begin, end)
+// so ranges can run on different threads
+void IntegrateVelocities(EntityStore& store, float dt);
+void IntegrateVelocities(EntityStore& store, float dt, std::size_t begin, std::size_t end);
+
+// Deterministic mode: quantises one entity's float transform into the fixed columns and
+// writes the floats back from them. For state that comes from outside the simulation
+// (client tank updates, spawns, pickups moving)
+void SnapToFixed(EntityStore& store, std::size_t index);
+
+// Deterministic mode: fixed position += fixed velocity, floats rewritten from the result
+void IntegrateFixedVelocities(EntityStore& store);
+void IntegrateFixedVelocities(EntityStore& store, std::size_t begin, std::size_t end);
+
+// Writes the float transform of one entity from its fixed columns
+void SyncFromFixed(EntityStore& store, std::size_t index);
+
+// Adds the fixed state of every entity, in column order
+void HashEntities(StateHash& hash, const EntityStore& store);
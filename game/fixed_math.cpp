@@ -0,0 +1,109 @@
+#include "fixed_math.h"
+#include <array>
+
+namespace
+{
+    constexpr int SIN_TABLE_BITS = 10;
+    constexpr int SIN_TABLE_SIZE = 1 << SIN_TABLE_BITS;
+    constexpr int SIN_STEP_BITS = 16 - SIN_TABLE_BITS;   // angle bits between two entries
+
+    // Built by the compiler with integers only, so no std::sin is ever involved. Taylor series
+    // in 2.30 fixed point over the first quarter, the rest by symmetry
+    constexpr int64_t MulQ30(int64_t a, int64_t b) { return (a * b) >> 30; }
+
+    constexpr int64_t SinQ30(int64_t x)
+    {
+        const int64_t x2 = MulQ30(x, x);
+        int64_t term = x;
+        int64_t sum = x;
+        for (int n = 1; n <= 7; n++)
+        {
+            term = -MulQ30(term, x2) / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr std::array<Fixed, SIN_TABLE_SIZE> BuildSinTable()
+    {
+        constexpr int QUARTER = SIN_TABLE_SIZE / 4;
+        constexpr int64_t HALF_PI_Q30 = 1686629713;
+
+        std::array<Fixed, QUARTER + 1> quarter = {};
+        for (int i = 0; i <= QUARTER; i++)
+        {
+            const int64_t value = SinQ30(HALF_PI_Q30 * i / QUARTER);
+            quarter[i] = static_cast<Fixed>((value + (int64_t{1} << (29 - FIXED_SHIFT))) >> (30 - FIXED_SHIFT));
+        }
+
+        std::array<Fixed, SIN_TABLE_SIZE> table = {};
+        for (int i = 0; i < SIN_TABLE_SIZE; i++)
+        {
+            const int j = i % QUARTER;
+            switch (i / QUARTER)
+            {
+                case 0: table[i] = quarter[j]; break;
+                case 1: table[i] = quarter[QUARTER - j]; break;
+                case 2: table[i] = -quarter[j]; break;
+                default: table[i] = -quarter[QUARTER - j]; break;
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<Fixed, SIN_TABLE_SIZE> SIN_TABLE = BuildSinTable();
+
+    static_assert(SIN_TABLE[0] == 0 && SIN_TABLE[SIN_TABLE_SIZE / 4] == FIXED_ONE);
+
+    // atan(2^-i) in turns of 65536
+    constexpr int CORDIC_STEPS = 16;
+    constexpr int CORDIC_ANGLES[CORDIC_STEPS] = {8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1, 1, 0};
+}
+
+Fixed FixedSin(FixedAngle angle)
+{
+    const int index = angle >> SIN_STEP_BITS;
+    const int between = angle & ((1 << SIN_STEP_BITS) - 1);
+
+    const Fixed from = SIN_TABLE[index];
+    const Fixed to = SIN_TABLE[(index + 1) & (SIN_TABLE_SIZE - 1)];
+
+    return from + (to - from) * between / (1 << SIN_STEP_BITS);
+}
+
+FixedAngle FixedAtan2(Fixed y, Fixed x)
+{
+    if (x == 0 && y == 0)
+        return 0;
+
+    int64_t vx = x;
+    int64_t vy = y;
+    int angle = 0;
+
+    // CORDIC only converges within about 99 degrees, start from the right half
+    if (vx < 0)
+    {
+        vx = -vx;
+        vy = -vy;
+        angle = 32768;
+    }
+
+    // Short vectors lose their low bits in the shifts, make them long first
+    while (vx < (int64_t{1} << 40) && vy < (int64_t{1} << 40) && vy > -(int64_t{1} << 40))
+    {
+        vx <<= 1;
+        vy <<= 1;
+    }
+
+    // Turn the vector onto the x axis, the turns add up to its angle
+    for (int i = 0; i < CORDIC_STEPS; i++)
+    {
+        const int64_t nx = vy > 0 ? vx + (vy >> i) : vx - (vy >> i);
+        const int64_t ny = vy > 0 ? vy - (vx >> i) : vy + (vx >> i);
+        angle += vy > 0 ? CORDIC_ANGLES[i] : -CORDIC_ANGLES[i];
+        vx = nx;
+        vy = ny;
+    }
+
+    return static_cast<FixedAngle>(angle);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Integer maths for the deterministic simulation (DETERMINISTIC_SIM). std::sin and friends
+// round differently between standard libraries and compilers may fuse float operations, so
+// the same inputs can give other floats on another build. Everything here is integer
+// arithmetic and gives the same bits everywhere. Right shifts of negative values are
+// arithmetic on every compiler we build with (and guaranteed from C++20)
+
+// World units in 20.12 fixed point, steps of 1/4096 px and room for differences across the
+// largest world (256 chunks of 320 px)
+using Fixed = int32_t;
+constexpr int FIXED_SHIFT = 12;
+constexpr Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+// Multiplying by a power of two is exact, so only the rounding to an integer is left and
+// lround does that the same way everywhere
+inline Fixed ToFixed(float value) { return static_cast<Fixed>(std::lround(value * FIXED_ONE)); }
+inline float ToFloat(Fixed value) { return static_cast<float>(value) / FIXED_ONE; }
+
+inline Fixed FixedMul(Fixed a, Fixed b) { return static_cast<Fixed>((static_cast<int64_t>(a) * b) >> FIXED_SHIFT); }
+
+struct FixedVec
+{
+    Fixed x = 0;
+    Fixed y = 0;
+
+    FixedVec operator+(FixedVec other) const { return {x + other.x, y + other.y}; }
+    FixedVec operator-(FixedVec other) const { return {x - other.x, y - other.y}; }
+    FixedVec& operator+=(FixedVec other) { x += other.x; y += other.y; return *this; }
+    FixedVec operator*(Fixed scale) const { return {FixedMul(x, scale), FixedMul(y, scale)}; }
+};
+
+// Angles as a fraction of a turn, 65536 to the turn so wrapping around is the uint16 overflow
+using FixedAngle = uint16_t;
+constexpr FixedAngle ANGLE_QUARTER = 16384;
+
+inline FixedAngle AngleFromDegrees(float degrees)
+{
+    return static_cast<FixedAngle>(std::llround(static_cast<double>(degrees) * 65536.0 / 360.0));
+}
+inline float AngleToDegrees(FixedAngle angle) { return static_cast<float>(angle) * (360.f / 65536.f); }
+
+// Signed shortest turn from one angle to the other
+inline int AngleDelta(FixedAngle from, FixedAngle to) { return static_cast<int16_t>(static_cast<FixedAngle>(to - from)); }
+
+// From a 1024 entry table, linear between entries, within 2 / FIXED_ONE of the real value
+Fixed FixedSin(FixedAngle angle);
+inline Fixed FixedCos(FixedAngle angle) { return FixedSin(static_cast<FixedAngle>(angle + ANGLE_QUARTER)); }
+
+// Unit vector pointing at angle, x to the right and y down like the screen
+inline FixedVec FixedDirection(FixedAngle angle) { return {FixedCos(angle), FixedSin(angle)}; }
+
+// Angle of the vector, CORDIC with shifts and adds only, within 4 / 65536 of a turn. 0 for a
+// zero vector
+FixedAngle FixedAtan2(Fixed y, Fixed x);
+
+// 64 bit FNV-1a over the values added, in the order they were added
+class StateHash
+{
+public:
+    void Add(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    void Add(FixedVec value)
+    {
+        Add(static_cast<uint32_t>(value.x));
+        Add(static_cast<uint32_t>(value.y));
+    }
+
+    uint64_t Get() const { return hash; }
+
+private:
+    uint64_t hash = 14695981039346656037ull;
+};
@@ -3,10 +3,13 @@
 //
 #include "game.h"
 #include "utils.h"
+#include "profiler.h"
+#include "perf_counters.h"
 
-Game::Game(int localPlayer)
-	: collisionManager(1280.f, 960.f), decoration(1280.f, 960.f), ui(uiFont),
-	localId(localPlayer)
+Game::Game(int localPlayer, std::size_t jobWorkers)
+	: ui(uiFont),
+	localId(localPlayer),
+	jobs(jobWorkers)
 
 {
 	// Initialise the background texture and sprite.
@@ -20,19 +23,20 @@ Game::Game(int localPlayer)
 	}
 
 	background.setTexture(backgroundTexture);
-	background.setTextureRect(sf::IntRect({0, 0}, {1280, 960}));
+	background.setTextureRect(sf::IntRect({0, 0}, static_cast<sf::Vector2i>(collisionManager.GetWorldSize())));
 
 
-	tanks[localId] = std::make_unique<Tank>("blue");
-	tanks[localId]->position = {640, 480};
+	PlayerTank& local = players.Emplace(localId);
+	local.playerId = localId;
+	local.tank = std::make_unique<Tank>("blue");
 
-	// Set default tank position to be the centre of the window.
-	tanks[localId]->position = {640, 480};
+	// Set default tank position to be the centre of the world.
+	local.tank->position = collisionManager.GetLayout().GetSpawnPoint();
 
 	sf::Vector2<float> size = {960.f, 720.f}; // camera size, I'm using same as window
 
 	camera.setSize(size);
-	camera.setCenter(tanks[localId]->position);
+	camera.setCenter(local.tank->position);
 
 	// Loading Fonts
 	if (!uiFont.openFromFile("Assets/MomoTrustDisplay-Regular.ttf"))
@@ -46,51 +50,82 @@ Game::Game(int localPlayer)
 // Function to Add tanks when they join in client
 void Game::AddTank(const int tankId, const std::string& tankColour) {
 
-	tanks[tankId] = std::make_unique<Tank>(tankColour);
-	tanks[tankId]->position = {640, 480};
+	// A tank added again for the same player starts over, interpolation included
+	PlayerTank& player = players.Emplace(tankId);
+	player.playerId = tankId;
+	player.tank = std::make_unique<Tank>(tankColour);
+	player.tank->position = collisionManager.GetLayout().GetSpawnPoint();
 
 	if (tankId == localId) {
-		camera.setCenter(tanks[localId]->position);
+		camera.setCenter(player.tank->position);
 	}
 	Utils::printMsg("Added tank " + std::to_string(tankId) + " with color: " + tankColour, success);
 }
 
+void Game::SetWorld(uint16_t seed, const ChunkLayout& layout, std::unique_ptr<MapFile> map)
+{
+	chunks.Reset(seed, layout, std::move(map), collisionManager);
+	collisionManager = CollisionManager(layout);
+	chunks.SetPickups(ammoBoxes, healthKits);
+
+	background.setTextureRect(sf::IntRect({0, 0}, static_cast<sf::Vector2i>(layout.GetWorldSize())));
+
+	// Joined before the world was known, move to the real spawn point (the server picks the same one)
+	Tank* local = FindTank(localId);
+	local->position = SpawnPointFor(chunks.GetMap(), layout, localId);
+	camera.setCenter(local->position);
+}
+
+Tank* Game::FindTank(int playerId)
+{
+	PlayerTank* player = players.Find(playerId);
+	return player ? player->tank.get() : nullptr;
+}
+
+sf::FloatRect Game::GetCameraRect() const
+{
+	return {camera.getCenter() - camera.getSize() / 2.f, camera.getSize()};
+}
+
 void Game::HandleEvents(const std::optional<sf::Event> event, int tankId)
 {
+	Tank* tank = FindTank(tankId);
+	if (!tank)
+		return;
 
 	if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
 		if (keyPressed->scancode == sf::Keyboard::Scancode::W) {
-			tanks[tankId]->isMoving.forward = true;
-			tanks[tankId]->isMoving.backward = false;
+			tank->isMoving.forward = true;
+			tank->isMoving.backward = false;
 		}
 		else if (keyPressed->scancode == sf::Keyboard::Scancode::S) {
-			tanks[tankId]->isMoving.forward = false;
-			tanks[tankId]->isMoving.backward = true;
+			tank->isMoving.forward = false;
+			tank->isMoving.backward = true;
 		}
 		if (keyPressed->scancode == sf::Keyboard::Scancode::A) {
-			tanks[tankId]->isMoving.left = true;
-			tanks[tankId]->isMoving.right = false;
+			tank->isMoving.left = true;
+			tank->isMoving.right = false;
 		}
 		else if (keyPressed->scancode == sf::Keyboard::Scancode::D) {
-			tanks[tankId]->isMoving.left = false;
-			tanks[tankId]->isMoving.right = true;
+			tank->isMoving.left = false;
+			tank->isMoving.right = true;
 		}
 
 		// Barrel Rotation
 
 		if (keyPressed->scancode == sf::Keyboard::Scancode::Right) {
-			tanks[tankId]->isAiming.right = true;
-			tanks[tankId]->isAiming.left = false;
+			tank->isAiming.right = true;
+			tank->isAiming.left = false;
 		} else if (keyPressed->scancode == sf::Keyboard::Scancode::Left)
 		{
-			tanks[tankId]->isAiming.left = true;
-			tanks[tankId]->isAiming.right = false;
+			tank->isAiming.left = true;
+			tank->isAiming.right = false;
 		}
 
 		if (keyPressed->scancode == sf::Keyboard::Scancode::Space)
 		{
-			if (tanks[tankId]->getAmmo() > 0)
-				tanks[tankId]->wantsToShoot = true;
+			if (tank->getAmmo() > 0)
+				tank->wantsToShoot = true;
 		}
 
 	}
@@ -98,122 +133,154 @@ void Game::HandleEvents(const std::optional<sf::Event> event, int tankId)
 	// Handle key release events passed from window.
 	else if (const auto* keyReleased = event->getIf<sf::Event::KeyReleased>()) {
 		if (keyReleased->scancode == sf::Keyboard::Scancode::W)
-			tanks[tankId]->isMoving.forward = false;
+			tank->isMoving.forward = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::S)
-			tanks[tankId]->isMoving.backward = false;
+			tank->isMoving.backward = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::A)
-			tanks[tankId]->isMoving.left = false;
+			tank->isMoving.left = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::D)
-			tanks[tankId]->isMoving.right = false;
+			tank->isMoving.right = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::Right)
-			tanks[tankId]->isAiming.right = false;
+			tank->isAiming.right = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::Left)
-			tanks[tankId]->isAiming.left = false;
+			tank->isAiming.left = false;
 		if (keyReleased->scancode == sf::Keyboard::Scancode::Space)
-			tanks[tankId]->wantsToShoot = false;
+			tank->wantsToShoot = false;
 	}
 
 }
 
 void Game::Update(float dt)
 {
+	PROFILE_ZONE("Game::Update");
+
 	collisionManager.ClearDynamicColliders();
 
-	for (auto& [id, tank] : tanks) {
+	// A player's tank and bullets only move themselves against rocks that stay put,
+	// so players are split over the jobs
+	jobs.ParallelFor(players.size(), PLAYER_GRAIN, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			PlayerTank& player = players[i];
+
+			if (player.playerId == localId)
+			{
+				// Local tank
+				player.tank->Update(dt, collisionManager);
+			} else
+			{
+				// Interpolate Remote Tanks
+				InterpolateRemoteTanks(collisionManager, dt, player);
+			}
 
-		if (id == localId)
-		{
-			// Local tank
-			tank->Update(dt, collisionManager);
-		} else
-		{
-			// Interpolate Remote Tanks
-			InterpolateRemoteTanks(collisionManager, dt, id);
+			player.tank->UpdateBullets(dt, collisionManager);
 		}
+	});
 
-		tank->UpdateBullets(dt, collisionManager);
+	// Bounds of every tank that can be hit, once a frame instead of once per bullet
+	hitTargets.clear();
+	for (PlayerTank& player : players) {
+		if (player.tank->IsAlive())
+			hitTargets.push_back({player.playerId, player.tank.get(), player.tank->GetBounds()});
 	}
 
-	// Check bullet collisions against all tanks
-	for (auto& [shooterId, shooterTank] : tanks) {
-		for (auto& bullet : shooterTank->bullets) {
+	// Check bullet collisions against all tanks, back on this thread so damage lands in player order
+	for (PlayerTank& shooter : players) {
+		for (auto& bullet : shooter.tank->bullets) {
 			if (!bullet->IsActive()) continue;
 
-			for (auto& [targetId, targetTank] : tanks) {
+			const sf::FloatRect bounds = bullet->GetBounds();
+			for (const HitTarget& target : hitTargets) {
 
-				if (targetId == shooterId) continue; // Skip self
-				if (!targetTank->IsAlive()) continue;
+				if (target.playerId == shooter.playerId) continue; // Skip self
 
-				bullet->CheckTankCollision(targetTank.get());
+				// A bullet is spent on the first tank it hits
+				if (bullet->CheckTankCollision(target.tank, target.bounds, bounds)) break;
 			}
 		}
 
 	}
 
+	Tank& local = *FindTank(localId);
+	camera.setCenter(local.position);
+
+	// Load and unload chunks around the camera before anything else looks at them
+	chunks.Update(GetCameraRect(), collisionManager, decoration);
 
-	camera.setCenter(tanks[localId]->position);
+	ui.Update(local);
 
-	for (auto& ammoBox : ammoBoxes)
+	PerfCounters& perf = GetPerfCounters();
+	if (perf.enabled)
 	{
-	 	if (tanks[localId]->CheckPickupCollision(ammoBox.get()))
-	 	{
-	 		// 0 is ammo box
-			OnPickupCollected(ammoBox->GetPickupId(), 0);
-	 	}
+		CountInterpolation(perf);
 	}
+}
 
-	for (auto& healthKit : healthKits)
+void Game::CountInterpolation(PerfCounters& counters)
+{
+	bool any = false;
+	int depth = 0;
+	float progress = 0.f;
+
+	for (const PlayerTank& player : players)
 	{
-		if (tanks[localId]->CheckPickupCollision(healthKit.get()))
-		{
-			// 1 is health kit
-			OnPickupCollected(healthKit->GetPickupId(), 1);
-		}
-	}
+		if (player.playerId == localId)
+			continue;
+
+		const float through = player.states > 0 ? player.interpClock.getElapsedTime().asSeconds() / INTERP_TIME : 0.f;
 
-	ui.Update(*tanks[localId]);
+		depth = any ? std::min(depth, player.states) : player.states;
+		progress = std::max(progress, through);
+		any = true;
+	}
 
+	counters.interpDepth = depth;
+	counters.interpProgress = progress;
 }
 
 // Interpolation stuff
-void Game::InterpolateRemoteTanks(CollisionManager& collisionManager, float dt, int tankID)
+void Game::InterpolateRemoteTanks(CollisionManager& collisionManager, float dt, PlayerTank& player)
 {
-	if (previousStates.find(tankID) == previousStates.end() || targetStates.find(tankID) == targetStates.end())
+	if (player.states < 2)
 	{
 		// Theres no data yet
 		return;
 	}
 
-	auto& prevState = previousStates[tankID];
-	auto& targetState = targetStates[tankID];
-	auto& clock = interpClocks[tankID];
+	const RemoteTankData& prevState = player.previousState;
+	const RemoteTankData& targetState = player.targetState;
+	Tank& tank = *player.tank;
 
-	float elapsedTime = clock.getElapsedTime().asSeconds();
+	float elapsedTime = player.interpClock.getElapsedTime().asSeconds();
 	float currentTime = std::min(elapsedTime / INTERP_TIME, 1.0f);
 
-	// Linear lerp position
-	tanks[tankID]->position = prevState.position + (targetState.position - prevState.position) * currentTime;
-	// Lerp for angles
-	tanks[tankID]->bodyRotation = findLerpAngle(prevState.bodyRotation, targetState.bodyRotation, currentTime);
-	tanks[tankID]->barrelRotation = findLerpAngle(prevState.barrelRotation, targetState.barrelRotation, currentTime);
+	// Linear lerp position and lerp for angles, through SetPose so the sprites follow even
+	// when the tank is dead and Update leaves them alone
+	tank.SetPose(prevState.position + (targetState.position - prevState.position) * currentTime,
+	             findLerpAngle(prevState.bodyRotation, targetState.bodyRotation, currentTime),
+	             findLerpAngle(prevState.barrelRotation, targetState.barrelRotation, currentTime));
 
-	tanks[tankID]->Update(dt, collisionManager);
+	tank.Update(dt, collisionManager);
 }
 
 void Game::AddNetworkTankState(int tankID, const GameSnapMessage::Player& state)
 {
-	if (targetStates.find(tankID) != targetStates.end()) {
-		previousStates[tankID] = targetStates[tankID];
+	PlayerTank* player = players.Find(tankID);
+	if (!player)
+		return;
+
+	if (player->states > 0) {
+		player->previousState = player->targetState;
 	}
+	player->states = std::min(player->states + 1, 2);
 
 	RemoteTankData newState;
 	newState.position = {state.x, state.y};
 	newState.bodyRotation = sf::degrees(state.rotationBody);
 	newState.barrelRotation = sf::degrees(state.rotationBarrel);
-	targetStates[tankID] = newState;
+	player->targetState = newState;
 
 	// Restart interpolation timer
-	interpClocks[tankID].restart();
+	player->interpClock.restart();
 }
 
 sf::Angle Game::findLerpAngle(sf::Angle angle1, sf::Angle angle2, float t)
@@ -238,23 +305,20 @@ sf::Angle Game::findLerpAngle(sf::Angle angle1, sf::Angle angle2, float t)
 
 void Game::Render(sf::RenderWindow& window)
 {
+	PROFILE_ZONE("Game::Render");
+
 	window.clear(sf::Color(70, 130, 180));
 
 	window.setView(camera); // set the window to use the camera as viewport
 
-	window.draw(background);
+	CountedDraw(window, background);
 
-	decoration.Render(window);
-	for (const auto& obstacle : obstacles)
-	{
-		obstacle->Render(window, false);
-	}
-
-	RenderPickups(window);
+	// Sand, fences, rocks and pickups of the chunks on screen
+	chunks.Render(window, GetCameraRect(), decoration);
 
-	for (auto& [id, tank] : tanks) {
-		tank->Render(window);
-		tank->RenderBullets(window);
+	for (PlayerTank& player : players) {
+		player.tank->Render(window);
+		player.tank->RenderBullets(window);
 	}
 
 	window.setView(window.getDefaultView());
@@ -273,11 +337,7 @@ void Game::CreatePickups(PickUpMessage& msg)
 		if (pickupData.pickUpType == 0)
 		{
 			// Create Ammo Box
-			auto ammo = std::make_unique<class ammoBox>(
-				pos,
-				WORLD_WIDTH,
-				WORLD_HEIGHT
-			);
+			auto ammo = std::make_unique<class ammoBox>(pos);
 			ammo->SetPickupId(pickupData.pickUpId);
 			ammoBoxes.push_back(std::move(ammo));
 
@@ -285,26 +345,11 @@ void Game::CreatePickups(PickUpMessage& msg)
 		{
 			// Create HealthKjt
 
-			auto health = std::make_unique<class healthKit>(
-				pos,
-				WORLD_WIDTH,
-				WORLD_HEIGHT
-			);
+			auto health = std::make_unique<class healthKit>(pos);
 			health->SetPickupId(pickupData.pickUpId);
 			healthKits.push_back(std::move(health));
 		}
 	}
-}
 
-void Game::RenderPickups(sf::RenderWindow& window)
-{
-	for (const auto& ammoBox : ammoBoxes)
-	{
-		ammoBox->Render(window);
-	}
-
-	for (const auto& healthKit : healthKits)
-	{
-		healthKit->Render(window);
-	}
+	UpdatePickupChunks();
 }
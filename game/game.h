@@ -3,18 +3,22 @@
 #include <vector>
 #include <memory>
 #include "ammoBox.h"
+#include "chunk_streamer.h"
 #include "collision_manager.h"
 #include "decorations.h"
 #include "gameUI.h"
 #include "healthKit.h"
+#include "job_system.h"
 #include "obstacle.h"
+#include "slot_map.h"
 #include "tank.h"
 #include "random"
 
 class Game
 {
 public:
-    explicit Game(int localPlayer);
+    // Worker threads for the per player updates, 0 keeps them on the main thread
+    explicit Game(int localPlayer, std::size_t jobWorkers = 0);
 
     void HandleEvents(std::optional<sf::Event> event, int tankId);
     void Update(float dt);
@@ -23,19 +27,23 @@ public:
 
     void CreatePickups(PickUpMessage& msg);
     int localId;
-    std::unordered_map<int, std::unique_ptr<Tank>> tanks;
+
+    // Null when the player has no tank, looking one up never adds it
+    Tank* FindTank(int playerId);
 
     CollisionManager collisionManager;
 
-    // Vector of obstacles to store them and render them all in a foreach loop
-    std::vector<std::unique_ptr<obstacle>> obstacles;
+    // World size and rocks from the server (ObstacleSeedMessage), chunks stream in around the camera.
+    // A map replaces the generated rocks
+    void SetWorld(uint16_t seed, const ChunkLayout& layout, std::unique_ptr<MapFile> map = nullptr);
 
 
     // Bullet boxes and Health
     std::vector<std::unique_ptr<ammoBox>> ammoBoxes;
     std::vector<std::unique_ptr<healthKit>> healthKits;
 
-    std::function<void(uint8_t pickupId, uint8_t pickupType)> OnPickupCollected;
+    // Call after moving a pickup, they are drawn by chunk
+    void UpdatePickupChunks() { chunks.SetPickups(ammoBoxes, healthKits); }
 
     // Interpolation logic
 
@@ -47,15 +55,34 @@ public:
         sf::Time timestamp;
     };
 
-    std::unordered_map<int, RemoteTankData> previousStates;
-    std::unordered_map<int, RemoteTankData> targetStates;
-    std::unordered_map<int, sf::Clock> interpClocks;
+    // A player's tank and, for remote ones, the two snapshot states it is drawn between
+    struct PlayerTank
+    {
+        int playerId;
+        std::unique_ptr<Tank> tank;
+
+        RemoteTankData previousState;
+        RemoteTankData targetState;
+        int states = 0;   // snapshots held, up to 2, interpolation needs both
+        sf::Clock interpClock;
+    };
+
+    // By player id, packed so the per frame walks over every tank are a linear scan
+    PlayerSlots<PlayerTank> players;
 
     // this is the interpolation window in seconds
     const float INTERP_TIME = 0.2f;
 
     void AddNetworkTankState(int tankId, const GameSnapMessage::Player& state);
 
+    // HUD elements that live outside the game (network stats...)
+    hudWidget& AddHudWidget(std::unique_ptr<hudWidget> widget) { return ui.AddWidget(std::move(widget)); }
+    const sf::Font& GetUIFont() const { return uiFont; }
+
+    // Performance overlay, shown and hidden with F3
+    void SetPerfOverlay(std::unique_ptr<hudPerfOverlay> overlay) { ui.SetPerfOverlay(std::move(overlay)); }
+    void TogglePerfOverlay() { ui.TogglePerfOverlay(); }
+
 private:
 
     sf::View camera; // Camera for the game
@@ -64,10 +91,13 @@ private:
     sf::Texture placeholder = sf::Texture(sf::Vector2u(1, 1));
     sf::Texture backgroundTexture;
 
-    void RenderPickups(sf::RenderWindow& window);
-
     decorations decoration;
 
+    // Rocks, decoration batches and pickups by chunk
+    ChunkStreamer chunks;
+
+    sf::FloatRect GetCameraRect() const;
+
     // This can (and probably should) be replaced with std::optional or a unique pointer,
     // to remove the need to use placeholder textures for sprite initialisation.
     sf::Sprite background = sf::Sprite(placeholder);
@@ -76,13 +106,25 @@ private:
 
     gameUI ui;
 
-    const float WORLD_WIDTH = 1280.f;
-    const float WORLD_HEIGHT = 960.f;
-
     // Interpolation
-    void InterpolateRemoteTanks(CollisionManager& collisionManager, float dt, int tankID);
+    void InterpolateRemoteTanks(CollisionManager& collisionManager, float dt, PlayerTank& player);
 
     sf::Angle findLerpAngle(sf::Angle angle1, sf::Angle angle2, float t);
 
+    // Interpolation buffer numbers for the perf overlay, only run while it is shown
+    void CountInterpolation(PerfCounters& counters);
+
+    // Players per job, a few tanks are not worth waking the workers for
+    static constexpr std::size_t PLAYER_GRAIN = 8;
+    JobSystem jobs;
+
+    // Tanks bullets can hit this frame, bounds worked out once. Kept so it stops allocating
+    struct HitTarget
+    {
+        int playerId;
+        Tank* tank;
+        sf::FloatRect bounds;
+    };
+    std::vector<HitTarget> hitTargets;
 
 };
\ No newline at end of file
@@ -3,97 +3,351 @@
 //
 
 #include "gameUI.h"
+#include "profiler.h"
 #include <SFML/Graphics/RenderWindow.hpp>
-#include <sstream>
+#include <algorithm>
+#include <cstdio>
 
-gameUI::gameUI(const sf::Font& f)
-    : healthText(f), ammoText(f)
+// Margin from the edges
+static constexpr float HUD_MARGIN = 10.f;
+// Space between stacked widgets
+static constexpr float HUD_SPACING = 5.f;
+
+// Perf overlay layout, the graph is scaled so the top is PERF_GRAPH_MAX seconds
+static constexpr float PERF_WIDTH = 280.f;
+static constexpr float PERF_PADDING = 6.f;
+static constexpr float PERF_GRAPH_HEIGHT = 60.f;
+static constexpr float PERF_GRAPH_MAX = 0.05f;
+static constexpr float PERF_TEXT_INTERVAL = 0.25f;
+
+// Copies the formatted text into content and hands it to the sf::Text, without allocating once
+// PrewarmHudText has run. A sf::String made from the char buffer would be a new one each time,
+// content is cleared instead and keeps its capacity, and the sf::Text copies it into a string
+// that is already big enough. Glyphs are all in the font already, so the layout at the next
+// draw only refills vertex arrays of the size they had
+static void SetHudText(sf::Text& text, sf::String& content, const char* buffer)
 {
-    // Health text setup
-    healthText.setCharacterSize(20);
-    healthText.setFillColor(sf::Color::Green);
-    healthText.setOutlineThickness(2.f);  // Outline thickness in pixels
-    healthText.setOutlineColor(sf::Color::Black);  // Outline color
+    content.clear();
+    for (const char* c = buffer; *c != '\0'; c++)
+    {
+        // One character fits in the small string buffer, this does not allocate either
+        content += sf::String(static_cast<char32_t>(*c));
+    }
 
-    // Ammo text setup
-    ammoText.setCharacterSize(20);
-    ammoText.setFillColor(sf::Color::Yellow);
-    ammoText.setOutlineThickness(2.f);
-    ammoText.setOutlineColor(sf::Color::Black);
+    text.setString(content);
 }
 
-void gameUI::Update(Tank& tank)
+// Lays the text out once with maxLength characters covering every printable ASCII character,
+// after its size and outline are set. The font renders every glyph the formats can produce,
+// and the strings and vertex arrays reach their full size here instead of in a frame
+static void PrewarmHudText(sf::Text& text, sf::String& content, std::size_t maxLength)
 {
-    // Convert health and ammo to strings
-    std::stringstream ssHealth;
-    ssHealth << "Health: " << tank.getHealth() << "%";
+    const std::size_t printable = '~' - '!' + 1;
+    const std::size_t length = std::max(maxLength, printable);
+
+    content.clear();
+    for (std::size_t i = 0; i < length; i++)
+    {
+        content += sf::String(static_cast<char32_t>('!' + i % printable));
+    }
 
-    std::stringstream ssAmmo;
-    ssAmmo << "Ammo: " << tank.getAmmo();
+    text.setString(content);
+    text.getLocalBounds();  // builds the geometry, which is what loads the glyphs
 
-    // Update text
-    healthText.setString(ssHealth.str());
-    ammoText.setString(ssAmmo.str());
+    // Emptied again, the first Update fills it for real
+    content.clear();
+    text.setString(content);
+}
 
-    // Calculate health percentage
-    float healthPercentage = static_cast<float>(tank.getHealth()) / static_cast<float>(tank.getMaxHealth());
+hudStat::hudStat(const sf::Font& font, const char* format, Getter value, Getter maxValue, sf::Color fullColor)
+    : text(font), format(format), value(value), maxValue(maxValue), fullColor(fullColor)
+{
+    text.setCharacterSize(20);
+    text.setFillColor(fullColor);
+    text.setOutlineThickness(2.f);  // Outline thickness in pixels
+    text.setOutlineColor(sf::Color::Black);  // Outline color
 
-    // Set health color based on percentage
-    if (healthPercentage > 0.666f) // Above 2/3
+    PrewarmHudText(text, content, sizeof(buffer) - 1);
+}
+
+void hudStat::Update(Tank& tank)
+{
+    const int current = (tank.*value)();
+    const int max = (tank.*maxValue)();
+
+    // Nothing changed, keep the glyphs we already have
+    if (current == lastValue && max == lastMax)
+        return;
+
+    lastValue = current;
+    lastMax = max;
+
+    std::snprintf(buffer, sizeof(buffer), format, current);
+    SetHudText(text, content, buffer);
+
+    // Set color based on percentage
+    const float percentage = max > 0 ? static_cast<float>(current) / static_cast<float>(max) : 0.f;
+
+    if (percentage > 0.666f) // Above 2/3
     {
-        healthText.setFillColor(sf::Color::Green);
+        text.setFillColor(fullColor);
     }
-    else if (healthPercentage > 0.333f) // Above 1/3
+    else if (percentage > 0.333f) // Above 1/3
     {
-        healthText.setFillColor(sf::Color::Yellow);
+        text.setFillColor(sf::Color::Yellow);
     }
     else // Below 1/3
     {
-        healthText.setFillColor(sf::Color::Red);
+        text.setFillColor(sf::Color::Red);
+    }
+
+    MarkDirty();
+}
+
+void hudStat::Draw(sf::RenderWindow& window) const
+{
+    CountedDraw(window, text);
+}
+
+sf::Vector2f hudStat::GetSize() const
+{
+    return text.getLocalBounds().size;
+}
+
+void hudStat::SetPosition(sf::Vector2f position)
+{
+    text.setPosition(position);
+}
+
+hudNetStats::hudNetStats(const sf::Font& font, const LinkStats& stats)
+    : text(font), stats(stats)
+{
+    text.setCharacterSize(12);
+    text.setFillColor(sf::Color::White);
+    text.setOutlineThickness(1.f);
+    text.setOutlineColor(sf::Color::Black);
+
+    PrewarmHudText(text, content, sizeof(buffer) - 1);
+}
+
+void hudNetStats::Update(Tank&)
+{
+    const int rtt = static_cast<int>(stats.GetRtt() * 1000.f);
+    const int jitter = static_cast<int>(stats.GetJitter() * 1000.f);
+    const int loss = static_cast<int>(stats.GetLoss() * 100.f);
+    const int in = static_cast<int>(stats.GetBytesInRate() / 100.f);   // tenths of KB/s
+    const int out = static_cast<int>(stats.GetBytesOutRate() / 100.f);
+
+    if (rtt == lastRtt && jitter == lastJitter && loss == lastLoss && in == lastIn && out == lastOut)
+        return;
+
+    lastRtt = rtt;
+    lastJitter = jitter;
+    lastLoss = loss;
+    lastIn = in;
+    lastOut = out;
+
+    std::snprintf(buffer, sizeof(buffer), "RTT %d ms  Jitter %d ms  Loss %d%%  In %d.%d KB/s  Out %d.%d KB/s",
+                  rtt, jitter, loss, in / 10, in % 10, out / 10, out % 10);
+    SetHudText(text, content, buffer);
+
+    // Same thresholds people expect from other games
+    if (rtt > 150 || loss > 5)
+        text.setFillColor(sf::Color::Red);
+    else if (rtt > 80 || loss > 1)
+        text.setFillColor(sf::Color::Yellow);
+    else
+        text.setFillColor(sf::Color::White);
+
+    MarkDirty();
+}
+
+void hudNetStats::Draw(sf::RenderWindow& window) const
+{
+    CountedDraw(window, text);
+}
+
+sf::Vector2f hudNetStats::GetSize() const
+{
+    return text.getLocalBounds().size;
+}
+
+void hudNetStats::SetPosition(sf::Vector2f position)
+{
+    text.setPosition(position);
+}
+
+hudPerfOverlay::hudPerfOverlay(const sf::Font& font, const LinkStats& stats)
+    : text(font), graph(sf::PrimitiveType::LineStrip, PerfCounters::HISTORY),
+      budgetLines(sf::PrimitiveType::Lines, 4), stats(stats)
+{
+    text.setCharacterSize(12);
+    text.setFillColor(sf::Color::White);
+    text.setPosition({HUD_MARGIN + PERF_PADDING, HUD_MARGIN + PERF_PADDING});
+
+    // Also the first F3 press after the warm-up, the overlay may not have been shown before
+    PrewarmHudText(text, content, sizeof(buffer) - 1);
+
+    panel.setPosition({HUD_MARGIN, HUD_MARGIN});
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+}
+
+void hudPerfOverlay::UpdateText(const PerfCounters& counters)
+{
+    // Average and worst frame of the graph
+    const std::size_t frames = std::min(counters.frameIndex, PerfCounters::HISTORY);
+    float total = 0.f;
+    float worst = 0.f;
+    for (std::size_t i = 0; i < frames; i++)
+    {
+        total += counters.frameTimes[i];
+        worst = std::max(worst, counters.frameTimes[i]);
     }
+    const float average = frames > 0 ? total / static_cast<float>(frames) : 0.f;
 
-    // Calculate ammo percentage
-    float ammoPercentage = static_cast<float>(tank.getAmmo()) / static_cast<float>(tank.getMaxAmmo());
+    const float age = counters.lastSnapshotAt >= 0.f ? PerfCounters::Now() - counters.lastSnapshotAt : 0.f;
 
-    // Set ammo color based on percentage
-    if (ammoPercentage > 0.666f) // Above 2/3
+    std::snprintf(buffer, sizeof(buffer),
+                  "Frame %.2f ms avg  %.2f ms worst  (%.0f fps)\n"
+                  "Sim %.2f ms  Net %.2f ms  Render %.2f ms\n"
+                  "Draw calls %u\n"
+                  "Snapshot every %.1f ms (worst %.1f)  age %.1f ms\n"
+                  "Interp buffer %d states  %.0f%% through\n"
+                  "RTT %.0f ms  Jitter %.1f ms  Loss %.1f%%\n"
+                  "State hash %u",
+                  average * 1000.f, worst * 1000.f, average > 0.f ? 1.f / average : 0.f,
+                  counters.simTime * 1000.f, counters.netTime * 1000.f, counters.renderTime * 1000.f,
+                  counters.lastDrawCalls,
+                  counters.snapshotInterval * 1000.f, counters.worstSnapshotInterval * 1000.f, age * 1000.f,
+                  counters.interpDepth, counters.interpProgress * 100.f,
+                  stats.GetRtt() * 1000.f, stats.GetJitter() * 1000.f, stats.GetLoss() * 100.f,
+                  static_cast<unsigned>(counters.stateHash));
+    SetHudText(text, content, buffer);
+
+    const float textHeight = text.getLocalBounds().size.y;
+    panel.setSize({PERF_WIDTH, textHeight + PERF_GRAPH_HEIGHT + PERF_PADDING * 4.f});
+}
+
+void hudPerfOverlay::UpdateGraph(const PerfCounters& counters)
+{
+    const float left = HUD_MARGIN + PERF_PADDING;
+    const float width = PERF_WIDTH - PERF_PADDING * 2.f;
+    const float bottom = panel.getPosition().y + panel.getSize().y - PERF_PADDING;
+    const float step = width / static_cast<float>(PerfCounters::HISTORY - 1);
+
+    const auto heightOf = [&](float seconds) {
+        return bottom - std::min(seconds / PERF_GRAPH_MAX, 1.f) * PERF_GRAPH_HEIGHT;
+    };
+
+    // Oldest frame on the left
+    for (std::size_t i = 0; i < PerfCounters::HISTORY; i++)
     {
-        ammoText.setFillColor(sf::Color::White);
+        const float frame = counters.frameTimes[(counters.frameIndex + i) % PerfCounters::HISTORY];
+
+        graph[i].position = {left + step * static_cast<float>(i), heightOf(frame)};
+        graph[i].color = frame > 1.f / 30.f ? sf::Color::Red : frame > 1.f / 55.f ? sf::Color::Yellow : sf::Color::Green;
     }
-    else if (ammoPercentage > 0.333f) // Above 1/3
+
+    const float marks[] = {1.f / 60.f, 1.f / 30.f};
+    for (std::size_t i = 0; i < 2; i++)
     {
-        ammoText.setFillColor(sf::Color::Yellow);
+        budgetLines[i * 2].position = {left, heightOf(marks[i])};
+        budgetLines[i * 2 + 1].position = {left + width, heightOf(marks[i])};
+        budgetLines[i * 2].color = budgetLines[i * 2 + 1].color = sf::Color(255, 255, 255, 80);
     }
-    else // Below 1/3
+}
+
+void hudPerfOverlay::Draw(sf::RenderWindow& window)
+{
+    const PerfCounters& counters = GetPerfCounters();
+
+    const float now = PerfCounters::Now();
+    if (now >= nextTextUpdate)
     {
-        ammoText.setFillColor(sf::Color::Red);
+        nextTextUpdate = now + PERF_TEXT_INTERVAL;
+        UpdateText(counters);
     }
+
+    UpdateGraph(counters);
+
+    // Not counted, the overlay should not change the numbers it shows
+    window.draw(panel);
+    window.draw(budgetLines);
+    window.draw(graph);
+    window.draw(text);
 }
 
-void gameUI::Draw(sf::RenderWindow& window)
+gameUI::gameUI(const sf::Font& f)
 {
-    sf::Vector2u windowSize = window.getSize();
+    // Bottom of the stack first
+    AddWidget(std::make_unique<hudStat>(f, "Ammo: %d", &Tank::getAmmo, &Tank::getMaxAmmo, sf::Color::White));
+    AddWidget(std::make_unique<hudStat>(f, "Health: %d%%", &Tank::getHealth, &Tank::getMaxHealth, sf::Color::Green));
+}
 
-    // Margin from the edges
-    const float margin = 10.f;
+hudWidget& gameUI::AddWidget(std::unique_ptr<hudWidget> widget)
+{
+    widgets.push_back(std::move(widget));
+    return *widgets.back();
+}
 
-    // Get bounds to align to bottom right
-    sf::FloatRect ammoBounds = ammoText.getLocalBounds();
-    sf::FloatRect healthBounds = healthText.getLocalBounds();
+void gameUI::TogglePerfOverlay()
+{
+    if (!perfOverlay)
+        return;
 
-    // Position texts
-    ammoText.setPosition(
-{        windowSize.x - ammoBounds.size.x - margin,
-        windowSize.y - ammoBounds.size.y - margin}
-    );
+    PerfCounters& counters = GetPerfCounters();
+    counters.SetEnabled(!counters.enabled);
+}
 
-    healthText.setPosition(
-{        windowSize.x -  healthBounds.size.x - margin,
-        ammoText.getPosition().y - healthBounds.size.y - 5.f }
-    );
+void gameUI::Update(Tank& tank)
+{
+    // Widgets reuse their strings (SetHudText), a report naming this zone means one does not
+    PROFILE_ZONE("gameUI::Update");
 
-    // Draw on window
-    window.draw(healthText);
-    window.draw(ammoText);
+    for (auto& widget : widgets)
+    {
+        widget->Update(tank);
+    }
+}
+
+void gameUI::Layout(sf::Vector2u windowSize)
+{
+    const bool resized = windowSize != lastWindowSize;
+    lastWindowSize = windowSize;
+
+    // Every widget sits on top of the previous one, so only the first dirty one
+    // and whatever is stacked above it has to move
+    bool moveRest = resized;
+    float cursorY = windowSize.y - HUD_MARGIN;
+
+    for (auto& widget : widgets)
+    {
+        const sf::Vector2f size = widget->GetSize();
+        cursorY -= size.y;
+
+        if (moveRest || widget->IsDirty())
+        {
+            widget->SetPosition({windowSize.x - size.x - HUD_MARGIN, cursorY});
+            widget->ClearDirty();
+            moveRest = true;
+        }
+
+        cursorY -= HUD_SPACING;
+    }
 }
 
+void gameUI::Draw(sf::RenderWindow& window)
+{
+    Layout(window.getSize());
+
+    // Draw on window
+    for (const auto& widget : widgets)
+    {
+        widget->Draw(window);
+    }
+
+    if (perfOverlay && GetPerfCounters().enabled)
+    {
+        perfOverlay->Draw(window);
+    }
+}
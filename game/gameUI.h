@@ -4,11 +4,128 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <vector>
 #include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/Graphics/Text.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/System/String.hpp>
 #include <SFML/System/Vector2.hpp>
 
 #include "tank.h"
+#include "link_stats.h"
+#include "perf_counters.h"
+
+// Base for every HUD element. Widgets keep their own sf::Text / shapes alive between frames
+// and only mark themselves dirty when what they show actually changed, that way the HUD
+// only re-layouts the elements that need it instead of rebuilding everything every frame
+class hudWidget
+{
+public:
+    virtual ~hudWidget() = default;
+
+    // Pull the new values from the game state
+    virtual void Update(Tank& tank) = 0;
+    virtual void Draw(sf::RenderWindow& window) const = 0;
+
+    virtual sf::Vector2f GetSize() const = 0;
+    virtual void SetPosition(sf::Vector2f position) = 0;
+
+    bool IsDirty() const { return dirty; }
+    void ClearDirty() { dirty = false; }
+
+protected:
+    void MarkDirty() { dirty = true; }
+
+private:
+    bool dirty = true;
+};
+
+// Text widget showing a value out of a max ("Health: 80%"), coloured by how full it is.
+// The string is formatted into a fixed buffer and only pushed to the sf::Text on change.
+// Like every HUD text it goes through a sf::String kept between updates, see SetHudText
+class hudStat : public hudWidget
+{
+public:
+    using Getter = int (Tank::*)();
+
+    hudStat(const sf::Font& font, const char* format, Getter value, Getter maxValue, sf::Color fullColor);
+
+    void Update(Tank& tank) override;
+    void Draw(sf::RenderWindow& window) const override;
+
+    sf::Vector2f GetSize() const override;
+    void SetPosition(sf::Vector2f position) override;
+
+private:
+    sf::Text text;
+    sf::String content;
+
+    const char* format;
+    Getter value;
+    Getter maxValue;
+    sf::Color fullColor;
+
+    // Cached so we can skip the formatting and setString when nothing changed
+    int lastValue = -1;
+    int lastMax = -1;
+
+    char buffer[32] = {};
+};
+
+// Small text with the link quality to the server: "RTT 45 ms  Jitter 3 ms  Loss 0%  In 9.1 KB/s  Out 3.2 KB/s".
+// Values are rounded before comparing so it only re-formats when the shown text would change
+class hudNetStats : public hudWidget
+{
+public:
+    hudNetStats(const sf::Font& font, const LinkStats& stats);
+
+    void Update(Tank& tank) override;
+    void Draw(sf::RenderWindow& window) const override;
+
+    sf::Vector2f GetSize() const override;
+    void SetPosition(sf::Vector2f position) override;
+
+private:
+    sf::Text text;
+    sf::String content;
+    const LinkStats& stats;
+
+    int lastRtt = -1;
+    int lastJitter = -1;
+    int lastLoss = -1;
+    int lastIn = -1;
+    int lastOut = -1;
+
+    char buffer[96] = {};
+};
+
+// Panel in the top left corner for chasing stutter: frame time graph, sim / net / render split,
+// draw calls, snapshot interval and age, interpolation buffer, RTT and loss. Reads
+// PerfCounters, which are only filled while this is shown. The text is redone a few times
+// per second, the graph every frame
+class hudPerfOverlay
+{
+public:
+    hudPerfOverlay(const sf::Font& font, const LinkStats& stats);
+
+    void Draw(sf::RenderWindow& window);
+
+private:
+    sf::Text text;
+    sf::String content;
+    sf::RectangleShape panel;
+    sf::VertexArray graph;        // one point per frame of PerfCounters::HISTORY
+    sf::VertexArray budgetLines;  // 60 and 30 fps marks
+    const LinkStats& stats;
+
+    float nextTextUpdate = 0.f;
+    char buffer[384] = {};
+
+    void UpdateText(const PerfCounters& counters);
+    void UpdateGraph(const PerfCounters& counters);
+};
 
 class gameUI
 
@@ -20,9 +137,24 @@ public:
     void Update(Tank& tank);
     void Draw(sf::RenderWindow& window);
 
+    // Widgets are stacked upwards from the bottom right corner in the order they are added,
+    // future stuff like a scoreboard or kill feed just needs to implement hudWidget
+    hudWidget& AddWidget(std::unique_ptr<hudWidget> widget);
+
+    // The overlay needs the connection stats so the client hands it over, F3 shows and hides it
+    void SetPerfOverlay(std::unique_ptr<hudPerfOverlay> overlay) { perfOverlay = std::move(overlay); }
+    void TogglePerfOverlay();
+
 private:
 
     sf::Font font;
-    sf::Text healthText;
-    sf::Text ammoText;
+
+    std::vector<std::unique_ptr<hudWidget>> widgets;
+
+    std::unique_ptr<hudPerfOverlay> perfOverlay;
+
+    // Window size of the last layout, a resize forces every widget to be placed again
+    sf::Vector2u lastWindowSize = {0, 0};
+
+    void Layout(sf::Vector2u windowSize);
 };
@@ -5,10 +5,8 @@
 #include "healthKit.h"
 
 healthKit::healthKit(sf::Vector2f position,
-                     float worldWidth,
-                     float worldHeight,
                      int healAmount)
-    : pickUp("../Assets/FirstAid.png", position, worldWidth, worldHeight),
+    : pickUp("../Assets/FirstAid.png", position),
       healAmount(healAmount)
 {
 }
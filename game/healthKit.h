@@ -7,23 +7,17 @@
 
 #include "pickUp.h"
 
+constexpr int HEALTH_KIT_AMOUNT = 25;
+
 class healthKit: public pickUp
 {
     public:
         healthKit(sf::Vector2f position,
-                  float worldWidth = 1280.f,
-                  float worldHeight = 960.f,
-                  int healAmount = 25);
+                  int healAmount = HEALTH_KIT_AMOUNT);
 
         // Get the amount of health this kit provides
         int GetHealAmount() const { return healAmount; }
 
-        void SetPosition(sf::Vector2f position)
-            {
-                this->position = position;
-                sprite.setPosition(position);
-            };
-
     private:
         int healAmount;
 };
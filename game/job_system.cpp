@@ -0,0 +1,164 @@
+#include "job_system.h"
+#include "alloc_tracker.h"
+#include <algorithm>
+
+JobSystem::JobSystem(std::size_t workerCount)
+{
+    queues.reserve(workerCount + 1);
+    for (std::size_t i = 0; i < workerCount + 1; i++)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    workers.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::size_t JobSystem::WorkersFor(int configured)
+{
+    if (configured >= 0)
+        return static_cast<std::size_t>(configured);
+
+    // 0 when the count is unknown
+    const unsigned cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+void JobSystem::Run(Batch& batch, std::size_t count, std::size_t grain)
+{
+    const std::size_t jobCount = (count + grain - 1) / grain;
+    batch.remaining.store(jobCount, std::memory_order_relaxed);
+
+    // Neighbouring ranges on different queues, everyone starts with a share of its own
+    for (std::size_t i = 0; i < jobCount; i++)
+    {
+        const std::size_t begin = i * grain;
+        const Job job{&batch, begin, std::min(begin + grain, count)};
+
+        WorkerQueue& queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+
+    queued.fetch_add(jobCount, std::memory_order_release);
+    {
+        // Taken so a worker between checking queued and sleeping does not miss the wake up
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+
+    // The calling thread is the last queue, it helps until the batch is done
+    const std::size_t own = queues.size() - 1;
+    while (batch.remaining.load(std::memory_order_acquire) > 0)
+    {
+        Job job;
+        if (PopOwn(own, job) || Steal(own, job))
+            Execute(job, false);
+        else
+            std::this_thread::yield();
+    }
+
+    // Counted as if this thread had allocated it, so ALLOC_FRAME / ALLOC_STRICT still see it
+    AllocTracker::AddToThread({batch.workerAllocations.load(std::memory_order_relaxed),
+                               batch.workerBytes.load(std::memory_order_relaxed)});
+}
+
+void JobSystem::WorkerLoop(std::size_t index)
+{
+    while (true)
+    {
+        Job job;
+        if (PopOwn(index, job) || Steal(index, job))
+        {
+            Execute(job, true);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+bool JobSystem::PopOwn(std::size_t queue, Job& job)
+{
+    WorkerQueue& own = *queues[queue];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.head == own.jobs.size())
+        return false;
+
+    job = own.jobs.back();
+    own.jobs.pop_back();
+    if (own.head == own.jobs.size())
+    {
+        own.jobs.clear();
+        own.head = 0;
+    }
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::Steal(std::size_t thief, Job& job)
+{
+    // Starting after the thief, so thieves spread over the queues instead of all hitting the first
+    for (std::size_t i = 1; i < queues.size(); i++)
+    {
+        WorkerQueue& victim = *queues[(thief + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.head == victim.jobs.size())
+            continue;
+
+        job = victim.jobs[victim.head++];
+        if (victim.head == victim.jobs.size())
+        {
+            victim.jobs.clear();
+            victim.head = 0;
+        }
+
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::Execute(const Job& job, bool onWorker)
+{
+#ifdef TANK_ALLOC_TRACKING
+    const AllocTracker::Counts before = AllocTracker::GetThreadCounts();
+#endif
+
+    job.batch->run(job.batch->context, job.begin, job.end);
+
+#ifdef TANK_ALLOC_TRACKING
+    if (onWorker)
+    {
+        const AllocTracker::Counts after = AllocTracker::GetThreadCounts();
+        job.batch->workerAllocations.fetch_add(after.allocations - before.allocations, std::memory_order_relaxed);
+        job.batch->workerBytes.fetch_add(after.bytes - before.bytes, std::memory_order_relaxed);
+    }
+#else
+    (void)onWorker;
+#endif
+
+    // Last thing done with the batch, the caller may return and free it right after
+    job.batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
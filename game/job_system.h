@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Worker threads that split a loop over entities into ranges. Every worker has its own queue
+// and takes the newest range from it, a worker that runs dry steals the oldest range of
+// another one, so a slow range does not keep the rest waiting. The thread calling ParallelFor
+// works too and returns once every range is done.
+//
+// Ranges run in any order on any thread, so a range must only write what belongs to it (its
+// own columns, its own slots of a result array). Anything that depends on order (destroying,
+// sending, random numbers) is done afterwards on the calling thread, walking the results in
+// index order, and the outcome is the same as the serial loop whatever the thread count
+class JobSystem
+{
+public:
+    // 0 workers runs everything on the calling thread
+    explicit JobSystem(std::size_t workerCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Config value JOB_THREADS to a worker count, negative is one less than the cores so the
+    // calling thread has one to itself
+    static std::size_t WorkersFor(int configured);
+
+    std::size_t GetWorkerCount() const { return workers.size(); }
+
+    // Calls fn(begin, end) over [0, count) in ranges of grain entities. Counts up to grain stay
+    // on the calling thread, it is not worth waking anyone for them. One thread calls this at a
+    // time, never from inside fn, and fn must not throw. Nothing is allocated once the queues
+    // have grown to the largest loop
+    template <typename Fn>
+    void ParallelFor(std::size_t count, std::size_t grain, Fn&& fn)
+    {
+        if (count == 0)
+            return;
+
+        grain = grain > 0 ? grain : 1;
+        if (workers.empty() || count <= grain)
+        {
+            fn(std::size_t{0}, count);
+            return;
+        }
+
+        using Function = std::remove_reference_t<Fn>;
+        Batch batch;
+        batch.context = const_cast<void*>(static_cast<const void*>(&fn));
+        batch.run = [](void* context, std::size_t begin, std::size_t end) {
+            (*static_cast<Function*>(context))(begin, end);
+        };
+        Run(batch, count, grain);
+    }
+
+private:
+    // One ParallelFor, on the caller's stack until every range of it is done
+    struct Batch
+    {
+        void (*run)(void* context, std::size_t begin, std::size_t end) = nullptr;
+        void* context = nullptr;
+        std::atomic<std::size_t> remaining{0};
+
+        // What the ranges run on workers allocated, handed to the calling thread's
+        // ALLOC_FRAME once the batch is done (TANK_ALLOC_TRACKING builds only)
+        std::atomic<uint64_t> workerAllocations{0};
+        std::atomic<uint64_t> workerBytes{0};
+    };
+
+    struct Job
+    {
+        Batch* batch;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // Owner pushes and pops at the back, thieves take from head. On its own cache line so
+    // workers locking their queues do not slow each other down
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;
+        std::vector<Job> jobs;
+        std::size_t head = 0;
+    };
+
+    void Run(Batch& batch, std::size_t count, std::size_t grain);
+    void WorkerLoop(std::size_t index);
+
+    bool PopOwn(std::size_t queue, Job& job);
+    bool Steal(std::size_t thief, Job& job);
+    void Execute(const Job& job, bool onWorker);
+
+    // One per worker and the last one for the calling thread
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // Jobs sitting in a queue, workers sleep while it is 0
+    std::atomic<std::size_t> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
@@ -0,0 +1,97 @@
+#include "link_stats.h"
+#include <algorithm>
+#include <cmath>
+
+// Length of the window for rates and loss, in seconds
+static constexpr float STATS_WINDOW = 1.0f;
+
+static uint32_t ToMilliseconds(float seconds)
+{
+    return static_cast<uint32_t>(seconds * 1000.f);
+}
+
+PingHeader LinkStats::MakePingHeader(float now)
+{
+    PingHeader header;
+    header.sequence = nextSequence++;
+    header.time = std::max(1u, ToMilliseconds(now));
+
+    if (peerTime != 0)
+    {
+        header.echoTime = peerTime;
+        header.echoDelay = static_cast<uint16_t>(std::min(0xFFFFu, ToMilliseconds(now - peerTimeReceivedAt)));
+    }
+
+    return header;
+}
+
+void LinkStats::OnPingHeader(const PingHeader& header, float now)
+{
+    // Loss, anything newer than the highest seen tells us how many should have arrived
+    if (!hasSequence)
+    {
+        hasSequence = true;
+        highestSequence = header.sequence;
+        expected++;
+    }
+    else
+    {
+        const int16_t ahead = static_cast<int16_t>(header.sequence - highestSequence);
+        if (ahead > 0)
+        {
+            highestSequence = header.sequence;
+            expected += static_cast<uint32_t>(ahead);
+        }
+    }
+    received++;
+
+    if (header.time != 0)
+    {
+        peerTime = header.time;
+        peerTimeReceivedAt = now;
+    }
+
+    if (header.echoTime == 0)
+        return;
+
+    // Time on the wire both ways, minus the time the peer held our stamp
+    const uint32_t elapsed = ToMilliseconds(now) - header.echoTime;
+    if (header.echoDelay > elapsed)
+        return;
+
+    const float sample = static_cast<float>(elapsed - header.echoDelay) / 1000.f;
+    rttSampleCount++;
+
+    if (!hasRttSample)
+    {
+        hasRttSample = true;
+        smoothedRtt = sample;
+        lastRttSample = sample;
+        return;
+    }
+
+    jitter += (std::abs(sample - lastRttSample) - jitter) / 16.f;
+    smoothedRtt = 0.875f * smoothedRtt + 0.125f * sample;
+    lastRttSample = sample;
+}
+
+void LinkStats::Update(float now)
+{
+    const float elapsed = now - windowStart;
+    if (elapsed < STATS_WINDOW)
+        return;
+
+    rates.bytesIn = window.bytesIn / elapsed;
+    rates.bytesOut = window.bytesOut / elapsed;
+    rates.packetsIn = window.packetsIn / elapsed;
+    rates.packetsOut = window.packetsOut / elapsed;
+    window = Counters();
+
+    // Late or duplicated headers can make received go over expected
+    if (expected > 0)
+        loss = 1.f - std::min(1.f, static_cast<float>(received) / static_cast<float>(expected));
+
+    expected = 0;
+    received = 0;
+    windowStart = now;
+}
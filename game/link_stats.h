@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "message_schema.h"
+
+// Ping/pong that rides on snapshots (server -> client) and tank updates (client -> server).
+// Each side stamps its own clock and echoes the last stamp it got from the other side,
+// with how long it sat on it, so RTT is measured without extra messages
+struct PingHeader
+{
+    uint16_t sequence = 0;   // one per header sent, gaps on the other side are losses
+    uint32_t time = 0;       // sender clock in ms, 0 means not set
+    uint32_t echoTime = 0;   // last time received from the peer
+    uint16_t echoDelay = 0;  // ms between receiving echoTime and sending this header
+
+    static constexpr auto Fields() {
+        using M = PingHeader;
+        return std::make_tuple(schema::Field(&M::sequence), schema::Field(&M::time),
+                               schema::Field(&M::echoTime), schema::Field(&M::echoDelay));
+    }
+};
+
+constexpr std::size_t PING_HEADER_SIZE = schema::MaxEncodedSize<PingHeader>();
+
+// Link quality for one peer: RTT and jitter from the ping headers, loss from sequence
+// gaps, and bytes/packets both ways. Rates and loss are worked out once per second
+class LinkStats
+{
+public:
+    PingHeader MakePingHeader(float now);
+    void OnPingHeader(const PingHeader& header, float now);
+
+    // Whole datagrams, as handed to or read from the socket
+    void OnSent(std::size_t bytes) { window.bytesOut += bytes; window.packetsOut++; totalBytesOut += bytes; }
+    void OnReceived(std::size_t bytes) { window.bytesIn += bytes; window.packetsIn++; totalBytesIn += bytes; }
+
+    // Closes the current one second window when it is over
+    void Update(float now);
+
+    // Seconds
+    float GetRtt() const { return smoothedRtt; }
+    float GetJitter() const { return jitter; }
+    bool HasRtt() const { return hasRttSample; }
+
+    // Raw RTT samples, unsmoothed, for tools that want percentiles. The count only goes up
+    uint32_t GetRttSampleCount() const { return rttSampleCount; }
+    float GetLastRttSample() const { return lastRttSample; }
+
+    // 0 to 1, over the last window
+    float GetLoss() const { return loss; }
+
+    // Per second, over the last window
+    float GetBytesInRate() const { return rates.bytesIn; }
+    float GetBytesOutRate() const { return rates.bytesOut; }
+    float GetPacketsInRate() const { return rates.packetsIn; }
+    float GetPacketsOutRate() const { return rates.packetsOut; }
+
+    uint64_t GetTotalBytesIn() const { return totalBytesIn; }
+    uint64_t GetTotalBytesOut() const { return totalBytesOut; }
+
+private:
+    struct Counters
+    {
+        float bytesIn = 0.f;
+        float bytesOut = 0.f;
+        float packetsIn = 0.f;
+        float packetsOut = 0.f;
+    };
+
+    Counters window;
+    Counters rates;
+    float windowStart = 0.f;
+
+    uint64_t totalBytesIn = 0;
+    uint64_t totalBytesOut = 0;
+
+    // Sending side
+    uint16_t nextSequence = 0;
+
+    // What to echo back
+    uint32_t peerTime = 0;
+    float peerTimeReceivedAt = 0.f;
+
+    // RTT, smoothed like TCP, jitter like RTP (RFC 3550) on the RTT samples
+    bool hasRttSample = false;
+    float smoothedRtt = 0.f;
+    float lastRttSample = 0.f;
+    uint32_t rttSampleCount = 0;
+    float jitter = 0.f;
+
+    // Loss, headers expected from the sequence numbers against headers that arrived
+    bool hasSequence = false;
+    uint16_t highestSequence = 0;
+    uint32_t expected = 0;
+    uint32_t received = 0;
+    float loss = 0.f;
+};
@@ -0,0 +1,189 @@
+#include "logger.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// How long the drain thread sleeps when the ring is empty, also bounds a missed wake up
+static constexpr auto DRAIN_IDLE = std::chrono::milliseconds(50);
+
+Logger::Logger()
+{
+    for (std::size_t i = 0; i < RING_SIZE; i++)
+    {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    drainThread = std::thread(&Logger::Drain, this);
+}
+
+Logger::~Logger()
+{
+    running.store(false, std::memory_order_release);
+    wake.notify_one();
+
+    if (drainThread.joinable())
+        drainThread.join();
+}
+
+Logger& Logger::Instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+MessageType Logger::ParseLevel(const std::string& name)
+{
+    if (name == "debug") return debug;
+    if (name == "success") return success;
+    if (name == "warning") return warning;
+    if (name == "error") return error;
+    return info;
+}
+
+void Logger::Push(std::string_view text, MessageType type)
+{
+    std::size_t pos = writePos.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while (true)
+    {
+        slot = &ring[pos & (RING_SIZE - 1)];
+        const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+        if (diff == 0)
+        {
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Full, the drain thread is behind. Losing a line is better than stalling a tick
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = writePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    const std::size_t length = text.size() < MAX_TEXT ? text.size() : MAX_TEXT;
+    std::memcpy(slot->text, text.data(), length);
+    slot->length = static_cast<uint16_t>(length);
+    slot->type = type;
+    slot->time = std::time(nullptr);
+
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (sleeping.load(std::memory_order_acquire))
+        wake.notify_one();
+}
+
+void Logger::WriteFormat(MessageType type, const char* format, ...)
+{
+    char text[MAX_TEXT];
+
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (length < 0)
+        return;
+
+    // vsnprintf returns the length it wanted, the text was cut to the buffer
+    const std::size_t size = static_cast<std::size_t>(length) < sizeof(text) ? static_cast<std::size_t>(length) : sizeof(text) - 1;
+    Write(std::string_view(text, size), type);
+}
+
+bool Logger::Pop(Slot*& slot)
+{
+    const std::size_t pos = readPos.load(std::memory_order_relaxed);
+    Slot& next = ring[pos & (RING_SIZE - 1)];
+
+    if (next.sequence.load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+    slot = &next;
+    return true;
+}
+
+void Logger::Drain()
+{
+    while (true)
+    {
+        bool wrote = false;
+        Slot* slot;
+
+        while (Pop(slot))
+        {
+            const char* stamp = Timestamp(slot->time);
+            const std::string_view text(slot->text, slot->length);
+
+            switch (slot->type)
+            {
+            case debug: std::cout << "\033[36m" << stamp << "   " << text << "\033[0m\n"; break;
+            case warning: std::cout << "\033[33m" << stamp << "   " << text << "\033[0m\n"; break;
+            case error: std::cout << "\033[1;31m" << stamp << "   " << text << "\033[0m\n"; break;
+            case success: std::cout << "\033[1;32m" << stamp << "   " << text << "\033[0m\n"; break;
+            default: std::cout << stamp << "   " << text << '\n'; break;
+            }
+
+            // Hand the slot back to the producers, one lap later
+            const std::size_t pos = readPos.load(std::memory_order_relaxed);
+            slot->sequence.store(pos + RING_SIZE, std::memory_order_release);
+            readPos.store(pos + 1, std::memory_order_release);
+            wrote = true;
+        }
+
+        const std::size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+        {
+            std::cout << "\033[33m" << Timestamp(std::time(nullptr)) << "   " << lost
+                      << " log messages dropped, logging faster than the console can print\033[0m\n";
+            wrote = true;
+        }
+
+        // One flush per batch instead of one per line
+        if (wrote)
+        {
+            std::cout.flush();
+            continue;
+        }
+
+        if (!running.load(std::memory_order_acquire))
+            return;
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        sleeping.store(true, std::memory_order_release);
+        wake.wait_for(lock, DRAIN_IDLE);
+        sleeping.store(false, std::memory_order_release);
+    }
+}
+
+void Logger::WaitEmpty()
+{
+    while (readPos.load(std::memory_order_acquire) != writePos.load(std::memory_order_acquire))
+    {
+        wake.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+const char* Logger::Timestamp(std::time_t time)
+{
+    if (time != cachedSecond)
+    {
+        cachedSecond = time;
+
+        std::tm localTime = {};
+        localtime_r(&time, &localTime);  // Changed from localtime_s for Mac
+        std::strftime(cachedStamp, sizeof(cachedStamp), "%Y-%m-%d %H:%M:%S", &localTime);
+    }
+
+    return cachedStamp;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum MessageType { info, debug, warning, error, success };
+
+// Order of importance, MessageType values are not sorted that way
+constexpr int LogSeverity(MessageType type)
+{
+    switch (type)
+    {
+        case debug: return 0;
+        case info: return 1;
+        case success: return 2;
+        case warning: return 3;
+        case error: return 4;
+    }
+    return 1;
+}
+
+// Anything under this severity is compiled out of PRINT_MSG, set from CMake (LOG_COMPILE_LEVEL)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// Lets GCC and Clang check the arguments of WriteFormat against the format
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstArgument) __attribute__((format(printf, formatIndex, firstArgument)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstArgument)
+#endif
+
+// Asynchronous logger behind Utils::printMsg. Callers copy the text into a fixed slot of a
+// lock-free ring and return, a background thread does the timestamp, colours and the
+// actual write. When the ring is full the message is dropped (and counted), it never waits
+class Logger
+{
+public:
+    // Longest message kept, the rest is cut
+    static constexpr std::size_t MAX_TEXT = 240;
+    static constexpr std::size_t RING_SIZE = 1024;  // power of two
+
+    static bool IsEnabled(MessageType type)
+    {
+        return LogSeverity(type) >= LOG_COMPILE_LEVEL && LogSeverity(type) >= minSeverity.load(std::memory_order_relaxed);
+    }
+
+    static void SetLevel(MessageType type) { minSeverity.store(LogSeverity(type), std::memory_order_relaxed); }
+
+    // "debug", "info", "success", "warning" or "error", anything else keeps info
+    static MessageType ParseLevel(const std::string& name);
+
+    static void Write(std::string_view text, MessageType type) { Instance().Push(text, type); }
+
+    // printf style Write, formatted into a buffer on the stack so it allocates nothing
+    static void WriteFormat(MessageType type, const char* format, ...) LOG_PRINTF_FORMAT(2, 3);
+
+    // Blocks until everything queued so far is written, for exit paths and crashes
+    static void Flush() { Instance().WaitEmpty(); }
+
+    ~Logger();
+
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        MessageType type;
+        std::time_t time;
+        uint16_t length;
+        char text[MAX_TEXT];
+    };
+
+    // Bounded MPMC ring (Vyukov), every slot carries a sequence telling whose turn it is
+    std::array<Slot, RING_SIZE> ring;
+    alignas(64) std::atomic<std::size_t> writePos{0};
+    alignas(64) std::atomic<std::size_t> readPos{0};  // only the drain thread moves it
+    std::atomic<std::size_t> dropped{0};
+
+    // Only used to park the drain thread when there is nothing to do
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> running{true};
+    std::thread drainThread;
+
+    // Formatted "YYYY-MM-DD HH:MM:SS" of the last second seen, only redone when the second changes
+    std::time_t cachedSecond = -1;
+    char cachedStamp[32] = {};
+
+    static inline std::atomic<int> minSeverity{LogSeverity(debug)};
+
+    Logger();
+    static Logger& Instance();
+
+    void Push(std::string_view text, MessageType type);
+    bool Pop(Slot*& slot);
+    void Drain();
+    void WaitEmpty();
+    const char* Timestamp(std::time_t time);
+};
+
+// Same as Utils::printMsg but the message expression is not even evaluated when the level
+// is filtered out, use it on hot paths (per bullet, per hit, per shot...)
+#define PRINT_MSG(msg, type)                                                   \
+    do {                                                                       \
+        if constexpr (LogSeverity(type) >= LOG_COMPILE_LEVEL) {                \
+            if (Logger::IsEnabled(type)) Logger::Write((msg), (type));         \
+        }                                                                      \
+    } while (0)
+
+// PRINT_MSG with a printf format, for anything inside a tick or a frame. Building the text
+// with std::string / std::to_string allocates, which ALLOC_STRICT builds abort on
+#define PRINT_MSGF(type, ...)                                                  \
+    do {                                                                       \
+        if constexpr (LogSeverity(type) >= LOG_COMPILE_LEVEL) {                \
+            if (Logger::IsEnabled(type)) Logger::WriteFormat((type), __VA_ARGS__); \
+        }                                                                      \
+    } while (0)
@@ -4,7 +4,9 @@
 #include "utils.h"
 #include "../client/client_main.h"
 #include "../server/game_server.h"
+#include "../server/packet_capture.h"
 #include "../config.h"
+#include "profiler.h"
 
 
 void RunServer() {
@@ -14,6 +16,14 @@ void RunServer() {
 
     try {
         game_server server(port);
+
+        const std::string captureFile = Config::getCaptureFile();
+        if (!captureFile.empty()) {
+            server.StartCapture(captureFile);
+        }
+
+        server.StartMetrics(Config::getMetricsPort(), Config::getMetricsFile(), Config::getMetricsInterval());
+
         server.Update();
     }
     catch (const std::exception& e) {
@@ -55,8 +65,14 @@ void RunClient() {
     sf::Clock clock;
 
     while (window.isOpen()) {
+        ALLOC_FRAME("ClientFrame");
+        PROFILE_BUDGET("ClientFrame", 1.0f / 60.0f);
+
         float dt = clock.restart().asSeconds();
 
+        PerfCounters& perf = GetPerfCounters();
+        perf.BeginFrame(dt);
+
         // Handle events just as in the labs
         while (const std::optional event = window.pollEvent()) {
             if (event->is<sf::Event::Closed>()) {
@@ -69,6 +85,16 @@ void RunClient() {
                     client.Disconnect();
                     window.close();
                 }
+
+                // Frame, network and interpolation numbers on screen
+                if (keyPressed->scancode == sf::Keyboard::Scancode::F3 && client.game) {
+                    client.game->TogglePerfOverlay();
+                }
+
+                // Dump the last few seconds of profiling zones (TANK_PROFILER builds only)
+                if (keyPressed->scancode == sf::Keyboard::Scancode::F9) {
+                    PROFILE_DUMP("client_trace.json");
+                }
             }
 
             // Pass input to game, done like the labs
@@ -78,27 +104,131 @@ void RunClient() {
         }
 
         if (client.game) {
+            PerfSection section(perf.simTime);
             client.game->Update(dt);
         }
 
-        client.Update();
+        {
+            PerfSection section(perf.netTime);
+            client.Update();
+        }
 
-        window.clear();
-        if (client.game) {
-            client.game->Render(window);
+        {
+            PerfSection section(perf.renderTime);
+            window.clear();
+            if (client.game) {
+                client.game->Render(window);
+            }
         }
         window.display();
     }
 
 }
 
-int main() {
+// Feeds a capture back into a server as fast as it can, same input every run so tick
+// times can be compared between builds. With allocCheck it fails (returns 1) when a tick
+// allocated after the warm-up, which needs a TANK_ALLOC_TRACKING build
+int RunReplay(const std::string& path, bool allocCheck) {
+    Utils::printMsg("Started as REPLAY", success);
+
+#ifndef TANK_ALLOC_TRACKING
+    if (allocCheck) {
+        Utils::printMsg("--alloc-check needs a build with TANK_ALLOC_TRACKING=ON", error);
+        return 1;
+    }
+#endif
+
+    // Counted instead of aborting on the first one, so the report covers the whole capture
+    if (allocCheck) {
+        AllocTracker::SetStrict(false);
+    }
+
+    auto transport = std::make_unique<ReplayTransport>();
+    if (!transport->Load(path)) {
+        return 1;
+    }
+
+    ReplayTransport& replay = *transport;
+
+    try {
+        game_server server(std::move(transport), replay.GetSeed());
+
+        sf::Clock total;
+        float slowestTick = 0.f;
+
+        for (uint32_t tick = 0; tick <= replay.GetLastTick(); tick++) {
+            replay.SetTick(tick);
+
+            sf::Clock tickClock;
+            server.Tick();
+            server.SendUpdates();
+            slowestTick = std::max(slowestTick, tickClock.getElapsedTime().asSeconds());
+        }
+
+        const float seconds = total.getElapsedTime().asSeconds();
+        const uint32_t ticks = replay.GetLastTick() + 1;
+
+        Utils::printMsg("------- Replay DONE ------- ", success);
+        Utils::printMsg("Ticks: " + std::to_string(ticks) + ", messages in: " + std::to_string(replay.GetRecordCount()), info);
+        Utils::printMsg("Packets out: " + std::to_string(replay.GetPacketsSent()) + ", bytes out: " + std::to_string(replay.GetBytesSent()), info);
+        Utils::printMsg("Total: " + std::to_string(seconds * 1000.f) + " ms, average tick: " +
+                        std::to_string(seconds * 1000000.f / ticks) + " us, slowest tick: " +
+                        std::to_string(slowestTick * 1000000.f) + " us", info);
+
+        // Same capture, same config and the same number on every build (DETERMINISTIC_SIM only)
+        if (server.GetRunHash() != 0) {
+            Utils::printMsg("State hash of the run: " + std::to_string(server.GetRunHash()), info);
+        }
+    }
+    catch (const std::exception& e) {
+        Utils::printMsg("Replay error: " + std::string(e.what()), error);
+        return 1;
+    }
+
+    if (allocCheck) {
+        const uint64_t allocatingFrames = AllocTracker::GetAllocatingFrames();
+        if (allocatingFrames > 0) {
+            Utils::printMsg("Alloc check FAILED: " + std::to_string(allocatingFrames) +
+                            " ticks allocated after the warm-up, see the reports above", error);
+            return 1;
+        }
+        Utils::printMsg("Alloc check passed: no tick allocated after the warm-up", success);
+    }
+
+    return 0;
+}
+
+// No arguments asks what to launch. tank_game --replay <capture> [--alloc-check] replays
+// without asking, for scripts and ctest
+int main(int argc, char* argv[]) {
+    Logger::SetLevel(Logger::ParseLevel(Config::getLogLevel()));
+    AllocTracker::SetStrict(Config::getAllocStrict());
+
     Utils::printMsg(" CMP501 – Tank Network Game - Pablo Gonzalez", success);
 
+    if (argc > 1) {
+        const bool replay = (argc == 3 || argc == 4) && std::string(argv[1]) == "--replay";
+        const bool allocCheck = argc == 4 && std::string(argv[3]) == "--alloc-check";
+
+        if (!replay || (argc == 4 && !allocCheck)) {
+            Utils::printMsg("Usage: tank_game [--replay <capture> [--alloc-check]]", error);
+            Logger::Flush();
+            return 1;
+        }
+
+        const int result = RunReplay(argv[2], allocCheck);
+        Logger::Flush();
+        return result;
+    }
+
+    // Logs print on their own thread, let them out before asking anything
+    Logger::Flush();
+
     std::string choice;
     std::cout << "Launch as:" << std::endl;
     std::cout << "  [1] Server" << std::endl;
     std::cout << "  [2] Client" << std::endl;
+    std::cout << "  [3] Replay capture" << std::endl;
     std::cout << "Choice: ";
     std::getline(std::cin, choice);
 
@@ -106,10 +236,16 @@ int main() {
         RunServer();
     } else if (choice == "2") {
         RunClient();
+    } else if (choice == "3") {
+        std::string path;
+        std::cout << "Capture file: ";
+        std::getline(std::cin, path);
+
+        return RunReplay(path, false);
     } else {
         Utils::printMsg("Invalid choice", error);
         return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,191 @@
+#include "map_file.h"
+#include "utils.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const std::byte*>(view);
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // MAP_SHARED, so every server and client on the machine with this map uses the same pages
+    void* view = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    data = static_cast<const std::byte*>(view);
+    size = static_cast<std::size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data)
+        ::munmap(const_cast<std::byte*>(data), size);
+
+    data = nullptr;
+    size = 0;
+}
+
+#endif
+
+std::unique_ptr<MapFile> MapFile::Open(const std::string& path)
+{
+    std::unique_ptr<MapFile> map(new MapFile());
+
+    if (!map->file.Open(path))
+    {
+        Utils::printMsg("Could not open map: " + path, error);
+        return nullptr;
+    }
+
+    if (!map->Validate(path))
+        return nullptr;
+
+    const std::size_t slash = path.find_last_of("/\\");
+    map->name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return map;
+}
+
+bool MapFile::Validate(const std::string& path)
+{
+    const std::byte* data = file.GetData();
+    const std::size_t size = file.GetSize();
+
+    auto fail = [&path](const std::string& reason) {
+        Utils::printMsg("Map " + path + " rejected: " + reason, error);
+        return false;
+    };
+
+    if (size < sizeof(MapHeader))
+        return fail("too small for a header");
+
+    header = reinterpret_cast<const MapHeader*>(data);
+
+    if (std::memcmp(header->magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0)
+        return fail("not a map file");
+    if (header->byteOrder != MAP_BYTE_ORDER)
+        return fail("written with another byte order");
+    if (header->version != MAP_VERSION)
+        return fail("version " + std::to_string(header->version) + ", this build reads " + std::to_string(MAP_VERSION));
+    if (header->chunkColumns == 0 || header->chunkRows == 0)
+        return fail("no chunks");
+
+    // Every section has to be aligned for its records and lie inside the file
+    auto inside = [size](const MapSection& section, std::size_t elementSize) {
+        return section.offset % 4 == 0 &&
+               static_cast<uint64_t>(section.offset) + static_cast<uint64_t>(section.count) * elementSize <= size;
+    };
+
+    const std::size_t layerSize = static_cast<std::size_t>(GetTileColumns()) * GetTileRows();
+    const std::size_t chunkCount = static_cast<std::size_t>(header->chunkColumns) * header->chunkRows;
+
+    if (header->layers.count != header->layerCount || !inside(header->layers, layerSize))
+        return fail("tile layers out of the file");
+    if (header->chunkColliders.count != chunkCount + 1 || !inside(header->chunkColliders, sizeof(uint32_t)))
+        return fail("chunk index out of the file");
+    if (!inside(header->colliders, sizeof(MapRect)))
+        return fail("colliders out of the file");
+    if (!inside(header->spawns, sizeof(MapPoint)))
+        return fail("spawn points out of the file");
+    if (!inside(header->pickups, sizeof(MapPickupSite)))
+        return fail("pickup sites out of the file");
+
+    tiles = reinterpret_cast<const uint8_t*>(data + header->layers.offset);
+    chunkColliders = reinterpret_cast<const uint32_t*>(data + header->chunkColliders.offset);
+    colliders = reinterpret_cast<const MapRect*>(data + header->colliders.offset);
+    spawns = {reinterpret_cast<const MapPoint*>(data + header->spawns.offset), header->spawns.count};
+    pickups = {reinterpret_cast<const MapPickupSite*>(data + header->pickups.offset), header->pickups.count};
+
+    // The chunk index is the only thing used to index other memory, one pass over it is
+    // chunk count + 1 numbers, not the map
+    for (std::size_t i = 0; i < chunkCount; i++)
+    {
+        if (chunkColliders[i] > chunkColliders[i + 1])
+            return fail("chunk index out of order");
+    }
+    if (chunkColliders[0] != 0 || chunkColliders[chunkCount] != header->colliders.count)
+        return fail("chunk index does not cover the colliders");
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include "map_format.h"
+#include "world_chunks.h"
+
+static_assert(MAP_TILE_SIZE * MAP_TILES_PER_CHUNK == CHUNK_SIZE, "Map tiles must fill a chunk exactly");
+
+// Read-only view of a whole file. Pages are loaded by the OS on first touch and shared by
+// every process that maps the same file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+
+    const std::byte* GetData() const { return data; }
+    std::size_t GetSize() const { return size; }
+
+private:
+    const std::byte* data = nullptr;
+    std::size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void Close();
+};
+
+// Elements of one section, pointing into the mapped file
+template <typename T>
+struct MapSpan
+{
+    const T* data = nullptr;
+    std::size_t count = 0;
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](std::size_t i) const { return data[i]; }
+};
+
+// A .tmap file (map_format.h). Open only checks the header and that every section lies
+// inside the file, then everything is read in place
+class MapFile
+{
+public:
+    // Nothing when the file is missing or is not a map this build understands
+    static std::unique_ptr<MapFile> Open(const std::string& path);
+
+    const MapHeader& GetHeader() const { return *header; }
+    ChunkLayout GetLayout() const { return ChunkLayout(header->chunkColumns, header->chunkRows); }
+
+    // File name without the folders, what the server tells clients to load
+    const std::string& GetName() const { return name; }
+
+    int GetTileColumns() const { return header->chunkColumns * MAP_TILES_PER_CHUNK; }
+    int GetTileRows() const { return header->chunkRows * MAP_TILES_PER_CHUNK; }
+    int GetLayerCount() const { return header->layerCount; }
+
+    MapTile GetTile(int layer, int x, int y) const
+    {
+        const std::size_t layerSize = static_cast<std::size_t>(GetTileColumns()) * GetTileRows();
+        return static_cast<MapTile>(tiles[layer * layerSize + static_cast<std::size_t>(y) * GetTileColumns() + x]);
+    }
+
+    MapSpan<MapRect> GetChunkColliders(int chunk) const
+    {
+        return {colliders + chunkColliders[chunk], chunkColliders[chunk + 1] - chunkColliders[chunk]};
+    }
+
+    MapSpan<MapPoint> GetSpawns() const { return spawns; }
+    MapSpan<MapPickupSite> GetPickupSites() const { return pickups; }
+
+private:
+    MappedFile file;
+    std::string name;
+
+    const MapHeader* header = nullptr;
+    const uint8_t* tiles = nullptr;
+    const uint32_t* chunkColliders = nullptr;
+    const MapRect* colliders = nullptr;
+    MapSpan<MapPoint> spawns;
+    MapSpan<MapPickupSite> pickups;
+
+    bool Validate(const std::string& path);
+};
+
+// Where a player joins: the map spawn points in turn by player id, or the middle of the world
+inline sf::Vector2f SpawnPointFor(const MapFile* map, const ChunkLayout& layout, int playerId)
+{
+    if (map && !map->GetSpawns().empty())
+    {
+        const MapPoint& point = map->GetSpawns()[static_cast<std::size_t>(playerId) % map->GetSpawns().size()];
+        return {point.x, point.y};
+    }
+    return layout.GetSpawnPoint();
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Binary map (.tmap), written by tank_map_convert and read in place through MapFile: the
+// file is mapped and the structs below are used straight from its pages, there is no parse.
+// So everything is fixed size, little-endian, and every section starts 4-byte aligned.
+//
+//   MapHeader
+//   layers            layerCount grids of tileColumns x tileRows MapTile bytes, row by row
+//   chunkColliders    chunk count + 1 offsets into colliders, the colliders of chunk i are
+//                     [chunkColliders[i], chunkColliders[i + 1])
+//   colliders         MapRect, grouped by chunk, none bigger than a chunk
+//   spawns            MapPoint
+//   pickups           MapPickupSite
+//
+// Change MAP_VERSION with any change to these structs, old files are then refused
+
+constexpr char MAP_MAGIC[4] = {'T', 'M', 'A', 'P'};
+constexpr uint16_t MAP_VERSION = 1;
+
+// Written as is, a machine with the other byte order reads 0x04030201
+constexpr uint32_t MAP_BYTE_ORDER = 0x01020304;
+
+// A chunk (CHUNK_SIZE in world_chunks.h) is 10 x 10 tiles
+constexpr float MAP_TILE_SIZE = 32.f;
+constexpr int MAP_TILES_PER_CHUNK = 10;
+
+enum class MapTile : uint8_t
+{
+    None = 0,
+    Sand,
+    HorizontalFence,
+    VerticalFence,
+    Rock,
+    Count
+};
+
+struct MapSection
+{
+    uint32_t offset;   // from the start of the file
+    uint32_t count;    // elements, not bytes
+};
+
+struct MapHeader
+{
+    char magic[4];
+    uint32_t byteOrder;
+    uint16_t version;
+    uint16_t chunkColumns;
+    uint16_t chunkRows;
+    uint16_t layerCount;
+
+    // FNV-1a of everything after the header. Not checked on load (that would read the whole
+    // file), the server sends it so a client can tell its copy is the same
+    uint32_t checksum;
+    uint32_t reserved;
+
+    MapSection layers;
+    MapSection chunkColliders;
+    MapSection colliders;
+    MapSection spawns;
+    MapSection pickups;
+};
+
+struct MapRect
+{
+    float x, y;
+    float width, height;
+};
+
+struct MapPoint
+{
+    float x, y;
+};
+
+struct MapPickupSite
+{
+    float x, y;
+    uint8_t type;   // same as PickUpMessage, 0 = AmmoBox, 1 = HealthKit
+    uint8_t padding[3];
+};
+
+static_assert(sizeof(MapHeader) == 64, "MapHeader is part of the file format");
+static_assert(sizeof(MapSection) == 8 && sizeof(MapRect) == 16 && sizeof(MapPoint) == 8 && sizeof(MapPickupSite) == 12,
+              "Map records are part of the file format");
+static_assert(std::is_trivially_copyable_v<MapHeader> && std::is_trivially_copyable_v<MapPickupSite>,
+              "Map records are read straight from the mapped file");
+
+inline uint32_t MapChecksum(const std::byte* data, std::size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
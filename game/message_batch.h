@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "protocole_message.h"
+
+// Payload that fits in one ethernet frame with IP/UDP headers and some tunnel overhead,
+// anything bigger gets IP fragmented and one lost fragment loses the whole datagram
+constexpr std::size_t SAFE_DATAGRAM_SIZE = 1200;
+
+// Size prefix in front of every message inside a BUNDLE
+constexpr std::size_t BUNDLE_LENGTH_SIZE = sizeof(uint16_t);
+
+// Collects every message going to one peer during a tick and packs them into as few
+// datagrams as possible: [BUNDLE][uint16 length][message][uint16 length][message]...
+// A datagram holding a single message is sent as that message alone, without the header
+class MessageBatch
+{
+public:
+    explicit MessageBatch(std::size_t maxDatagramSize = SAFE_DATAGRAM_SIZE)
+        : buffer(maxDatagramSize), maxDatagramSize(maxDatagramSize)
+    {
+        Clear();
+    }
+
+    // Copies the encoded message into the batch. If it does not fit in the datagram being
+    // built, that one is sent first. Messages bigger than a datagram go out on their own
+    template <typename SendFn>
+    void Add(const MessageWriter& message, SendFn&& send)
+    {
+        if (!message)
+            return;
+
+        const std::size_t needed = BUNDLE_LENGTH_SIZE + message.GetSize();
+
+        if (sizeof(uint8_t) + needed > maxDatagramSize)
+        {
+            // Keep the order, what was queued before goes first
+            Flush(send);
+            send(message.GetData(), message.GetSize());
+            return;
+        }
+
+        if (size + needed > maxDatagramSize)
+            Flush(send);
+
+        MessageWriter writer(buffer.data() + size, needed);
+        writer << static_cast<uint16_t>(message.GetSize());
+        writer.Append(message.GetData(), message.GetSize());
+
+        size += needed;
+        count++;
+    }
+
+    // Sends whatever is waiting, call once at the end of the tick
+    template <typename SendFn>
+    void Flush(SendFn&& send)
+    {
+        if (count == 1)
+        {
+            // Skip the bundle type and length, the message can go as it is
+            const std::size_t offset = sizeof(uint8_t) + BUNDLE_LENGTH_SIZE;
+            send(buffer.data() + offset, size - offset);
+        }
+        else if (count > 1)
+        {
+            send(buffer.data(), size);
+        }
+
+        Clear();
+    }
+
+    std::size_t GetMaxDatagramSize() const { return maxDatagramSize; }
+
+private:
+    // Allocated once when the peer connects
+    std::vector<std::byte> buffer;
+    std::size_t maxDatagramSize;
+    std::size_t size = 0;
+    std::size_t count = 0;
+
+    void Clear()
+    {
+        buffer[0] = static_cast<std::byte>(MessageTypeProtocole::BUNDLE);
+        size = sizeof(uint8_t);
+        count = 0;
+    }
+};
+
+// Calls handler with a reader per message in the datagram, bundle or not
+template <typename Handler>
+void UnpackDatagram(const std::byte* data, std::size_t size, Handler&& handler)
+{
+    MessageReader datagram(data, size);
+
+    uint8_t type;
+    if (!(datagram >> type))
+        return;
+
+    if (static_cast<MessageTypeProtocole>(type) != MessageTypeProtocole::BUNDLE)
+    {
+        MessageReader message(data, size);
+        handler(message);
+        return;
+    }
+
+    uint16_t length = 0;
+    while (!datagram.EndOfMessage() && datagram >> length)
+    {
+        if (length > datagram.GetRemainingSize())
+            return;
+
+        MessageReader message(datagram.GetRemainingData(), length);
+        datagram.Skip(length);
+
+        handler(message);
+    }
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include <SFML/Network/Packet.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Every message lists its fields once in a static constexpr Fields() and the encode/decode
+// functions and the biggest size it can take on the wire are all generated from that list.
+// Works with any stream that has << / >> for the basic types (sf::Packet, MessageWriter/Reader)
+namespace schema {
+
+// There is no public way to flag a sf::Packet as broken, but reading past the end does it
+inline void MarkInvalid(sf::Packet& packet)
+{
+    uint8_t rest;
+    while (packet >> rest) {}
+}
+
+template <typename Stream>
+void MarkInvalid(Stream& stream) { stream.Invalidate(); }
+
+// Plain value (ints, floats, bools), written with its fixed size
+template <typename T, typename V>
+struct Value
+{
+    static_assert(std::is_arithmetic_v<V>, "Use String or Array for non plain members");
+
+    V T::* member;
+
+    template <typename Stream>
+    void Encode(Stream& stream, const T& msg) const { stream << msg.*member; }
+
+    template <typename Stream>
+    void Decode(Stream& stream, T& msg) const { stream >> msg.*member; }
+
+    static constexpr std::size_t MaxSize() { return sizeof(V); }
+};
+
+// uint32 length + chars, anything longer than MaxLength breaks the stream on encode and is
+// rejected on decode
+template <typename T, std::size_t MaxLength>
+struct String
+{
+    std::string T::* member;
+
+    template <typename Stream>
+    void Encode(Stream& stream, const T& msg) const
+    {
+        if ((msg.*member).size() > MaxLength)
+        {
+            MarkInvalid(stream);
+            return;
+        }
+
+        stream << msg.*member;
+    }
+
+    template <typename Stream>
+    void Decode(Stream& stream, T& msg) const
+    {
+        stream >> msg.*member;
+        if (stream && (msg.*member).size() > MaxLength)
+            MarkInvalid(stream);
+    }
+
+    static constexpr std::size_t MaxSize() { return sizeof(uint32_t) + MaxLength; }
+};
+
+template <typename E> constexpr std::size_t MaxEncodedSize();
+template <typename Stream, typename E> void EncodeFields(Stream& stream, const E& msg);
+template <typename Stream, typename E> void DecodeFields(Stream& stream, E& msg);
+
+// Count prefix + elements, every element being a struct with its own Fields(). More than
+// MaxCount breaks the stream on encode, same as on decode, nothing is cut off quietly
+template <typename T, typename E, typename Count, std::size_t MaxCount>
+struct Array
+{
+    std::vector<E> T::* member;
+
+    template <typename Stream>
+    void Encode(Stream& stream, const T& msg) const
+    {
+        const auto& elements = msg.*member;
+        if (elements.size() > MaxCount)
+        {
+            MarkInvalid(stream);
+            return;
+        }
+
+        stream << static_cast<Count>(elements.size());
+        for (const E& element : elements)
+            EncodeFields(stream, element);
+    }
+
+    template <typename Stream>
+    void Decode(Stream& stream, T& msg) const
+    {
+        Count count = 0;
+        stream >> count;
+        if (!stream) return;
+
+        if (count > MaxCount)
+        {
+            MarkInvalid(stream);
+            return;
+        }
+
+        // Resized and read in place so a reused message keeps its capacity
+        auto& elements = msg.*member;
+        elements.resize(count);
+        for (auto& element : elements)
+            DecodeFields(stream, element);
+    }
+
+    static constexpr std::size_t MaxSize() { return sizeof(Count) + MaxCount * MaxEncodedSize<E>(); }
+};
+
+// Helpers so Fields() reads like a list of members
+template <typename T, typename V>
+constexpr Value<T, V> Field(V T::* member) { return {member}; }
+
+template <std::size_t MaxLength, typename T>
+constexpr String<T, MaxLength> Text(std::string T::* member) { return {member}; }
+
+template <typename Count, std::size_t MaxCount, typename T, typename E>
+constexpr Array<T, E, Count, MaxCount> List(std::vector<E> T::* member) { return {member}; }
+
+template <typename T, typename = void>
+struct HasFields : std::false_type {};
+
+template <typename T>
+struct HasFields<T, std::void_t<decltype(T::Fields())>> : std::true_type {};
+
+template <typename T, typename = void>
+struct IsMessage : std::false_type {};
+
+template <typename T>
+struct IsMessage<T, std::void_t<decltype(T::ID)>> : HasFields<T> {};
+
+template <typename Stream, typename E>
+void EncodeFields(Stream& stream, const E& msg)
+{
+    std::apply([&](const auto&... fields) { (fields.Encode(stream, msg), ...); }, E::Fields());
+}
+
+template <typename Stream, typename E>
+void DecodeFields(Stream& stream, E& msg)
+{
+    // Stop at the first field that fails
+    std::apply([&](const auto&... fields) { ((stream ? fields.Decode(stream, msg) : void()), ...); }, E::Fields());
+}
+
+template <typename E>
+constexpr std::size_t MaxEncodedSize()
+{
+    return std::apply([](const auto&... fields) {
+        return (std::size_t{0} + ... + std::decay_t<decltype(fields)>::MaxSize());
+    }, E::Fields());
+}
+
+// Type byte + payload
+template <typename M>
+constexpr std::size_t MaxMessageSize() { return sizeof(uint8_t) + MaxEncodedSize<M>(); }
+
+template <typename... M>
+constexpr std::size_t LargestMessage(std::tuple<M...>*) { return std::max({MaxMessageSize<M>()...}); }
+
+template <typename... M>
+constexpr bool IdsAreUnique(std::tuple<M...>*)
+{
+    const uint8_t ids[] = {static_cast<uint8_t>(M::ID)...};
+    for (std::size_t i = 0; i < sizeof...(M); i++)
+        for (std::size_t j = i + 1; j < sizeof...(M); j++)
+            if (ids[i] == ids[j]) return false;
+    return true;
+}
+
+} // namespace schema
+
+// Anything with Fields() (messages and headers) can go straight into a stream
+template <typename Stream, typename M, std::enable_if_t<schema::HasFields<M>::value, int> = 0>
+Stream& operator<<(Stream& stream, const M& msg)
+{
+    schema::EncodeFields(stream, msg);
+    return stream;
+}
+
+template <typename Stream, typename M, std::enable_if_t<schema::HasFields<M>::value, int> = 0>
+Stream& operator>>(Stream& stream, M& msg)
+{
+    schema::DecodeFields(stream, msg);
+    return stream;
+}
+
+// Writes the type byte and the message, so the id always matches the struct
+template <typename Stream, typename M>
+Stream& WriteMessage(Stream& stream, const M& msg)
+{
+    static_assert(schema::IsMessage<M>::value, "Not a protocol message");
+    stream << static_cast<uint8_t>(M::ID) << msg;
+    return stream;
+}
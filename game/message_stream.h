@@ -0,0 +1,216 @@
+#pragma once
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Biggest thing a single UDP send can take, every scratch buffer is this size so nothing
+// we encode can ever outgrow it and need the heap
+constexpr std::size_t MAX_MESSAGE_SIZE = sf::UdpSocket::MaxDatagramSize;
+
+using MessageBuffer = std::array<std::byte, MAX_MESSAGE_SIZE>;
+
+// Writes a message straight into a buffer the caller owns instead of growing a sf::Packet.
+// The bytes are exactly what sf::Packet would produce (integers in network order, floats raw,
+// strings as uint32 length + chars), so the other side can keep reading them with sf::Packet
+class MessageWriter
+{
+public:
+    MessageWriter(std::byte* data, std::size_t capacity) : data(data), capacity(capacity) {}
+    explicit MessageWriter(MessageBuffer& buffer) : MessageWriter(buffer.data(), buffer.size()) {}
+
+    // Start a new message on the same buffer
+    void Reset() { size = 0; isValid = true; }
+
+    const std::byte* GetData() const { return data; }
+    std::size_t GetSize() const { return size; }
+
+    // False if something did not fit, the message should not be sent
+    explicit operator bool() const { return isValid; }
+
+    // A field broke the schema (too long, too many), same as running out of room
+    void Invalidate() { isValid = false; }
+
+    MessageWriter& operator<<(bool value) { return *this << static_cast<uint8_t>(value); }
+    MessageWriter& operator<<(int8_t value) { Append(&value, sizeof(value)); return *this; }
+    MessageWriter& operator<<(uint8_t value) { Append(&value, sizeof(value)); return *this; }
+    MessageWriter& operator<<(int16_t value) { return *this << static_cast<uint16_t>(value); }
+    MessageWriter& operator<<(int32_t value) { return *this << static_cast<uint32_t>(value); }
+
+    MessageWriter& operator<<(uint16_t value)
+    {
+        const uint8_t bytes[] = { static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+        Append(bytes, sizeof(bytes));
+        return *this;
+    }
+
+    MessageWriter& operator<<(uint32_t value)
+    {
+        const uint8_t bytes[] = {
+            static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+            static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)
+        };
+        Append(bytes, sizeof(bytes));
+        return *this;
+    }
+
+    // Same as sf::Packet, floats go as their raw bytes
+    MessageWriter& operator<<(float value) { Append(&value, sizeof(value)); return *this; }
+
+    MessageWriter& operator<<(const std::string& value)
+    {
+        *this << static_cast<uint32_t>(value.size());
+        Append(value.data(), value.size());
+        return *this;
+    }
+
+    // Raw bytes, used to copy an already encoded message behind a header
+    void Append(const void* bytes, std::size_t count)
+    {
+        if (!isValid || count > capacity - size)
+        {
+            isValid = false;
+            return;
+        }
+
+        std::memcpy(data + size, bytes, count);
+        size += count;
+    }
+
+private:
+    std::byte* data;
+    std::size_t capacity;
+    std::size_t size = 0;
+    bool isValid = true;
+};
+
+// Reads a message in place from a received buffer, same format as the writer above
+class MessageReader
+{
+public:
+    MessageReader(const std::byte* data, std::size_t size) : data(data), size(size) {}
+
+    // False once a read went past the end of the message
+    explicit operator bool() const { return isValid; }
+    bool EndOfMessage() const { return readPos >= size; }
+
+    // Used by the schema when a value is out of range
+    void Invalidate() { isValid = false; }
+
+    // What has not been read yet, for messages wrapped inside another one
+    const std::byte* GetRemainingData() const { return data + readPos; }
+    std::size_t GetRemainingSize() const { return size - readPos; }
+
+    void Skip(std::size_t count)
+    {
+        if (!isValid || count > size - readPos)
+        {
+            isValid = false;
+            return;
+        }
+        readPos += count;
+    }
+
+    MessageReader& operator>>(bool& value)
+    {
+        uint8_t byte = 0;
+        *this >> byte;
+        value = byte != 0;
+        return *this;
+    }
+
+    MessageReader& operator>>(int8_t& value) { Read(&value, sizeof(value)); return *this; }
+    MessageReader& operator>>(uint8_t& value) { Read(&value, sizeof(value)); return *this; }
+
+    MessageReader& operator>>(uint16_t& value)
+    {
+        uint8_t bytes[2] = {};
+        if (Read(bytes, sizeof(bytes)))
+            value = static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+        return *this;
+    }
+
+    MessageReader& operator>>(uint32_t& value)
+    {
+        uint8_t bytes[4] = {};
+        if (Read(bytes, sizeof(bytes)))
+        {
+            value = (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+                    (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+        }
+        return *this;
+    }
+
+    MessageReader& operator>>(int16_t& value)
+    {
+        uint16_t raw = 0;
+        *this >> raw;
+        value = static_cast<int16_t>(raw);
+        return *this;
+    }
+
+    MessageReader& operator>>(int32_t& value)
+    {
+        uint32_t raw = 0;
+        *this >> raw;
+        value = static_cast<int32_t>(raw);
+        return *this;
+    }
+
+    MessageReader& operator>>(float& value) { Read(&value, sizeof(value)); return *this; }
+
+    // Assigns into the existing string, so a reused message keeps its capacity
+    MessageReader& operator>>(std::string& value)
+    {
+        uint32_t length = 0;
+        *this >> length;
+        value.clear();
+
+        if (isValid && length > size - readPos)
+        {
+            isValid = false;
+        }
+        else if (isValid)
+        {
+            value.assign(reinterpret_cast<const char*>(data + readPos), length);
+            readPos += length;
+        }
+        return *this;
+    }
+
+private:
+    const std::byte* data;
+    std::size_t size;
+    std::size_t readPos = 0;
+    bool isValid = true;
+
+    bool Read(void* bytes, std::size_t count)
+    {
+        if (!isValid || count > size - readPos)
+        {
+            isValid = false;
+            return false;
+        }
+
+        std::memcpy(bytes, data + readPos, count);
+        readPos += count;
+        return true;
+    }
+};
+
+// One encode buffer and one receive buffer per thread, allocated once for the whole
+// program so steady state sending/receiving never touches the heap
+inline MessageBuffer& GetSendBuffer()
+{
+    thread_local MessageBuffer buffer;
+    return buffer;
+}
+
+inline MessageBuffer& GetReceiveBuffer()
+{
+    thread_local MessageBuffer buffer;
+    return buffer;
+}
@@ -0,0 +1,65 @@
+#include "network_emulator.h"
+#include <algorithm>
+#include <cstring>
+
+// How long a reordered datagram is held on top of its normal delay
+static constexpr float REORDER_HOLD = 0.05f;
+
+NetworkEmulator::NetworkEmulator(const NetworkConditions& conditions)
+    : conditions(conditions), rng(conditions.seed)
+{
+}
+
+void NetworkEmulator::Queue(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port)
+{
+    const float now = clock.getElapsedTime().asSeconds();
+
+    if (chance(rng) < conditions.loss)
+    {
+        dropped++;
+        return;
+    }
+
+    float sendAt = now + SampleDelay();
+    if (chance(rng) < conditions.reorder)
+    {
+        sendAt += REORDER_HOLD;
+        reordered++;
+    }
+
+    Schedule(data, size, address, port, sendAt);
+
+    if (chance(rng) < conditions.duplicate)
+    {
+        // The copy takes its own path through the network
+        Schedule(data, size, address, port, now + SampleDelay());
+        duplicated++;
+    }
+}
+
+float NetworkEmulator::SampleDelay()
+{
+    if (conditions.jitter <= 0.f)
+        return conditions.delay;
+
+    std::uniform_real_distribution<float> jitter(-conditions.jitter, conditions.jitter);
+    return std::max(0.f, conditions.delay + jitter(rng));
+}
+
+void NetworkEmulator::Schedule(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port, float sendAt)
+{
+    auto slot = std::find_if(pending.begin(), pending.end(), [](const Datagram& datagram) { return !datagram.inUse; });
+    if (slot == pending.end())
+    {
+        pending.emplace_back();
+        slot = pending.end() - 1;
+    }
+
+    slot->data.resize(size);
+    std::memcpy(slot->data.data(), data, size);
+    slot->sendAt = sendAt;
+    slot->order = nextOrder++;
+    slot->address = address;
+    slot->port = port;
+    slot->inUse = true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/System/Clock.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Bad network to apply to outgoing UDP, read from config (NET_* keys). Times in seconds,
+// chances from 0 to 1. Everything zero means the emulator is off and costs nothing
+struct NetworkConditions
+{
+    float delay = 0.f;       // one way, added to every datagram
+    float jitter = 0.f;      // +- random on top of delay
+    float loss = 0.f;        // chance a datagram is dropped
+    float duplicate = 0.f;   // chance it is sent twice
+    float reorder = 0.f;     // chance it is held back so the next ones overtake it
+    uint32_t seed = 1;       // same seed, same drops and delays
+
+    bool IsEnabled() const { return delay > 0.f || jitter > 0.f || loss > 0.f || duplicate > 0.f || reorder > 0.f; }
+};
+
+// Sits between the game and sendto(): datagrams go in with Queue and come out of Release
+// once their emulated delay is over. Used on both client and server so both directions
+// of the link get the same conditions
+class NetworkEmulator
+{
+public:
+    explicit NetworkEmulator(const NetworkConditions& conditions);
+
+    bool IsEnabled() const { return conditions.IsEnabled(); }
+    const NetworkConditions& GetConditions() const { return conditions; }
+
+    // Copies the datagram in, unless the loss roll drops it
+    void Queue(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port);
+
+    // Sends every datagram whose time came, SendFn(const std::byte*, size_t, const sf::IpAddress&, unsigned short)
+    template <typename SendFn>
+    void Release(SendFn&& send);
+
+    // One way delay for a single message, delay +- jitter
+    float SampleDelay();
+
+    // Dropped, duplicated and held back so far
+    std::size_t GetDropped() const { return dropped; }
+    std::size_t GetDuplicated() const { return duplicated; }
+    std::size_t GetReordered() const { return reordered; }
+
+private:
+    struct Datagram
+    {
+        float sendAt = 0.f;
+        uint64_t order = 0;
+        std::vector<std::byte> data;
+        sf::IpAddress address = sf::IpAddress::Any;
+        unsigned short port = 0;
+        bool inUse = false;
+    };
+
+    NetworkConditions conditions;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> chance{0.f, 1.f};
+    sf::Clock clock;
+
+    // Slots are reused so their byte vectors keep their capacity
+    std::vector<Datagram> pending;
+    uint64_t nextOrder = 0;
+
+    std::size_t dropped = 0;
+    std::size_t duplicated = 0;
+    std::size_t reordered = 0;
+
+    void Schedule(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port, float sendAt);
+};
+
+template <typename SendFn>
+void NetworkEmulator::Release(SendFn&& send)
+{
+    const float now = clock.getElapsedTime().asSeconds();
+
+    // Earliest first, so datagrams with the same delay keep the order they were queued in
+    while (true)
+    {
+        Datagram* next = nullptr;
+        for (Datagram& datagram : pending)
+        {
+            if (!datagram.inUse || datagram.sendAt > now)
+                continue;
+
+            if (!next || datagram.sendAt < next->sendAt ||
+                (datagram.sendAt == next->sendAt && datagram.order < next->order))
+                next = &datagram;
+        }
+
+        if (!next)
+            return;
+
+        next->inUse = false;
+        send(next->data.data(), next->data.size(), next->address, next->port);
+    }
+}
@@ -3,13 +3,35 @@
 //
 
 #include "obstacle.h"
+#include "perf_counters.h"
+#include <memory>
+#include <unordered_map>
+
+// Loaded once per file and shared, streaming a chunk in used to read every rock from disk.
+// A file that fails stays as an empty texture so it is not retried for every obstacle
+static const sf::Texture& ObstacleTexture(const std::string& path)
+{
+    static std::unordered_map<std::string, std::unique_ptr<sf::Texture>> textures;
+
+    std::unique_ptr<sf::Texture>& texture = textures[path];
+    if (!texture)
+    {
+        texture = std::make_unique<sf::Texture>();
+        if (!texture->loadFromFile(path))
+        {
+            Utils::printMsg("Texture Loading Failed", error);
+        }
+    }
+
+    return *texture;
+}
 
 obstacle::obstacle(const std::string& texturePath,
                    sf::Vector2f position,
                    sf::Vector2f colliderSize,
                    sf::Vector2f colliderOffset,
                    sf::Vector2f scale)
-    : sprite(texture),
+    : sprite(ObstacleTexture(texturePath)),
       position(position),
       colliderSize(colliderSize),
       colliderOffset(colliderOffset),
@@ -18,9 +40,10 @@ obstacle::obstacle(const std::string& texturePath,
       texturePath(texturePath)
 {
 
-    if (texture.loadFromFile(texturePath))
+    const sf::Texture& texture = ObstacleTexture(texturePath);
+
+    if (texture.getSize().x > 0)
     {
-        sprite.setTexture(texture);
         sprite.setTextureRect(sf::IntRect({0, 0}, static_cast<sf::Vector2i>(texture.getSize())));
 
         sprite.setOrigin(static_cast<sf::Vector2f>(sprite.getTextureRect().getCenter()));
@@ -33,9 +56,6 @@ obstacle::obstacle(const std::string& texturePath,
             this->colliderSize = spriteBounds.size;
         }
 
-    } else
-    {
-        Utils::printMsg("Texture Loading Failed", error);
     }
 
     UpdateDebugRect();
@@ -50,11 +70,11 @@ sf::FloatRect obstacle::GetBounds() const
 
 void obstacle::Render(sf::RenderWindow& window, const bool debugMode) const
 {
-    window.draw(sprite);
+    CountedDraw(window, sprite);
 
     if (debugMode)
     {
-        window.draw(debugRect);
+        CountedDraw(window, debugRect);
     }
 }
 
@@ -27,7 +27,6 @@ public:
     std::string GetTexturePath() const { return  texturePath;}
 
 private:
-    sf::Texture texture;
     std::string texturePath;
 
     sf::Vector2f position;
@@ -0,0 +1,137 @@
+#pragma once
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Client numbers for the performance overlay (hudPerfOverlay in gameUI). Every hook checks
+// enabled first, so while the overlay is hidden they cost one predictable branch and no
+// clock reads. Client thread only, nothing here is synchronised
+struct PerfCounters
+{
+    // Frames kept for the graph, two seconds at 60 fps
+    static constexpr std::size_t HISTORY = 120;
+
+    bool enabled = false;
+
+    // Seconds, newest at frameIndex - 1
+    std::array<float, HISTORY> frameTimes = {};
+    std::size_t frameIndex = 0;
+
+    // Seconds spent in the parts of the last frame
+    float simTime = 0.f;
+    float netTime = 0.f;
+    float renderTime = 0.f;
+
+    // Counted during the frame, copied to lastDrawCalls when the next one starts
+    uint32_t drawCalls = 0;
+    uint32_t lastDrawCalls = 0;
+
+    // Snapshot arrivals, in Now() seconds
+    float lastSnapshotAt = -1.f;
+    float snapshotInterval = 0.f;
+    float worstSnapshotInterval = 0.f;   // over the frames in the graph
+
+    // States held for remote tanks (Game keeps the previous and the target one), the lowest
+    // of any tank, and how far through INTERP_TIME the most behind tank is (past 1 it is frozen)
+    int interpDepth = 0;
+    float interpProgress = 0.f;
+
+    // Low half of the server's state hash of the last snapshot, 0 unless it runs DETERMINISTIC_SIM.
+    // Clients showing the same value saw the same server state
+    uint32_t stateHash = 0;
+
+    static float Now()
+    {
+        static const auto start = std::chrono::steady_clock::now();
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void BeginFrame(float dt)
+    {
+        if (!enabled)
+            return;
+
+        frameTimes[frameIndex % HISTORY] = dt;
+        frameIndex++;
+
+        lastDrawCalls = drawCalls;
+        drawCalls = 0;
+
+        // Let an old spike age out with the graph
+        worstSnapshotInterval *= 1.f - 1.f / HISTORY;
+    }
+
+    void OnSnapshot(uint32_t serverStateHash)
+    {
+        if (!enabled)
+            return;
+
+        stateHash = serverStateHash;
+
+        const float now = Now();
+        if (lastSnapshotAt >= 0.f)
+        {
+            snapshotInterval = now - lastSnapshotAt;
+            if (snapshotInterval > worstSnapshotInterval)
+                worstSnapshotInterval = snapshotInterval;
+        }
+        lastSnapshotAt = now;
+    }
+
+    // Start from nothing when the overlay is turned on, the old numbers are stale
+    void SetEnabled(bool on)
+    {
+        *this = PerfCounters();
+        enabled = on;
+    }
+};
+
+inline PerfCounters& GetPerfCounters()
+{
+    static PerfCounters counters;
+    return counters;
+}
+
+// Use instead of target.draw(drawable) for anything drawn in the world, so the overlay can count it
+inline void CountedDraw(sf::RenderTarget& target, const sf::Drawable& drawable)
+{
+    PerfCounters& counters = GetPerfCounters();
+    if (counters.enabled)
+        counters.drawCalls++;
+
+    target.draw(drawable);
+}
+
+inline void CountedDraw(sf::RenderTarget& target, const sf::Drawable& drawable, const sf::Texture* texture)
+{
+    PerfCounters& counters = GetPerfCounters();
+    if (counters.enabled)
+        counters.drawCalls++;
+
+    target.draw(drawable, sf::RenderStates(texture));
+}
+
+// Writes the time spent in its scope into a PerfCounters field, only when the overlay is on
+class PerfSection
+{
+public:
+    explicit PerfSection(float& out)
+        : out(GetPerfCounters().enabled ? &out : nullptr), start(this->out ? PerfCounters::Now() : 0.f) {}
+
+    ~PerfSection()
+    {
+        if (out)
+            *out = PerfCounters::Now() - start;
+    }
+
+    PerfSection(const PerfSection&) = delete;
+    PerfSection& operator=(const PerfSection&) = delete;
+
+private:
+    float* out;
+    float start;
+};
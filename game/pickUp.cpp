@@ -2,18 +2,15 @@
 // Created for tank game pickup system
 //
 #include "pickUp.h"
+#include "perf_counters.h"
 
 // Initialize static members
 std::random_device pickUp::rd;
 std::mt19937 pickUp::gen(rd());
 
 pickUp::pickUp(const std::string& texturePath,
-               sf::Vector2f position,
-               float worldWidth,
-               float worldHeight)
+               sf::Vector2f position)
     : position(position), sprite(texture),
-      worldWidth(worldWidth),
-      worldHeight(worldHeight),
       isActive(true)
 {
     if (!texture.loadFromFile(texturePath))
@@ -34,7 +31,7 @@ void pickUp::Render(sf::RenderWindow& window) const
 {
     if (isActive)
     {
-        window.draw(sprite);
+        CountedDraw(window, sprite);
     }
 }
 
@@ -11,9 +11,7 @@
 class pickUp
 {public:
         pickUp(const std::string& texturePath,
-               sf::Vector2f position,
-               float worldWidth = 1280.f,
-               float worldHeight = 960.f);
+               sf::Vector2f position);
 
         virtual ~pickUp() = default;
 
@@ -30,6 +28,12 @@ class pickUp
 
         sf::Vector2f GetPosition() const { return position; }
 
+        void SetPosition(sf::Vector2f newPosition)
+        {
+            position = newPosition;
+            sprite.setPosition(newPosition);
+        }
+
         bool IsActive() const { return isActive; }
 
         void SetActive(bool active) { isActive = active; }
@@ -42,9 +46,6 @@ class pickUp
         sf::Texture texture;
         sf::Sprite sprite;
 
-        float worldWidth;
-        float worldHeight;
-
         bool isActive;
 
         // Random number generation for respawn
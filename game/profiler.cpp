@@ -0,0 +1,202 @@
+#include "profiler.h"
+#include "utils.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    // Last zones of one thread, oldest overwritten. 64k events is a few seconds of a busy tick
+    struct Ring
+    {
+        static constexpr std::size_t CAPACITY = 1 << 16;
+
+        std::array<Event, CAPACITY> events;
+        std::atomic<uint64_t> head{0};
+        int threadId = 0;
+    };
+
+    // Seconds between two automatic dumps
+    constexpr float BUDGET_DUMP_INTERVAL = 5.f;
+
+    const auto epoch = std::chrono::steady_clock::now();
+
+    // Rings live until exit so a finished thread still shows up in the dump
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    std::atomic<uint64_t> lastBudgetDump{0};
+    std::atomic<int> budgetDumps{0};
+
+    // Writes the automatic dumps, so the tick that ran over does not also pay for the file.
+    // Started on the first dump, what is still queued at exit gets written before it joins
+    class DumpThread
+    {
+    public:
+        ~DumpThread()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+
+            if (thread.joinable())
+                thread.join();
+        }
+
+        void Request(std::string path)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!thread.joinable())
+                thread = std::thread(&DumpThread::Run, this);
+
+            pending.push_back(std::move(path));
+            wake.notify_one();
+        }
+
+    private:
+        void Run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty())
+                    return;
+
+                const std::string path = std::move(pending.front());
+                pending.erase(pending.begin());
+
+                lock.unlock();
+                Profiler::DumpChromeTrace(path);
+                lock.lock();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<std::string> pending;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    // After the rings, so it is gone before them
+    DumpThread dumpThread;
+
+    Ring& ThreadRing()
+    {
+        thread_local Ring* ring = [] {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(std::make_unique<Ring>());
+            rings.back()->threadId = static_cast<int>(rings.size());
+            return rings.back().get();
+        }();
+
+        return *ring;
+    }
+}
+
+uint64_t Profiler::Now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+    Ring& ring = ThreadRing();
+
+    // Only this thread writes its ring, the head is published for the dump
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % Ring::CAPACITY] = {name, start, end - start};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::DumpChromeTrace(const std::string& path)
+{
+    struct ThreadEvent
+    {
+        Event event;
+        int threadId;
+    };
+
+    // Copied out first, threads starting up wait on the lock while it is held, not on the file
+    std::vector<ThreadEvent> copied;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto& ring : rings)
+        {
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            const uint64_t count = head < Ring::CAPACITY ? head : Ring::CAPACITY;
+
+            for (uint64_t i = head - count; i < head; i++)
+            {
+                const Event event = ring->events[i % Ring::CAPACITY];
+
+                // The owner keeps recording while we read. If it got round to this slot during the
+                // copy, the copy may be half old and half new, so it is dropped
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ring->head.load(std::memory_order_relaxed) - i > Ring::CAPACITY - 1)
+                    continue;
+
+                copied.push_back({event, ring->threadId});
+            }
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        Utils::printMsg("Could not write trace " + path, error);
+        return false;
+    }
+
+    std::fputs("{\"traceEvents\":[\n", file);
+    bool first = true;
+
+    for (const ThreadEvent& copy : copied)
+    {
+        std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                     first ? "" : ",\n", copy.event.name, copy.event.start / 1000.0, copy.event.duration / 1000.0, copy.threadId);
+        first = false;
+    }
+
+    std::fputs("\n]}\n", file);
+    std::fclose(file);
+
+    Utils::printMsg("Trace written to " + path, info);
+    return true;
+}
+
+void Profiler::OnBudgetExceeded(const char* name, uint64_t duration)
+{
+    const uint64_t now = Now();
+    uint64_t last = lastBudgetDump.load(std::memory_order_relaxed);
+
+    if (last != 0 && now - last < static_cast<uint64_t>(BUDGET_DUMP_INTERVAL * 1e9f))
+        return;
+    if (!lastBudgetDump.compare_exchange_strong(last, now))
+        return;
+
+    const int index = budgetDumps.fetch_add(1);
+    PRINT_MSGF(warning, "%s took %llu us, over budget", name, static_cast<unsigned long long>(duration / 1000));
+
+    // The path and the dump thread's first start allocate. The frame already missed its budget,
+    // strict mode is about the frames that did not
+    ALLOC_EXEMPT();
+    dumpThread.Request("trace_" + std::string(name) + "_" + std::to_string(index) + ".json");
+}
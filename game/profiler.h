@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "alloc_tracker.h"
+
+// Scoped timing zones for ticks and frames, dumped as Chrome trace JSON (open it in
+// chrome://tracing or https://ui.perfetto.dev). Every thread records into its own ring,
+// so a zone costs two clock reads and a store. Build with TANK_PROFILER (CMake option)
+// to get them, otherwise every macro below expands to nothing
+//
+//   PROFILE_ZONE("Name");                  times the rest of the scope
+//   PROFILE_BUDGET("Name", seconds);       same, and dumps a trace when the scope runs over
+//   PROFILE_DUMP("file.json");             writes what the rings hold right now
+//
+// Zones are also where heap allocations get attributed when TANK_ALLOC_TRACKING is on (alloc_tracker.h)
+namespace Profiler
+{
+    // Nanoseconds since the profiler started
+    uint64_t Now();
+
+    void Record(const char* name, uint64_t start, uint64_t end);
+
+    bool DumpChromeTrace(const std::string& path);
+
+    // Writes trace_<name>_<n>.json on a background thread, at most once every few seconds so a bad
+    // patch does not fill the disk
+    void OnBudgetExceeded(const char* name, uint64_t duration);
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) : name(name), start(Now()) {}
+        ~Zone() { Record(name, start, Now()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+    };
+
+    class BudgetZone
+    {
+    public:
+        BudgetZone(const char* name, float budgetSeconds)
+            : name(name), budget(static_cast<uint64_t>(budgetSeconds * 1e9f)), start(Now()) {}
+
+        ~BudgetZone()
+        {
+            const uint64_t end = Now();
+            Record(name, start, end);
+
+            if (end - start > budget)
+                OnBudgetExceeded(name, end - start);
+        }
+
+        BudgetZone(const BudgetZone&) = delete;
+        BudgetZone& operator=(const BudgetZone&) = delete;
+
+    private:
+        const char* name;
+        uint64_t budget;
+        uint64_t start;
+    };
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef TANK_PROFILER
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name); ALLOC_ZONE(name)
+#define PROFILE_BUDGET(name, seconds) Profiler::BudgetZone PROFILE_CONCAT(profileZone, __LINE__)(name, seconds); ALLOC_ZONE(name)
+#define PROFILE_DUMP(path) Profiler::DumpChromeTrace(path)
+#else
+#define PROFILE_ZONE(name) ALLOC_ZONE(name)
+#define PROFILE_BUDGET(name, seconds) ALLOC_ZONE(name)
+#define PROFILE_DUMP(path) ((void)0)
+#endif
@@ -6,13 +6,15 @@
 #include <SFML/Network/Packet.hpp>
 #include <vector>
 #include <cstdint>
+#include "message_schema.h"
+#include "message_stream.h"
 
 enum class MessageTypeProtocole : uint8_t {
     // Client to server enums
     JOIN_REQUEST = 0,
     TANK_UPDATE = 1,
     DISCONNECT = 2,
-    PickUP_HIT = 3,
+    PickUP_HIT = 3,   // no longer sent, the server detects pickups itself
 
     //---------------------------------
     // Server to client enums
@@ -27,52 +29,95 @@ enum class MessageTypeProtocole : uint8_t {
     OBSTACLE_SEED = 12,
     PLAYER_RESPAWNED = 13,
     PickUP_DATA = 14,
-    PickUp_UPDATE = 15
+    PickUp_UPDATE = 15,
+
+    //---------------------------------
+    // Both ways
+    RELIABLE = 16, // sequence + a wrapped message, see reliable_channel.h
+    BUNDLE = 17    // several length prefixed messages in one datagram, see message_batch.h
 };
 
+// Name of a message type, for logs and metrics
+inline const char* MessageTypeName(MessageTypeProtocole type)
+{
+    switch (type)
+    {
+        case MessageTypeProtocole::JOIN_REQUEST: return "JOIN_REQUEST";
+        case MessageTypeProtocole::TANK_UPDATE: return "TANK_UPDATE";
+        case MessageTypeProtocole::DISCONNECT: return "DISCONNECT";
+        case MessageTypeProtocole::PickUP_HIT: return "PICKUP_HIT";
+        case MessageTypeProtocole::JOIN_ACCEPTED: return "JOIN_ACCEPTED";
+        case MessageTypeProtocole::JOIN_REJECTED: return "JOIN_REJECTED";
+        case MessageTypeProtocole::GAME_STATE: return "GAME_STATE";
+        case MessageTypeProtocole::PLAYER_JOINED: return "PLAYER_JOINED";
+        case MessageTypeProtocole::PLAYER_LEFT: return "PLAYER_LEFT";
+        case MessageTypeProtocole::BULLET_SPAWNED: return "BULLET_SPAWNED";
+        case MessageTypeProtocole::PLAYER_HIT: return "PLAYER_HIT";
+        case MessageTypeProtocole::PLAYER_DIED: return "PLAYER_DIED";
+        case MessageTypeProtocole::OBSTACLE_SEED: return "OBSTACLE_SEED";
+        case MessageTypeProtocole::PLAYER_RESPAWNED: return "PLAYER_RESPAWNED";
+        case MessageTypeProtocole::PickUP_DATA: return "PICKUP_DATA";
+        case MessageTypeProtocole::PickUp_UPDATE: return "PICKUP_UPDATE";
+        case MessageTypeProtocole::RELIABLE: return "RELIABLE";
+        case MessageTypeProtocole::BUNDLE: return "BUNDLE";
+    }
+    return "UNKNOWN";
+}
+
+// Limits used by the schema to size buffers and to reject broken messages
+constexpr std::size_t MAX_NAME_LENGTH = 32;
+constexpr std::size_t MAX_COLOR_LENGTH = 8;
+constexpr std::size_t MAX_REASON_LENGTH = 128;
+constexpr std::size_t MAX_MAP_NAME_LENGTH = 64;
+constexpr std::size_t MAX_SNAPSHOT_PLAYERS = 64;
+constexpr std::size_t MAX_SNAPSHOT_BULLETS = 256;
+constexpr std::size_t MAX_PICKUPS = 255;
+
+// Every message declares its id and its fields once, schema generates the rest.
+// The order of Fields() is the order on the wire.
+
 // Client requests to join
 struct JoinRequestMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::JOIN_REQUEST;
+
     std::string playerName;
     uint16_t udpPort;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const JoinRequestMessage& msg) {
-        return packet << msg.playerName << msg.udpPort;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, JoinRequestMessage& msg) {
-        return packet >> msg.playerName >> msg.udpPort;
+    static constexpr auto Fields() {
+        using M = JoinRequestMessage;
+        return std::make_tuple(schema::Text<MAX_NAME_LENGTH>(&M::playerName), schema::Field(&M::udpPort));
     }
 };
 
 // Server accepts join
 struct JoinAcceptedMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::JOIN_ACCEPTED;
+
     uint8_t assignedPlayerId;
     std::string tankColor;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const JoinAcceptedMessage& msg) {
-        return packet << msg.assignedPlayerId << msg.tankColor;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, JoinAcceptedMessage& msg) {
-        return packet >> msg.assignedPlayerId >> msg.tankColor;
+    static constexpr auto Fields() {
+        using M = JoinAcceptedMessage;
+        return std::make_tuple(schema::Field(&M::assignedPlayerId), schema::Text<MAX_COLOR_LENGTH>(&M::tankColor));
     }
 };
 
 // Server rejects
 struct JoinRejectedMessage {
-    std::string message;
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::JOIN_REJECTED;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const JoinRejectedMessage& msg) {
-        return packet << msg.message;
-    }
+    std::string message;
 
-    friend sf::Packet& operator>>(sf::Packet& packet, JoinRejectedMessage& msg) {
-        return packet >> msg.message;
+    static constexpr auto Fields() {
+        using M = JoinRejectedMessage;
+        return std::make_tuple(schema::Text<MAX_REASON_LENGTH>(&M::message));
     }
 };
 
 // Client sends input every frame
 struct TankMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::TANK_UPDATE;
+
     float x, y;
     float rotationBody;
     float rotationBarrel;
@@ -80,23 +125,30 @@ struct TankMessage {
     bool shootPressed;
     bool isAlive;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const TankMessage& msg) {
-        return packet << msg.playerId
-                      << msg.x << msg.y
-                      << msg.rotationBody << msg.rotationBarrel
-                      << msg.shootPressed << msg.isAlive;
+    static constexpr auto Fields() {
+        using M = TankMessage;
+        return std::make_tuple(schema::Field(&M::playerId),
+                               schema::Field(&M::x), schema::Field(&M::y),
+                               schema::Field(&M::rotationBody), schema::Field(&M::rotationBarrel),
+                               schema::Field(&M::shootPressed), schema::Field(&M::isAlive));
     }
+};
+
+// Client leaves the game
+struct DisconnectMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::DISCONNECT;
+
+    uint8_t playerId;
 
-    friend sf::Packet& operator>>(sf::Packet& packet, TankMessage& msg) {
-        return packet >> msg.playerId
-                      >> msg.x >> msg.y
-                      >> msg.rotationBody >> msg.rotationBarrel
-                      >> msg.shootPressed >> msg.isAlive;
+    static constexpr auto Fields() {
+        using M = DisconnectMessage;
+        return std::make_tuple(schema::Field(&M::playerId));
     }
 };
 
 // Complete game snapshot
 struct GameSnapMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::GAME_STATE;
 
     struct Player {
         uint8_t playerId;
@@ -107,6 +159,14 @@ struct GameSnapMessage {
         uint8_t ammo;
         bool isAlive;
         std::string color;
+
+        static constexpr auto Fields() {
+            using M = Player;
+            return std::make_tuple(schema::Field(&M::playerId), schema::Field(&M::x), schema::Field(&M::y),
+                                   schema::Field(&M::rotationBody), schema::Field(&M::rotationBarrel),
+                                   schema::Field(&M::health), schema::Field(&M::ammo), schema::Field(&M::isAlive),
+                                   schema::Text<MAX_COLOR_LENGTH>(&M::color));
+        }
     };
 
     struct Bullet {
@@ -114,214 +174,167 @@ struct GameSnapMessage {
         float x, y;
         float rotation;
         uint8_t ownerId;
+
+        static constexpr auto Fields() {
+            using M = Bullet;
+            return std::make_tuple(schema::Field(&M::bulletId), schema::Field(&M::x), schema::Field(&M::y),
+                                   schema::Field(&M::rotation), schema::Field(&M::ownerId));
+        }
     };
 
     std::vector<Player> players;
     std::vector<Bullet> bullets;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const GameSnapMessage& msg) {
-        // Players
-        packet << static_cast<uint32_t>(msg.players.size());
-        for (const auto& p : msg.players) {
-            packet << p.playerId << p.x << p.y
-                   << p.rotationBody << p.rotationBarrel
-                   << p.health << p.ammo << p.isAlive << p.color;
-        }
-
-        // Bullets
-        packet << static_cast<uint32_t>(msg.bullets.size());
-        for (const auto& b : msg.bullets) {
-            packet << b.bulletId << b.x << b.y << b.rotation << b.ownerId;
-        }
-        return packet;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, GameSnapMessage& msg) {
-        uint32_t playerCount, bulletCount;
-
-        // Players
-        packet >> playerCount;
-        msg.players.clear();
-        msg.players.reserve(playerCount);
-        for (uint32_t i = 0; i < playerCount; i++) {
-            GameSnapMessage::Player player;
-            packet >> player.playerId >> player.x >> player.y
-                   >> player.rotationBody >> player.rotationBarrel
-                   >> player.health >> player.ammo >> player.isAlive >> player.color;
-            msg.players.push_back(player);
-        }
-
-        // Bullets
-        packet >> bulletCount;
-        msg.bullets.clear();
-        msg.bullets.reserve(bulletCount);
-        for (uint32_t i = 0; i < bulletCount; i++) {
-            GameSnapMessage::Bullet bullet;
-            packet >> bullet.bulletId >> bullet.x >> bullet.y >> bullet.rotation >> bullet.ownerId;
-            msg.bullets.push_back(bullet);
-        }
-        return packet;
+    static constexpr auto Fields() {
+        using M = GameSnapMessage;
+        return std::make_tuple(schema::List<uint32_t, MAX_SNAPSHOT_PLAYERS>(&M::players),
+                               schema::List<uint32_t, MAX_SNAPSHOT_BULLETS>(&M::bullets));
     }
 };
 
 // Server notifies new player joined
 struct PlayerJoinedMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PLAYER_JOINED;
+
     uint8_t playerId;
     std::string color;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PlayerJoinedMessage& msg) {
-        return packet << msg.playerId << msg.color;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, PlayerJoinedMessage& msg) {
-        return packet >> msg.playerId >> msg.color;
+    static constexpr auto Fields() {
+        using M = PlayerJoinedMessage;
+        return std::make_tuple(schema::Field(&M::playerId), schema::Text<MAX_COLOR_LENGTH>(&M::color));
     }
 };
 
 // Server notifies player left
 struct PlayerLeftMessage {
-    uint8_t playerId;
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PLAYER_LEFT;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PlayerLeftMessage& msg) {
-        return packet << msg.playerId;
-    }
+    uint8_t playerId;
 
-    friend sf::Packet& operator>>(sf::Packet& packet, PlayerLeftMessage& msg) {
-        return packet >> msg.playerId;
+    static constexpr auto Fields() {
+        using M = PlayerLeftMessage;
+        return std::make_tuple(schema::Field(&M::playerId));
     }
 };
 
 // Server notifies bullet spawned
 struct BulletSpawnedMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::BULLET_SPAWNED;
+
     uint8_t bulletId;
     float x, y;
     float rotation;
     uint8_t ownerId;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const BulletSpawnedMessage& msg) {
-        return packet << msg.bulletId << msg.x << msg.y << msg.rotation << msg.ownerId;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, BulletSpawnedMessage& msg) {
-        return packet >> msg.bulletId >> msg.x >> msg.y >> msg.rotation >> msg.ownerId;
+    static constexpr auto Fields() {
+        using M = BulletSpawnedMessage;
+        return std::make_tuple(schema::Field(&M::bulletId), schema::Field(&M::x), schema::Field(&M::y),
+                               schema::Field(&M::rotation), schema::Field(&M::ownerId));
     }
 };
 
 // Server notifies player died
 struct PlayerDiedMessage {
-    uint8_t victimId;
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PLAYER_DIED;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PlayerDiedMessage& msg) {
-        return packet << msg.victimId;
-    }
+    uint8_t victimId;
 
-    friend sf::Packet& operator>>(sf::Packet& packet, PlayerDiedMessage& msg) {
-        return packet >> msg.victimId;
+    static constexpr auto Fields() {
+        using M = PlayerDiedMessage;
+        return std::make_tuple(schema::Field(&M::victimId));
     }
 };
 
 // Server notifies player respawned
 struct PlayerRespawnedMessage {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PLAYER_RESPAWNED;
+
     uint8_t playerId;
     float x, y;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PlayerRespawnedMessage& msg) {
-        return packet << msg.playerId << msg.x << msg.y;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, PlayerRespawnedMessage& msg) {
-        return packet >> msg.playerId >> msg.x >> msg.y;
+    static constexpr auto Fields() {
+        using M = PlayerRespawnedMessage;
+        return std::make_tuple(schema::Field(&M::playerId), schema::Field(&M::x), schema::Field(&M::y));
     }
 };
 
-// Server sends seed
+// Server sends seed, or the map file it loaded (mapName empty when the world is generated)
 struct ObstacleSeedMessage
 {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::OBSTACLE_SEED;
+
     uint16_t seed;
-    friend sf::Packet& operator<<(sf::Packet& packet, const ObstacleSeedMessage& msg)
-    {
-        return packet << msg.seed;
-    }
 
-    friend sf::Packet& operator>>(sf::Packet& packet, ObstacleSeedMessage& msg)
-    {
-        return packet >> msg.seed;
+    // Size of the world in chunks (world_chunks.h)
+    uint16_t chunkColumns;
+    uint16_t chunkRows;
+
+    // File name only, clients look for it in their own map folder. The checksum is the one in
+    // the map header, a client with another version of the file does not use it
+    std::string mapName;
+    uint32_t mapChecksum = 0;
+
+    static constexpr auto Fields() {
+        using M = ObstacleSeedMessage;
+        return std::make_tuple(schema::Field(&M::seed), schema::Field(&M::chunkColumns), schema::Field(&M::chunkRows),
+                               schema::Text<MAX_MAP_NAME_LENGTH>(&M::mapName), schema::Field(&M::mapChecksum));
     }
 };
 
 // Send pickups
 struct PickUpMessage
 {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PickUP_DATA;
+
     struct PickUpData
     {
         uint8_t pickUpId;
         uint8_t pickUpType;  // 0 = AmmoBox, 1 = HealthKit
         float x, y;
-    };
-
-    std::vector<PickUpData> pickUps;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PickUpMessage& msg)
-    {
-        packet <<  static_cast<uint8_t>(msg.pickUps.size());
-        for (const auto& p : msg.pickUps)
-        {
-            packet << p.pickUpId << p.pickUpType << p.x << p.y;
+        static constexpr auto Fields() {
+            using M = PickUpData;
+            return std::make_tuple(schema::Field(&M::pickUpId), schema::Field(&M::pickUpType),
+                                   schema::Field(&M::x), schema::Field(&M::y));
         }
+    };
 
-        return packet;
-    }
-
-    friend sf::Packet& operator>>(sf::Packet& packet, PickUpMessage& msg)
-    {
-        uint8_t count;
-        packet >> count;
-        msg.pickUps.clear();
-        msg.pickUps.reserve(count);
-
-        for (uint8_t i = 0; i < count; i++) {
-            PickUpMessage::PickUpData p{};
-            packet >> p.pickUpId >> p.pickUpType >> p.x >> p.y;
-            msg.pickUps.push_back(p);
-        }
+    std::vector<PickUpData> pickUps;
 
-        return packet;
+    static constexpr auto Fields() {
+        using M = PickUpMessage;
+        return std::make_tuple(schema::List<uint8_t, MAX_PICKUPS>(&M::pickUps));
     }
 };
 
-// Player hit specific pickup
-struct PickUpHitMessage
-{
-    uint8_t playerId;
-    uint8_t pickUpId;
-    uint8_t pickUpType;
-
-    PickUpMessage pickUpMessage;
-
-    friend sf::Packet& operator<<(sf::Packet& packet, const PickUpHitMessage& msg)
-    {
-        return packet << msg.playerId << msg.pickUpId << msg.pickUpType;
-    }
+// Nobody collected it, the pickup only moved
+constexpr uint8_t NO_COLLECTOR = 0xFF;
 
-    friend sf::Packet& operator>>(sf::Packet& packet, PickUpHitMessage& msg) {
-        return packet >> msg.playerId >> msg.pickUpId >> msg.pickUpType;
-    }
-};
-
-// New specific pickup pos
+// A tank drove over a pickup on the server, collectorId got its ammo or health and the pickup moved
 struct PickUpUpdatedMessage
 {
+    static constexpr MessageTypeProtocole ID = MessageTypeProtocole::PickUp_UPDATE;
+
     uint8_t pickUpId;
     uint8_t pickUpType;
     float x, y;
+    uint8_t collectorId = NO_COLLECTOR;
 
-    friend sf::Packet& operator<<(sf::Packet& packet, const PickUpUpdatedMessage& msg)
-    {
-        return packet << msg.pickUpId << msg.pickUpType << msg.x << msg.y;
+    static constexpr auto Fields() {
+        using M = PickUpUpdatedMessage;
+        return std::make_tuple(schema::Field(&M::pickUpId), schema::Field(&M::pickUpType),
+                               schema::Field(&M::x), schema::Field(&M::y), schema::Field(&M::collectorId));
     }
+};
 
-    friend sf::Packet& operator>>(sf::Packet& packet, PickUpUpdatedMessage& msg)
-    {
-        return packet >> msg.pickUpId >> msg.pickUpType >> msg.x >> msg.y;
-    }
-};
\ No newline at end of file
+// Every message of the protocol, used for the compile time checks below
+using ProtocolMessages = std::tuple<
+    JoinRequestMessage, JoinAcceptedMessage, JoinRejectedMessage, TankMessage, DisconnectMessage,
+    GameSnapMessage, PlayerJoinedMessage, PlayerLeftMessage, BulletSpawnedMessage, PlayerDiedMessage,
+    PlayerRespawnedMessage, ObstacleSeedMessage, PickUpMessage, PickUpUpdatedMessage>;
+
+// Biggest message (type byte included) any side can ever send, good size for preallocated buffers
+constexpr std::size_t MAX_PROTOCOL_MESSAGE_SIZE = schema::LargestMessage(static_cast<ProtocolMessages*>(nullptr));
+
+static_assert(MAX_PROTOCOL_MESSAGE_SIZE <= MAX_MESSAGE_SIZE, "A message can outgrow the send buffers");
+static_assert(schema::IdsAreUnique(static_cast<ProtocolMessages*>(nullptr)), "Two messages share the same id");
@@ -0,0 +1,157 @@
+#include "reliable_channel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Resend timer limits in seconds, before the first RTT sample we use the default
+static constexpr float MIN_RESEND_TIMEOUT = 0.05f;
+static constexpr float MAX_RESEND_TIMEOUT = 1.0f;
+static constexpr float DEFAULT_RESEND_TIMEOUT = 0.2f;
+
+bool ReliableChannel::Send(const MessageWriter& message)
+{
+    if (!message || message.GetSize() > MAX_PAYLOAD)
+        return false;
+
+    // Behind anything already waiting, so the order holds
+    if (GetQueuedCount() > 0 || GetPendingCount() >= WINDOW)
+    {
+        QueuedMessage& queued = overflow.emplace_back();
+        std::memcpy(queued.data.data(), message.GetData(), message.GetSize());
+        queued.size = message.GetSize();
+        return true;
+    }
+
+    AddToWindow(message.GetData(), message.GetSize());
+    return true;
+}
+
+void ReliableChannel::AddToWindow(const std::byte* data, std::size_t size)
+{
+    Slot& slot = sendSlots[nextSendSequence % WINDOW];
+    std::memcpy(slot.data.data(), data, size);
+    slot.size = size;
+    slot.sequence = nextSendSequence;
+    slot.inUse = true;
+    slot.sendCount = 0;
+
+    nextSendSequence++;
+}
+
+void ReliableChannel::FillWindow()
+{
+    while (GetQueuedCount() > 0 && GetPendingCount() < WINDOW)
+    {
+        const QueuedMessage& queued = overflow[overflowHead++];
+        AddToWindow(queued.data.data(), queued.size);
+    }
+
+    // Emptied, or the moved ones taking more room than the ones still waiting
+    if (overflowHead == overflow.size())
+    {
+        overflow.clear();
+        overflowHead = 0;
+    }
+    else if (overflowHead > overflow.size() / 2)
+    {
+        overflow.erase(overflow.begin(), overflow.begin() + static_cast<std::ptrdiff_t>(overflowHead));
+        overflowHead = 0;
+    }
+}
+
+AckHeader ReliableChannel::GetAckHeader() const
+{
+    AckHeader header;
+    header.ack = static_cast<uint16_t>(nextExpected - 1);
+    header.ackBits = 0;
+
+    // Everything after the gap that already arrived
+    for (std::size_t i = 0; i + 1 < WINDOW; i++)
+    {
+        const uint16_t sequence = static_cast<uint16_t>(nextExpected + 1 + i);
+        const Slot& slot = receiveSlots[sequence % WINDOW];
+
+        if (slot.inUse && slot.sequence == sequence)
+            header.ackBits |= 1u << i;
+    }
+
+    return header;
+}
+
+void ReliableChannel::OnAckHeader(const AckHeader& header, float now)
+{
+    for (uint16_t sequence = oldestUnacked; sequence != nextSendSequence; ++sequence)
+    {
+        Slot& slot = sendSlots[sequence % WINDOW];
+        if (!slot.inUse || slot.sendCount == 0)
+            continue;
+
+        bool acked = SequenceLessEqual(sequence, header.ack);
+        if (!acked)
+        {
+            const uint16_t bit = static_cast<uint16_t>(sequence - header.ack - 2);
+            acked = bit < 32 && (header.ackBits & (1u << bit)) != 0;
+        }
+
+        if (!acked)
+            continue;
+
+        // Only messages sent once give a clean sample (Karn's algorithm)
+        if (slot.sendCount == 1)
+            AddRttSample(now - slot.firstSent);
+
+        slot.inUse = false;
+    }
+
+    AdvanceOldestUnacked();
+}
+
+void ReliableChannel::OnReceive(uint16_t sequence, const std::byte* data, std::size_t size)
+{
+    if (size > MAX_PAYLOAD)
+        return;
+
+    // Already delivered (a resend whose ack got lost) or too far ahead to keep
+    const uint16_t distance = static_cast<uint16_t>(sequence - nextExpected);
+    if (distance >= WINDOW)
+        return;
+
+    Slot& slot = receiveSlots[sequence % WINDOW];
+    if (slot.inUse && slot.sequence == sequence)
+        return;
+
+    std::memcpy(slot.data.data(), data, size);
+    slot.size = size;
+    slot.sequence = sequence;
+    slot.inUse = true;
+}
+
+float ReliableChannel::GetResendTimeout() const
+{
+    if (!hasRttSample)
+        return DEFAULT_RESEND_TIMEOUT;
+
+    return std::clamp(smoothedRtt + 4.f * rttVariance, MIN_RESEND_TIMEOUT, MAX_RESEND_TIMEOUT);
+}
+
+void ReliableChannel::AddRttSample(float sample)
+{
+    if (!hasRttSample)
+    {
+        smoothedRtt = sample;
+        rttVariance = sample / 2.f;
+        hasRttSample = true;
+        return;
+    }
+
+    rttVariance = 0.75f * rttVariance + 0.25f * std::abs(smoothedRtt - sample);
+    smoothedRtt = 0.875f * smoothedRtt + 0.125f * sample;
+}
+
+void ReliableChannel::AdvanceOldestUnacked()
+{
+    while (oldestUnacked != nextSendSequence && !sendSlots[oldestUnacked % WINDOW].inUse)
+    {
+        oldestUnacked++;
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "protocole_message.h"
+
+// Acks for the reliable channel, piggybacked on snapshots (server -> client) and
+// tank updates (client -> server) so they never need a datagram of their own.
+// ack is the last sequence delivered in order, bit i of ackBits means ack + 2 + i
+// already arrived and is waiting for the gap before it to be filled
+struct AckHeader
+{
+    uint16_t ack = 0xFFFF;
+    uint32_t ackBits = 0;
+
+    static constexpr auto Fields() {
+        using M = AckHeader;
+        return std::make_tuple(schema::Field(&M::ack), schema::Field(&M::ackBits));
+    }
+};
+
+constexpr std::size_t ACK_HEADER_SIZE = schema::MaxEncodedSize<AckHeader>();
+
+// Sequenced, acked and resent messages over the normal UDP socket. Each side of a
+// connection owns one. Messages are delivered in the order they were sent, one lost
+// datagram only delays the ones behind it until the resend lands
+class ReliableChannel
+{
+public:
+    // Max messages in flight, also how far ahead of a gap the receiver keeps messages
+    static constexpr std::size_t WINDOW = 32;
+    // Biggest single message (type byte included) the channel carries
+    static constexpr std::size_t MAX_PAYLOAD = 256;
+
+    // Queue a full message (type byte + fields). False only if it is too big, with the window
+    // full it waits behind the others until acks make room
+    bool Send(const MessageWriter& message);
+
+    // Moves what waited for the window into the slots acks freed, then writes every message that
+    // was never sent or is due a resend. SendFn gets a MessageWriter holding [RELIABLE][sequence][message]
+    template <typename SendFn>
+    void Flush(float now, SendFn&& send);
+
+    AckHeader GetAckHeader() const;
+    void OnAckHeader(const AckHeader& header, float now);
+
+    // Store a message received with a RELIABLE header, duplicates and out of window are dropped
+    void OnReceive(uint16_t sequence, const std::byte* data, std::size_t size);
+
+    // Hand every message that is now in order to the handler as a MessageReader
+    template <typename Handler>
+    void Deliver(Handler&& handler);
+
+    // Round trip measured from acks, in seconds
+    float GetRtt() const { return smoothedRtt; }
+    float GetResendTimeout() const;
+
+    // Messages waiting for an ack
+    std::size_t GetPendingCount() const { return static_cast<uint16_t>(nextSendSequence - oldestUnacked); }
+
+    // Messages waiting for a place in the window
+    std::size_t GetQueuedCount() const { return overflow.size() - overflowHead; }
+
+private:
+    struct Slot
+    {
+        std::array<std::byte, MAX_PAYLOAD> data;
+        std::size_t size = 0;
+        uint16_t sequence = 0;
+        bool inUse = false;
+
+        // Sending side only
+        float firstSent = 0.f;
+        float lastSent = 0.f;
+        int sendCount = 0;
+    };
+
+    // Sending side
+    std::array<Slot, WINDOW> sendSlots;
+    uint16_t nextSendSequence = 0;
+    uint16_t oldestUnacked = 0;
+
+    // Sent while the window was full, oldest at overflowHead
+    struct QueuedMessage
+    {
+        std::array<std::byte, MAX_PAYLOAD> data;
+        std::size_t size = 0;
+    };
+    std::vector<QueuedMessage> overflow;
+    std::size_t overflowHead = 0;
+
+    void AddToWindow(const std::byte* data, std::size_t size);
+    void FillWindow();
+
+    // Receiving side
+    std::array<Slot, WINDOW> receiveSlots;
+    uint16_t nextExpected = 0;
+
+    // RTT estimate (RFC 6298 style), used for the resend timer
+    bool hasRttSample = false;
+    float smoothedRtt = 0.f;
+    float rttVariance = 0.f;
+
+    void AddRttSample(float sample);
+    void AdvanceOldestUnacked();
+};
+
+// a is older than or the same as b, with wrap around
+inline bool SequenceLessEqual(uint16_t a, uint16_t b)
+{
+    return static_cast<uint16_t>(b - a) < 0x8000;
+}
+
+template <typename SendFn>
+void ReliableChannel::Flush(float now, SendFn&& send)
+{
+    FillWindow();
+
+    const float timeout = GetResendTimeout();
+
+    for (uint16_t sequence = oldestUnacked; sequence != nextSendSequence; ++sequence)
+    {
+        Slot& slot = sendSlots[sequence % WINDOW];
+        if (!slot.inUse)
+            continue;
+
+        // Back off a bit more on every resend of the same message
+        const int backoff = slot.sendCount < 4 ? slot.sendCount : 4;
+        if (slot.sendCount > 0 && now - slot.lastSent < timeout * static_cast<float>(1 << (backoff - 1)))
+            continue;
+
+        MessageWriter writer(GetSendBuffer());
+        writer << static_cast<uint8_t>(MessageTypeProtocole::RELIABLE) << slot.sequence;
+        writer.Append(slot.data.data(), slot.size);
+
+        if (slot.sendCount == 0)
+            slot.firstSent = now;
+        slot.lastSent = now;
+        slot.sendCount++;
+
+        send(writer);
+    }
+}
+
+template <typename Handler>
+void ReliableChannel::Deliver(Handler&& handler)
+{
+    for (Slot* slot = &receiveSlots[nextExpected % WINDOW];
+         slot->inUse && slot->sequence == nextExpected;
+         slot = &receiveSlots[nextExpected % WINDOW])
+    {
+        MessageReader reader(slot->data.data(), slot->size);
+        slot->inUse = false;
+        nextExpected++;
+
+        handler(reader);
+    }
+}
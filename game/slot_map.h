@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Names an element of a SlotMap. The generation changes every time its slot is reused, so a
+// handle kept after the element was removed finds nothing instead of the next one
+struct SlotHandle
+{
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    uint32_t slot = NO_SLOT;
+    uint32_t generation = 0;
+
+    bool operator==(const SlotHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Elements packed in one vector, reached in O(1) through handles that stay valid while the
+// element lives. Remove moves the last element into the hole, so iterating is a linear walk
+// with no gaps but the order is not kept
+template <typename T>
+class SlotMap
+{
+public:
+    template <typename... Args>
+    SlotHandle Emplace(Args&&... args)
+    {
+        uint32_t slot;
+        if (!freeSlots.empty())
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back({});
+        }
+
+        slots[slot].index = static_cast<uint32_t>(values.size());
+        values.emplace_back(std::forward<Args>(args)...);
+        denseSlots.push_back(slot);
+
+        return {slot, slots[slot].generation};
+    }
+
+    bool Remove(SlotHandle handle)
+    {
+        if (!Contains(handle))
+            return false;
+
+        const uint32_t index = slots[handle.slot].index;
+        const uint32_t last = static_cast<uint32_t>(values.size() - 1);
+
+        if (index != last)
+        {
+            values[index] = std::move(values[last]);
+            denseSlots[index] = denseSlots[last];
+            slots[denseSlots[index]].index = index;
+        }
+
+        values.pop_back();
+        denseSlots.pop_back();
+
+        slots[handle.slot].index = NO_INDEX;
+        slots[handle.slot].generation++;
+        freeSlots.push_back(handle.slot);
+        return true;
+    }
+
+    bool Contains(SlotHandle handle) const
+    {
+        return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation &&
+               slots[handle.slot].index != NO_INDEX;
+    }
+
+    // Null for a removed element
+    T* Get(SlotHandle handle) { return Contains(handle) ? &values[slots[handle.slot].index] : nullptr; }
+    const T* Get(SlotHandle handle) const { return Contains(handle) ? &values[slots[handle.slot].index] : nullptr; }
+
+    // Position in the packed order, only for a handle that is still valid
+    std::size_t IndexOf(SlotHandle handle) const { return slots[handle.slot].index; }
+    SlotHandle HandleAt(std::size_t index) const { return {denseSlots[index], slots[denseSlots[index]].generation}; }
+
+    T& operator[](std::size_t index) { return values[index]; }
+    const T& operator[](std::size_t index) const { return values[index]; }
+
+    std::size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+
+    auto begin() { return values.begin(); }
+    auto end() { return values.end(); }
+    auto begin() const { return values.begin(); }
+    auto end() const { return values.end(); }
+
+    void Reserve(std::size_t count)
+    {
+        values.reserve(count);
+        denseSlots.reserve(count);
+        slots.reserve(count);
+        freeSlots.reserve(count);
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    struct Slot
+    {
+        uint32_t index = NO_INDEX;
+        uint32_t generation = 0;
+    };
+
+    std::vector<T> values;
+    std::vector<uint32_t> denseSlots;   // slot of each value
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+};
+
+// SlotMap also found by player id. Ids are small and handed out in order, so the lookup is a
+// plain vector indexed by id rather than a hash map
+template <typename T>
+class PlayerSlots
+{
+public:
+    // Replaces whatever the id had
+    template <typename... Args>
+    T& Emplace(int playerId, Args&&... args)
+    {
+        Remove(playerId);
+
+        if (static_cast<std::size_t>(playerId) >= byId.size())
+            byId.resize(static_cast<std::size_t>(playerId) + 1);
+
+        const SlotHandle handle = map.Emplace(std::forward<Args>(args)...);
+        byId[playerId] = handle;
+        return *map.Get(handle);
+    }
+
+    bool Remove(int playerId)
+    {
+        return map.Remove(HandleOf(playerId));
+    }
+
+    SlotHandle HandleOf(int playerId) const
+    {
+        if (playerId < 0 || static_cast<std::size_t>(playerId) >= byId.size())
+            return {};
+        return byId[playerId];
+    }
+
+    T* Find(int playerId) { return map.Get(HandleOf(playerId)); }
+    const T* Find(int playerId) const { return map.Get(HandleOf(playerId)); }
+
+    T* Get(SlotHandle handle) { return map.Get(handle); }
+    const T* Get(SlotHandle handle) const { return map.Get(handle); }
+
+    T& operator[](std::size_t index) { return map[index]; }
+    const T& operator[](std::size_t index) const { return map[index]; }
+
+    std::size_t size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+
+    auto begin() { return map.begin(); }
+    auto end() { return map.end(); }
+    auto begin() const { return map.begin(); }
+    auto end() const { return map.end(); }
+
+    void Reserve(std::size_t count) { map.Reserve(count); }
+
+private:
+    SlotMap<T> map;
+    std::vector<SlotHandle> byId;
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "protocole_message.h"
+#include "reliable_channel.h"
+#include "link_stats.h"
+
+// Snapshots are split by entity so no datagram goes over the payload limit (no IP fragmentation).
+// Every part is a full GAME_STATE on its own: [type][AckHeader][PingHeader][SnapshotPartHeader][players][bullets],
+// the client applies whatever parts arrive and a lost one only costs the entities it carried
+struct SnapshotPartHeader
+{
+    uint16_t snapshotId = 0;
+    uint8_t part = 0;
+    uint8_t partCount = 1;
+    uint32_t stateHash = 0;   // low half of the server's state hash, 0 unless DETERMINISTIC_SIM
+
+    static constexpr auto Fields() {
+        using M = SnapshotPartHeader;
+        return std::make_tuple(schema::Field(&M::snapshotId), schema::Field(&M::part), schema::Field(&M::partCount),
+                               schema::Field(&M::stateHash));
+    }
+};
+
+// Everything in a part that is not players or bullets
+constexpr std::size_t SNAPSHOT_PART_OVERHEAD = sizeof(uint8_t) + ACK_HEADER_SIZE + PING_HEADER_SIZE +
+    schema::MaxEncodedSize<SnapshotPartHeader>() + 2 * sizeof(uint32_t);
+
+// Smallest payload limit we accept, one part must always fit at least a player
+constexpr std::size_t MIN_PAYLOAD_SIZE = 256;
+static_assert(SNAPSHOT_PART_OVERHEAD + schema::MaxEncodedSize<GameSnapMessage::Player>() <= MIN_PAYLOAD_SIZE);
+
+struct SnapshotPart
+{
+    std::size_t firstPlayer = 0;
+    std::size_t playerCount = 0;
+    std::size_t firstBullet = 0;
+    std::size_t bulletCount = 0;
+};
+
+// Calls fn for every part the snapshot needs, players first then bullets, sized with the
+// schema max sizes so the split never depends on what is inside the strings. Returns the count
+template <typename PartFn>
+std::size_t SplitSnapshot(const GameSnapMessage& snapShot, std::size_t maxPayload, PartFn&& fn)
+{
+    constexpr std::size_t playerSize = schema::MaxEncodedSize<GameSnapMessage::Player>();
+    constexpr std::size_t bulletSize = schema::MaxEncodedSize<GameSnapMessage::Bullet>();
+
+    const std::size_t budget = (maxPayload < MIN_PAYLOAD_SIZE ? MIN_PAYLOAD_SIZE : maxPayload) - SNAPSHOT_PART_OVERHEAD;
+
+    std::size_t player = 0;
+    std::size_t bullet = 0;
+    std::size_t parts = 0;
+
+    do
+    {
+        SnapshotPart part;
+        part.firstPlayer = player;
+        part.firstBullet = bullet;
+
+        std::size_t used = 0;
+        for (; player < snapShot.players.size() && used + playerSize <= budget; player++)
+            used += playerSize;
+        for (; bullet < snapShot.bullets.size() && used + bulletSize <= budget; bullet++)
+            used += bulletSize;
+
+        part.playerCount = player - part.firstPlayer;
+        part.bulletCount = bullet - part.firstBullet;
+
+        fn(part);
+        parts++;
+    }
+    while (player < snapShot.players.size() || bullet < snapShot.bullets.size());
+
+    return parts;
+}
+
+// Same layout as GameSnapMessage, so the client reads a part straight into one
+template <typename Stream>
+void WriteSnapshotPart(Stream& stream, const GameSnapMessage& snapShot, const SnapshotPart& part,
+                       const SnapshotPartHeader& header)
+{
+    stream << static_cast<uint8_t>(GameSnapMessage::ID) << AckHeader() << PingHeader() << header;
+
+    stream << static_cast<uint32_t>(part.playerCount);
+    for (std::size_t i = part.firstPlayer; i < part.firstPlayer + part.playerCount; i++)
+        stream << snapShot.players[i];
+
+    stream << static_cast<uint32_t>(part.bulletCount);
+    for (std::size_t i = part.firstBullet; i < part.firstBullet + part.bulletCount; i++)
+        stream << snapShot.bullets[i];
+}
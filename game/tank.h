@@ -20,11 +20,19 @@ public:
 
     explicit Tank(std::string colour);
 
+    // Also what the server uses for its own tanks (entity_store.h)
+    static constexpr int MAX_HEALTH = 100;
+    static constexpr int MAX_AMMO = 20;
+    static constexpr float MOVEMENT_SPEED = 300.f;
+    static constexpr float ROTATION_SPEED = 200.f;
+
     void Update(float dt, const CollisionManager& collisionManager);
     const void Render(sf::RenderWindow &window);
 
     // Shooting functionalities, WE NEED METHOD TO SHOOT, RENDER DE BULLETS AND UPDATE THEIR POSITION FOR EACH TANK
     void Shoot();
+    // Reuses a bullet that is done before allocating another, the vector only grows to the most in flight
+    void FireBullet(sf::Vector2f position, sf::Angle direction, float speed);
     void UpdateBullets(float dt, CollisionManager& collisionManager);
     void RenderBullets(sf::RenderWindow& window);
 
@@ -35,6 +43,9 @@ public:
     // Get collision bounds for the tank
     sf::FloatRect GetBounds() const;
 
+    // Pose from the network without simulating, the sprites follow so GetBounds matches
+    void SetPose(sf::Vector2f newPosition, sf::Angle newBodyRotation, sf::Angle newBarrelRotation);
+
 
     struct {
         bool forward = false;
@@ -50,8 +61,7 @@ public:
     } isAiming;
 
     bool wantsToShoot;
-    // Pickup and damage system
-    bool CheckPickupCollision(pickUp* pickup);
+    // Pickup and damage system, pickups are detected by the server
     void TakeDamage(int damage);
 
     void AddAmmo(int amount);
@@ -86,8 +96,8 @@ private:
     // to remove the need to use placeholder textures for sprite initialisation.
 
 
-    float movementSpeed = 300.f;
-    float rotationSpeed = 200.f;
+    float movementSpeed = MOVEMENT_SPEED;
+    float rotationSpeed = ROTATION_SPEED;
     float barrelSpeed = 300.0f;
 
     // Saving current colour
@@ -95,9 +105,6 @@ private:
 
     float barrelLength = 30.f; // Distance from tank center to barrel tip
 
-    const int MAX_HEALTH = 100;
-    const int MAX_AMMO = 20;
-
-    int health = 100;
-    int ammo = 20;
+    int health = MAX_HEALTH;
+    int ammo = MAX_AMMO;
 };
\ No newline at end of file
@@ -3,32 +3,19 @@
 //
 #pragma once
 #include <string>
-#include <iostream>
-#include <chrono>
-#include <iomanip>
-#include <ctime>
+#include "logger.h"
 
 
-enum MessageType { info, debug, warning, error, success };
 enum ConnType { Undefined, TCP, UDP };
 
 class Utils
 {
 public:
-    static void printMsg(std::string msg, MessageType type = info) {
-        const auto now = std::chrono::system_clock::now();
-        const std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
-        std::tm localTime = {};
-        localtime_r(&currentTime, &localTime);  // Changed from localtime_s for Mac
-        const auto timestamp = std::put_time(&localTime, "%Y-%m-%d %H:%M:%S");
-
-        switch (type)
-        {
-        case debug: std::cout << "\033[36m" << timestamp << "   " << msg << "\033[0m" << std::endl; break;
-        case warning: std::cout << "\033[33m" << timestamp << "   " << msg << "\033[0m" << std::endl; break;
-        case error: std::cout << "\033[1;31m" << timestamp << "   " << msg << "\033[0m" << std::endl; break;
-        case success: std::cout << "\033[1;32m" << timestamp << "   " << msg << "\033[0m" << std::endl; break;
-        default: std::cout << timestamp << "   " << msg << std::endl; break;
+    // Queued to the async logger (logger.h), printing happens on its own thread.
+    // On hot paths use PRINT_MSG so filtered messages are not even built
+    static void printMsg(const std::string& msg, MessageType type = info) {
+        if (Logger::IsEnabled(type)) {
+            Logger::Write(msg, type);
         }
     }
 
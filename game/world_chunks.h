@@ -0,0 +1,81 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// The world is a grid of square chunks. Rocks, static colliders, decorations and pickups all
+// belong to the chunk their centre is in, so anything that only cares about an area (the
+// camera, a tank, a bullet) touches a few chunks whatever the size of the map.
+// Static things must be smaller than a chunk, then one ring of neighbours covers everything
+// that can reach into a chunk
+constexpr float CHUNK_SIZE = 320.f;
+
+// Inclusive chunk coordinates, empty when min > max
+struct ChunkRange
+{
+    int minX, minY;
+    int maxX, maxY;
+};
+
+class ChunkLayout
+{
+public:
+    // 4 x 3 is the original 1280 x 960 map
+    explicit ChunkLayout(int columns = 4, int rows = 3)
+        : columns(std::max(1, columns)), rows(std::max(1, rows)) {}
+
+    int GetColumns() const { return columns; }
+    int GetRows() const { return rows; }
+    int GetCount() const { return columns * rows; }
+
+    sf::Vector2f GetWorldSize() const { return {columns * CHUNK_SIZE, rows * CHUNK_SIZE}; }
+
+    // Where tanks join and respawn, the middle of the world
+    sf::Vector2f GetSpawnPoint() const { return GetWorldSize() / 2.f; }
+
+    int Index(int x, int y) const { return y * columns + x; }
+
+    // Points outside the world go to the closest edge chunk
+    int IndexAt(sf::Vector2f point) const
+    {
+        return Index(std::clamp(static_cast<int>(point.x / CHUNK_SIZE), 0, columns - 1),
+                     std::clamp(static_cast<int>(point.y / CHUNK_SIZE), 0, rows - 1));
+    }
+
+    sf::FloatRect GetBounds(int index) const
+    {
+        return {{(index % columns) * CHUNK_SIZE, (index / columns) * CHUNK_SIZE}, {CHUNK_SIZE, CHUNK_SIZE}};
+    }
+
+    // Chunks the rectangle touches, plus rings more around them, clamped to the world
+    ChunkRange Overlapping(const sf::FloatRect& rect, int rings = 0) const
+    {
+        return {std::max(0, static_cast<int>(std::floor(rect.position.x / CHUNK_SIZE)) - rings),
+                std::max(0, static_cast<int>(std::floor(rect.position.y / CHUNK_SIZE)) - rings),
+                std::min(columns - 1, static_cast<int>(std::floor((rect.position.x + rect.size.x) / CHUNK_SIZE)) + rings),
+                std::min(rows - 1, static_cast<int>(std::floor((rect.position.y + rect.size.y) / CHUNK_SIZE)) + rings)};
+    }
+
+    static bool Contains(const ChunkRange& range, int x, int y)
+    {
+        return x >= range.minX && x <= range.maxX && y >= range.minY && y <= range.maxY;
+    }
+
+    template <typename Function>
+    void ForEach(const ChunkRange& range, Function&& function) const
+    {
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            for (int x = range.minX; x <= range.maxX; x++)
+            {
+                function(Index(x, y));
+            }
+        }
+    }
+
+private:
+    int columns;
+    int rows;
+};
@@ -0,0 +1,158 @@
+#include "world_gen.h"
+#include <algorithm>
+#include <cmath>
+
+// About the density of the original map, ten rocks on twelve chunks
+static constexpr int ROCKS_PER_CHUNK_MIN = 0;
+static constexpr int ROCKS_PER_CHUNK_MAX = 2;
+static constexpr int ROCK_MIN_SCALE = 3;
+static constexpr int ROCK_MAX_SCALE = 6;
+static constexpr float SPAWN_CLEARANCE = 100.f;
+
+// Tries for one rock before it is left out, only chunks next to the spawn point ever retry
+static constexpr int ROCK_ATTEMPTS = 64;
+
+static const char* ROCK_TEXTURE = "../Assets/Rock.png";
+
+WorldRandom::WorldRandom(uint64_t seed, uint64_t stream)
+    : increment((stream << 1u) | 1u)
+{
+    Next();
+    state += seed;
+    Next();
+}
+
+uint32_t WorldRandom::Next()
+{
+    const uint64_t old = state;
+    state = old * 6364136223846793005ULL + increment;
+
+    const uint32_t shifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+    const uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+    return (shifted >> rotation) | (shifted << ((-rotation) & 31u));
+}
+
+std::vector<RockPlacement> GenerateChunk(uint32_t seed, const ChunkLayout& chunks, int chunk)
+{
+    WorldRandom random(seed, static_cast<uint64_t>(chunk));
+    const sf::FloatRect bounds = chunks.GetBounds(chunk);
+    const sf::Vector2f spawnPoint = chunks.GetSpawnPoint();
+
+    std::vector<RockPlacement> rocks;
+    const int count = random.RangeInt(ROCKS_PER_CHUNK_MIN, ROCKS_PER_CHUNK_MAX);
+
+    for (int i = 0; i < count; i++)
+    {
+        // Keep the spawn point clear so nobody joins inside a rock
+        for (int attempt = 0; attempt < ROCK_ATTEMPTS; attempt++)
+        {
+            const sf::Vector2f position = {bounds.position.x + random.Range(0.f, bounds.size.x),
+                                           bounds.position.y + random.Range(0.f, bounds.size.y)};
+            const sf::Vector2f fromSpawn = position - spawnPoint;
+
+            if (fromSpawn.x * fromSpawn.x + fromSpawn.y * fromSpawn.y > SPAWN_CLEARANCE * SPAWN_CLEARANCE)
+            {
+                rocks.push_back({position, static_cast<float>(random.RangeInt(ROCK_MIN_SCALE, ROCK_MAX_SCALE))});
+                break;
+            }
+        }
+    }
+
+    return rocks;
+}
+
+WorldLayout GenerateWorld(uint32_t seed, const ChunkLayout& chunks)
+{
+    WorldLayout layout;
+
+    for (int chunk = 0; chunk < chunks.GetCount(); chunk++)
+    {
+        const std::vector<RockPlacement> rocks = GenerateChunk(seed, chunks, chunk);
+        layout.rocks.insert(layout.rocks.end(), rocks.begin(), rocks.end());
+    }
+
+    return layout;
+}
+
+void BuildObstacles(const std::vector<RockPlacement>& rocks, std::vector<std::unique_ptr<obstacle>>& obstacles,
+                    CollisionManager& collisions)
+{
+    for (const RockPlacement& rock : rocks)
+    {
+        auto placed = std::make_unique<obstacle>(
+            ROCK_TEXTURE,
+            rock.position,
+            sf::Vector2f(0, 0),
+            sf::Vector2f(0, 0),
+            sf::Vector2f(rock.scale, rock.scale));
+
+        collisions.AddStaticCollider(placed->GetBounds());
+        obstacles.push_back(std::move(placed));
+    }
+}
+
+OccupancyGrid::OccupancyGrid(float width, float height, float cellSize)
+    : cellSize(cellSize),
+      columns(std::max(1, static_cast<int>(std::ceil(width / cellSize)))),
+      rows(std::max(1, static_cast<int>(std::ceil(height / cellSize)))),
+      blocked(static_cast<std::size_t>(columns * rows), false)
+{
+}
+
+void OccupancyGrid::Block(const sf::FloatRect& rect, float margin)
+{
+    const int left = std::max(0, static_cast<int>(std::floor((rect.position.x - margin) / cellSize)));
+    const int top = std::max(0, static_cast<int>(std::floor((rect.position.y - margin) / cellSize)));
+    const int right = std::min(columns - 1, static_cast<int>(std::floor((rect.position.x + rect.size.x + margin) / cellSize)));
+    const int bottom = std::min(rows - 1, static_cast<int>(std::floor((rect.position.y + rect.size.y + margin) / cellSize)));
+
+    for (int y = top; y <= bottom; y++)
+    {
+        for (int x = left; x <= right; x++)
+        {
+            blocked[static_cast<std::size_t>(y * columns + x)] = true;
+        }
+    }
+}
+
+void OccupancyGrid::BlockBorder(float margin)
+{
+    const int cells = static_cast<int>(std::ceil(margin / cellSize));
+
+    for (int y = 0; y < rows; y++)
+    {
+        for (int x = 0; x < columns; x++)
+        {
+            if (x < cells || y < cells || x >= columns - cells || y >= rows - cells)
+                blocked[static_cast<std::size_t>(y * columns + x)] = true;
+        }
+    }
+}
+
+void OccupancyGrid::Bake()
+{
+    freeCells.clear();
+    for (std::size_t i = 0; i < blocked.size(); i++)
+    {
+        if (!blocked[i])
+            freeCells.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+bool OccupancyGrid::IsFree(sf::Vector2f point) const
+{
+    const int x = static_cast<int>(std::floor(point.x / cellSize));
+    const int y = static_cast<int>(std::floor(point.y / cellSize));
+
+    if (x < 0 || y < 0 || x >= columns || y >= rows)
+        return false;
+
+    return !blocked[static_cast<std::size_t>(y * columns + x)];
+}
+
+int OccupancyGrid::CellAt(sf::Vector2f point) const
+{
+    const int x = std::clamp(static_cast<int>(std::floor(point.x / cellSize)), 0, columns - 1);
+    const int y = std::clamp(static_cast<int>(std::floor(point.y / cellSize)), 0, rows - 1);
+    return y * columns + x;
+}
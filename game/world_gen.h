@@ -0,0 +1,120 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "collision_manager.h"
+#include "obstacle.h"
+#include "world_chunks.h"
+
+// World layout both sides build from the seed and the chunk grid in ObstacleSeedMessage.
+// Everything random in here comes from WorldRandom and never from std::uniform_*_distribution,
+// whose output is up to each standard library, so a client built with another compiler gets
+// the same rocks. Each chunk has its own stream, a chunk can be built without the others
+
+// PCG32 (pcg-random.org), small and with a fixed output on every platform.
+// Also a UniformRandomBitGenerator, so OccupancyGrid::SampleFree takes it as well as std::mt19937
+class WorldRandom
+{
+public:
+    using result_type = uint32_t;
+
+    explicit WorldRandom(uint64_t seed, uint64_t stream = 54);
+
+    uint32_t Next();
+
+    // [0, 1), 24 bits so every value is exact in a float
+    float NextFloat() { return static_cast<float>(Next() >> 8) * (1.f / 16777216.f); }
+    float Range(float min, float max) { return min + (max - min) * NextFloat(); }
+    // Both ends included
+    int RangeInt(int min, int max) { return min + static_cast<int>(Next() % static_cast<uint32_t>(max - min + 1)); }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+    result_type operator()() { return Next(); }
+
+private:
+    uint64_t state = 0;
+    uint64_t increment;
+};
+
+struct RockPlacement
+{
+    sf::Vector2f position;
+    float scale;
+};
+
+struct WorldLayout
+{
+    std::vector<RockPlacement> rocks;
+};
+
+// Rocks of one chunk, what the client streams in
+std::vector<RockPlacement> GenerateChunk(uint32_t seed, const ChunkLayout& chunks, int chunk);
+
+// Every chunk at once, for the server
+WorldLayout GenerateWorld(uint32_t seed, const ChunkLayout& chunks);
+
+// Turns rocks into obstacles and static colliders, the same on both sides
+void BuildObstacles(const std::vector<RockPlacement>& rocks, std::vector<std::unique_ptr<obstacle>>& obstacles,
+                    CollisionManager& collisions);
+
+// Which cells of the world something can be placed in (pickups) or driven through (server
+// bots). Blocked areas are marked once, Bake() then lists the free cells so a random free
+// point is a single draw, no retries
+class OccupancyGrid
+{
+public:
+    OccupancyGrid(float width, float height, float cellSize);
+
+    // Every cell the rectangle, grown by margin on each side, touches
+    void Block(const sf::FloatRect& rect, float margin);
+    void BlockBorder(float margin);
+
+    void Bake();
+
+    bool IsFree(sf::Vector2f point) const;
+    std::size_t GetFreeCount() const { return freeCells.size(); }
+
+    // Cells by index, row by row
+    int GetColumns() const { return columns; }
+    int GetRows() const { return rows; }
+    bool IsFreeCell(int x, int y) const { return !blocked[static_cast<std::size_t>(y * columns + x)]; }
+
+    // Cell of a point, outside points go to the closest edge cell
+    int CellAt(sf::Vector2f point) const;
+    sf::Vector2f CellCentre(int cell) const
+    {
+        return {(static_cast<float>(cell % columns) + 0.5f) * cellSize, (static_cast<float>(cell / columns) + 0.5f) * cellSize};
+    }
+
+    // A point inside a random free cell, nothing when the world is full. Only uses the raw
+    // output of the generator, which is fixed by the standard even for std::mt19937
+    template <typename Generator>
+    std::optional<sf::Vector2f> SampleFree(Generator& generator) const;
+
+private:
+    float cellSize;
+    int columns;
+    int rows;
+
+    std::vector<bool> blocked;
+    std::vector<uint32_t> freeCells;
+};
+
+template <typename Generator>
+std::optional<sf::Vector2f> OccupancyGrid::SampleFree(Generator& generator) const
+{
+    if (freeCells.empty())
+        return std::nullopt;
+
+    const uint32_t cell = freeCells[static_cast<uint32_t>(generator()) % freeCells.size()];
+
+    // Anywhere in the middle half of the cell, not always the exact centre
+    const float jitterX = (static_cast<float>(static_cast<uint32_t>(generator()) >> 8) * (1.f / 16777216.f) - 0.5f) * cellSize * 0.5f;
+    const float jitterY = (static_cast<float>(static_cast<uint32_t>(generator()) >> 8) * (1.f / 16777216.f) - 0.5f) * cellSize * 0.5f;
+
+    return CellCentre(static_cast<int>(cell)) + sf::Vector2f{jitterX, jitterY};
+}
@@ -0,0 +1,147 @@
+#include "flow_field.h"
+#include <cmath>
+
+namespace
+{
+    // Orthogonal neighbours first, so on a tie a bot takes the straight step
+    constexpr int NEIGHBOUR_X[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    constexpr int NEIGHBOUR_Y[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+    bool Inside(const OccupancyGrid& grid, int x, int y)
+    {
+        return x >= 0 && y >= 0 && x < grid.GetColumns() && y < grid.GetRows();
+    }
+
+    // Diagonal steps need both sides free, or a tank would clip the corner of a rock
+    bool CanStep(const OccupancyGrid& grid, int x, int y, int dx, int dy)
+    {
+        if (!Inside(grid, x + dx, y + dy) || !grid.IsFreeCell(x + dx, y + dy))
+            return false;
+        if (dx != 0 && dy != 0)
+            return grid.IsFreeCell(x + dx, y) && grid.IsFreeCell(x, y + dy);
+        return true;
+    }
+}
+
+void FlowField::Build(const OccupancyGrid& grid, sf::Vector2f targetPosition)
+{
+    target = targetPosition;
+    targetCell = grid.CellAt(targetPosition);
+
+    distance.assign(static_cast<std::size_t>(grid.GetColumns()) * grid.GetRows(), UNREACHED);
+    frontier.clear();
+
+    // The target cell is the start even when blocked, a player can stand right next to a rock
+    distance[targetCell] = 0;
+    frontier.push_back(targetCell);
+
+    for (std::size_t next = 0; next < frontier.size(); next++)
+    {
+        const int cell = frontier[next];
+        const int x = cell % grid.GetColumns();
+        const int y = cell / grid.GetColumns();
+
+        for (int i = 0; i < 8; i++)
+        {
+            if (!CanStep(grid, x, y, NEIGHBOUR_X[i], NEIGHBOUR_Y[i]))
+                continue;
+
+            const int neighbour = (y + NEIGHBOUR_Y[i]) * grid.GetColumns() + x + NEIGHBOUR_X[i];
+            if (distance[neighbour] != UNREACHED)
+                continue;
+
+            distance[neighbour] = distance[cell] + 1;
+            frontier.push_back(neighbour);
+        }
+    }
+}
+
+std::optional<sf::Vector2f> FlowField::GetDirection(const OccupancyGrid& grid, sf::Vector2f position) const
+{
+    if (targetCell < 0)
+        return std::nullopt;
+
+    const int cell = grid.CellAt(position);
+
+    sf::Vector2f towards;
+    if (cell == targetCell)
+    {
+        towards = target - position;
+    }
+    else
+    {
+        // Downhill to the closest neighbour. A bot pushed into a blocked cell still finds the
+        // free ones around it, only its own cell has no distance
+        const int x = cell % grid.GetColumns();
+        const int y = cell / grid.GetColumns();
+
+        uint32_t best = DistanceAt(grid, x, y);
+        int bestCell = -1;
+        for (int i = 0; i < 8; i++)
+        {
+            if (!CanStep(grid, x, y, NEIGHBOUR_X[i], NEIGHBOUR_Y[i]))
+                continue;
+
+            const uint32_t neighbourDistance = DistanceAt(grid, x + NEIGHBOUR_X[i], y + NEIGHBOUR_Y[i]);
+            if (neighbourDistance < best)
+            {
+                best = neighbourDistance;
+                bestCell = (y + NEIGHBOUR_Y[i]) * grid.GetColumns() + x + NEIGHBOUR_X[i];
+            }
+        }
+
+        if (bestCell < 0)
+            return std::nullopt;
+
+        towards = grid.CellCentre(bestCell) - position;
+    }
+
+    const float length = std::sqrt(towards.x * towards.x + towards.y * towards.y);
+    if (length < 0.001f)
+        return sf::Vector2f{0.f, 0.f};
+
+    return towards / length;
+}
+
+uint32_t FlowField::DistanceAt(const OccupancyGrid& grid, int x, int y) const
+{
+    if (!Inside(grid, x, y))
+        return UNREACHED;
+
+    return distance[static_cast<std::size_t>(y * grid.GetColumns() + x)];
+}
+
+const FlowField& FlowFieldCache::Get(const OccupancyGrid& grid, int targetId, sf::Vector2f target, uint32_t tick)
+{
+    auto [it, added] = fields.try_emplace(targetId);
+    Entry& entry = it->second;
+    entry.usedTick = tick;
+
+    const bool stale = entry.field.GetTargetCell() != grid.CellAt(target) && tick - entry.builtTick >= rebuildTicks;
+    if (added || stale)
+    {
+        entry.field.Build(grid, target);
+        entry.builtTick = tick;
+        builds++;
+    }
+
+    return entry.field;
+}
+
+void FlowFieldCache::Prune(uint32_t oldestTick)
+{
+    for (auto it = fields.begin(); it != fields.end();)
+    {
+        if (it->second.usedTick < oldestTick)
+            it = fields.erase(it);
+        else
+            ++it;
+    }
+}
+
+uint64_t FlowFieldCache::TakeBuildCount()
+{
+    const uint64_t count = builds;
+    builds = 0;
+    return count;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "../game/world_gen.h"
+
+// Steps to one target from every free cell of a grid, found with a single breadth first
+// search. Every bot chasing that target just goes downhill from its own cell, so a field
+// costs the same for one bot or hundreds
+class FlowField
+{
+public:
+    void Build(const OccupancyGrid& grid, sf::Vector2f target);
+
+    // Unit vector to drive along, towards the next cell closer to the target or straight at
+    // the target once in its cell. Nothing when the target can't be reached from position
+    std::optional<sf::Vector2f> GetDirection(const OccupancyGrid& grid, sf::Vector2f position) const;
+
+    int GetTargetCell() const { return targetCell; }
+
+private:
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+
+    sf::Vector2f target;
+    int targetCell = -1;
+
+    std::vector<uint32_t> distance;   // in cells, by cell index
+    std::vector<int> frontier;        // kept so a rebuild does not allocate
+
+    uint32_t DistanceAt(const OccupancyGrid& grid, int x, int y) const;
+};
+
+// Fields by target id, shared by every bot chasing that target. A field is only rebuilt once
+// its target changed cell, and at most once every rebuildTicks
+class FlowFieldCache
+{
+public:
+    explicit FlowFieldCache(uint32_t rebuildTicks) : rebuildTicks(rebuildTicks) {}
+
+    const FlowField& Get(const OccupancyGrid& grid, int targetId, sf::Vector2f target, uint32_t tick);
+
+    // Drops the fields nobody asked for since oldestTick
+    void Prune(uint32_t oldestTick);
+
+    std::size_t GetCount() const { return fields.size(); }
+
+    // Searches run since the last call, for the metrics
+    uint64_t TakeBuildCount();
+
+private:
+    struct Entry
+    {
+        FlowField field;
+        uint32_t builtTick = 0;
+        uint32_t usedTick = 0;
+    };
+
+    uint32_t rebuildTicks;
+    std::unordered_map<int, Entry> fields;
+    uint64_t builds = 0;
+};
@@ -5,39 +5,137 @@
 #include "game_server.h"
 #include "../game/utils.h"
 #include "../game/protocole_message.h"
+#include "../config.h"
+#include "../game/profiler.h"
+#include <algorithm>
+#include <cmath>
 #include <thread>
 
+// Real sockets, behind the network emulator when config asks for a bad network
+static std::unique_ptr<ServerTransport> CreateTransport(unsigned short port) {
+    std::unique_ptr<ServerTransport> transport = std::make_unique<SocketTransport>(port);
+
+    const NetworkConditions conditions = Config::getNetworkConditions();
+    if (!conditions.IsEnabled()) {
+        return transport;
+    }
+
+    Utils::printMsg("Emulating network: " + std::to_string(conditions.delay * 1000.f) + " ms delay, " +
+                    std::to_string(conditions.jitter * 1000.f) + " ms jitter, " +
+                    std::to_string(conditions.loss * 100.f) + "% loss", warning);
+    return std::make_unique<EmulatedTransport>(std::move(transport), conditions);
+}
+
 game_server::game_server(unsigned short port)
-    : collisionManager(1280.f, 960.f)
+    : game_server(CreateTransport(port), static_cast<uint16_t>(std::random_device{}()))
 {
-    if (socketUDP.bind(port) != sf::Socket::Status::Done) {
-        Utils::printMsg("Failed to bind server to port " + std::to_string(port), error);
-        throw std::runtime_error("Server bind failed");
-    }
+    Utils::printMsg("Port: " + std::to_string(port), info);
+}
 
-    socketUDP.setBlocking(false);
-    if (listenerTCP.listen(port) != sf::Socket::Status::Done)
-    {
-        Utils::printMsg("Failed to listen tcp on port " + std::to_string(port), error);
-    } else
-    {
-        Utils::printMsg("Server listening on port " + std::to_string(port), debug);
-    }
+// A map sets the size of the world, the config only matters for generated ones
+static ChunkLayout WorldLayout(const MapFile* map, int maxChunks)
+{
+    if (map)
+        return map->GetLayout();
+
+    return ChunkLayout(std::clamp(Config::getWorldChunksX(), 1, maxChunks),
+                       std::clamp(Config::getWorldChunksY(), 1, maxChunks));
+}
+
+static std::unique_ptr<MapFile> LoadConfiguredMap()
+{
+    const std::string path = Config::getMapFile();
+    if (path.empty())
+        return nullptr;
+
+    std::unique_ptr<MapFile> map = MapFile::Open(path);
+    if (!map)
+        Utils::printMsg("Generating a world instead of " + path, warning);
+    return map;
+}
+
+game_server::game_server(std::unique_ptr<ServerTransport> transport, uint16_t seed)
+    : transport(std::move(transport)),
+      map(LoadConfiguredMap()),
+      collisionManager(WorldLayout(map.get(), MAX_WORLD_CHUNKS)),
+      jobs(JobSystem::WorkersFor(Config::getJobThreads())),
+      SEED(seed),
+      rng(seed),
+      deterministic(Config::getDeterministicSim()),
+      spawnGrid(collisionManager.GetWorldSize().x, collisionManager.GetWorldSize().y, SPAWN_CELL_SIZE),
+      navGrid(collisionManager.GetWorldSize().x, collisionManager.GetWorldSize().y, NAV_CELL_SIZE),
+      flowFields(SecondsToTicks(1.0f)),
+      maxPayload(std::clamp(Config::getMaxPayload(), MIN_PAYLOAD_SIZE, MAX_MESSAGE_SIZE)),
+      maxPlayers(std::clamp<std::size_t>(Config::getMaxPlayers(), 1, MAX_SNAPSHOT_PLAYERS))
+{
+    // Biggest snapshot the schema allows, so building it never has to grow
+    snapShot.players.reserve(MAX_SNAPSHOT_PLAYERS);
+    snapShot.bullets.reserve(MAX_SNAPSHOT_BULLETS);
+
+    // A tank waits for one respawn at most and every tank fits in a snapshot, so the first death
+    // of a match does not allocate in the middle of a tick
+    pendingRespawns.reserve(MAX_SNAPSHOT_PLAYERS);
+
+    // Stores at their largest from the start, their free lists too, so a bullet hitting a rock or
+    // a player leaving only recycles a slot
+    clientsUDP.Reserve(maxPlayers);
+    tanks.Reserve(MAX_SNAPSHOT_PLAYERS);
+    bullets.Reserve(MAX_SNAPSHOT_BULLETS);
+
+    const ChunkLayout& chunks = collisionManager.GetLayout();
+    chunkActive.assign(static_cast<std::size_t>(chunks.GetCount()), 0);
+    activeChunks.reserve(static_cast<std::size_t>(chunks.GetCount()));
+
+    if (map) {
+        // Colliders straight from the mapped file, the clients read the same ones
+        for (int chunk = 0; chunk < chunks.GetCount(); chunk++) {
+            for (const MapRect& rect : map->GetChunkColliders(chunk)) {
+                const sf::FloatRect bounds = {{rect.x, rect.y}, {rect.width, rect.height}};
+                collisionManager.AddStaticCollider(bounds);
+                spawnGrid.Block(bounds, ROCK_SPACE);
+            }
+        }
+    } else {
+        // Same rocks the clients build from the seed, so bullets stop at them here too. The server
+        // keeps every chunk, colliders are looked up by chunk so the world size does not matter
+        BuildObstacles(GenerateWorld(SEED, chunks).rocks, obstacles, collisionManager);
 
-    listenerTCP.setBlocking(false);
-    selectorTCP.add(listenerTCP);
+        for (const auto& obs : obstacles)
+            spawnGrid.Block(obs->GetBounds(), ROCK_SPACE);
+    }
+    spawnGrid.BlockBorder(ROCK_SPACE);
+    spawnGrid.Bake();
 
-    std::random_device rd;
-    SEED= rd();
+    collisionManager.ForEachStaticCollider([this](const sf::FloatRect& bounds) {
+        navGrid.Block(bounds, BOT_CLEARANCE);
+    });
 
     CreatePickUps();
 
+    // Pickups are never destroyed, so a column index is also the pickup's index in the grid
+    pickupIndex.Reset(collisionManager.GetWorldSize(), pickups.GetCount());
+    for (std::size_t id = 0; id < pickups.GetCount(); id++) {
+        pickupIndex.Move(static_cast<int>(id), pickups.position[id]);
+    }
+
+    // Every tank has to fit in a snapshot, bots only get the places players can't take
+    CreateServerBots(std::min(Config::getServerBots(), MAX_SNAPSHOT_PLAYERS - maxPlayers));
+
     Utils::printMsg("------- Server LISTENING ------- ", success);
-    Utils::printMsg("Port: " + std::to_string(port), info);
     Utils::printMsg("Tick Rate: " + std::to_string(TICK_RATE) + " Hz", info);
-    Utils::printMsg("Health Kits created: " + std::to_string(healthKits.size()), success);
-    Utils::printMsg("Ammo Boxes created: " + std::to_string(ammoBoxes.size()), success);
-    Utils::printMsg("Seed for obstacles: " + std::to_string(SEED), success);
+    Utils::printMsg("Max players: " + std::to_string(maxPlayers), info);
+    Utils::printMsg("Job threads: " + std::to_string(jobs.GetWorkerCount()), info);
+    Utils::printMsg("World: " + std::to_string(chunks.GetColumns()) + " x " + std::to_string(chunks.GetRows()) +
+                    " chunks, " + std::to_string(obstacles.size()) + " rocks", info);
+    const auto healthKits = std::count(pickups.kind.begin(), pickups.kind.end(), EntityKind::HealthKit);
+    Utils::printMsg("Health Kits created: " + std::to_string(healthKits), success);
+    Utils::printMsg("Ammo Boxes created: " + std::to_string(pickups.GetCount() - healthKits), success);
+    if (!bots.empty())
+        Utils::printMsg("Server bots: " + std::to_string(bots.size()), success);
+    if (map)
+        Utils::printMsg("Map: " + map->GetName() + ", " + std::to_string(map->GetSpawns().size()) + " spawn points", success);
+    else
+        Utils::printMsg("Seed for obstacles: " + std::to_string(SEED), success);
 }
 
 void game_server::Update() {
@@ -50,145 +148,257 @@ void game_server::Update() {
     Utils::printMsg("Waiting for players to join...", success);
 
     while (true) {
+        PROFILE_ZONE("game_server::Update");
+
         float dt = clock.restart().asSeconds();
         time += dt;
 
         // Fixed timestep updates
         while (time >= tickTime) {
-            ProcessMessages();
-            CheckClientTimeouts();
-            CheckPendingRespawns();
+            Tick();
             time -= tickTime;
         }
 
-        SendGameSnapShot();
+        SendUpdates();
 
         // time to wait before next snapshot to avoid CPU hogging
         sf::sleep(sf::milliseconds(SLEEP_TIME));
     }
 }
 
+void game_server::Tick() {
+    // Steady state ticks should not allocate, see alloc_tracker.h (TANK_ALLOC_TRACKING builds only)
+    ALLOC_FRAME("ServerTick");
+
+    // A trace is dumped when a tick takes longer than its slot
+    PROFILE_BUDGET("ServerTick", 1.0f / TICK_RATE);
+
+    sf::Clock tickClock;
+
+    ProcessMessages();
+    CheckClientTimeouts();
+    CheckPendingRespawns();
+    UpdateActiveChunks();
+    UpdateServerBots();
+    CollectPickUps();
+    UpdateBullets();
+
+    if (deterministic) {
+        HashState();
+    }
+
+    // Nothing from the tick arena outlives the tick
+    ResetTickArena();
+
+    const float tickDuration = tickClock.getElapsedTime().asSeconds();
+    metrics.tickDuration.Observe(tickDuration);
+    metrics.ticks.Add();
+    if (tickDuration > 1.0f / TICK_RATE) {
+        metrics.tickOverruns.Add();
+    }
+    metrics.connectedPlayers.Set(static_cast<int64_t>(clientsUDP.size()));
+    metrics.bulletsAlive.Set(static_cast<int64_t>(bullets.GetCount()));
+    metrics.activeChunks.Set(static_cast<int64_t>(activeChunks.size()));
+    metrics.flowFields.Set(static_cast<int64_t>(flowFields.GetCount()));
+
+    const float now = Now();
+    for (ConnectedClient& client : clientsUDP) {
+        client.stats.Update(now);
+    }
+
+    if (tick % SecondsToTicks(STATS_LOG_INTERVAL) == 0) {
+        LogClientStats();
+
+        if (deterministic) {
+            // Low half, what the clients show in their performance overlay
+            PRINT_MSGF(debug, "Tick %u state hash %u", static_cast<unsigned>(tick), static_cast<unsigned>(static_cast<uint32_t>(stateHash)));
+        }
+    }
+
+    tick++;
+}
+
+void game_server::SendUpdates() {
+    ALLOC_FRAME("SendUpdates");
+    PROFILE_ZONE("SendUpdates");
+
+    SendGameSnapShot();
+
+    // The snapshot's parts and encoded bytes are sent, its scratch goes before the next tick
+    ResetTickArena();
+
+    FlushReliable();
+    FlushBatches();
+}
+
+void game_server::ResetTickArena() {
+    const std::size_t arenaCapacity = tickArena.GetCapacity();
+    tickArena.Reset();
+    metrics.tickArenaHighWater.Set(static_cast<int64_t>(tickArena.GetHighWater()));
+
+    if (tickArena.GetCapacity() != arenaCapacity) {
+        PRINT_MSGF(warning, "Tick arena grown to %zu bytes", tickArena.GetCapacity());
+    }
+}
+
+void game_server::StartMetrics(unsigned short port, const std::string& filePath, float fileInterval) {
+    if (port == 0 && filePath.empty()) {
+        return;
+    }
+
+    metricsExporter = std::make_unique<MetricsExporter>(metrics, port, filePath, fileInterval);
+}
+
+void game_server::StartCapture(const std::string& path) {
+    recorder = std::make_unique<PacketRecorder>(path, SEED);
+    if (!recorder->IsOpen()) {
+        recorder.reset();
+    }
+}
+
 void game_server::ProcessMessages()
 {
+    PROFILE_ZONE("ProcessMessages");
+
     // Handle TCP messages
-    if (selectorTCP.wait(sf::milliseconds(10)))
+    int connection;
+    sf::Packet packet;
+    while (transport->ReceiveTCP(connection, packet))
     {
-        if (selectorTCP.isReady(listenerTCP))
-        {
-            auto client = std::make_unique<sf::TcpSocket>();
-            if (listenerTCP.accept(*client) == sf::Socket::Status::Done)
-            {
-                client->setBlocking(false);
-                selectorTCP.add(*client);
-                clientsTCP.push_back(std::move(client));
-                Utils::printMsg("New TCP client connected", success);
-            }
-        }
-        else
-        {
-            for (const auto& client : clientsTCP)
-            {
-                if (selectorTCP.isReady(*client))
-                {
-                    sf::Packet packet;
-                    sf::Socket::Status status = client->receive(packet);
-
-                    if (status == sf::Socket::Status::Done)
-                    {
-                        uint8_t typeValue;
-                        if (!(packet >> typeValue)) continue;
-
-                        MessageTypeProtocole type = static_cast<MessageTypeProtocole>(typeValue);
-                        ProcessMessagesTCP(*client, type, packet);
-                    }
-                }
-            }
-        }
+        if (recorder)
+            recorder->RecordTCP(tick, connection, transport->GetRemoteAddress(connection), packet);
+
+        uint8_t typeValue;
+        if (!(packet >> typeValue)) continue;
+
+        metrics.CountInbound(typeValue);
+
+        MessageTypeProtocole type = static_cast<MessageTypeProtocole>(typeValue);
+        ProcessMessagesTCP(connection, type, packet);
     }
 
-    // Handle UDP messages
-    sf::Packet packet;
+    // Handle UDP messages, read in place from the per thread receive buffer
+    MessageBuffer& buffer = GetReceiveBuffer();
+    std::size_t received = 0;
     std::optional<sf::IpAddress> senderIP;
     unsigned short senderPort;
 
-    while (socketUDP.receive(packet, senderIP, senderPort) == sf::Socket::Status::Done) {
+    while (transport->ReceiveUDP(buffer.data(), buffer.size(), received, senderIP, senderPort)) {
 
-        uint8_t typeValue;
-        if (!(packet >> typeValue)) continue;
+        if (recorder)
+            recorder->RecordUDP(tick, senderIP, senderPort, buffer.data(), received);
 
-        MessageTypeProtocole type = static_cast<MessageTypeProtocole>(typeValue);
+        metrics.bytesIn.Add(received);
+        if (ConnectedClient* client = senderIP ? FindClient(*senderIP, senderPort) : nullptr)
+            client->stats.OnReceived(received);
 
-        switch (type) {
+        // A datagram can hold several messages when the client bundled them
+        UnpackDatagram(buffer.data(), received, [&](MessageReader& packet) {
+            ProcessMessageUDP(packet, senderIP, senderPort);
+        });
+    }
 
-        case MessageTypeProtocole::TANK_UPDATE: {
-                TankMessage msg;
-                if (packet >> msg) {
+    // Reliable messages, in the order each client sent them
+    for (ConnectedClient& client : clientsUDP) {
+        client.channel.Deliver([&](MessageReader& message) {
+            ProcessReliableMessage(message);
+        });
+    }
+}
 
-                    auto tank = clientsUDP.find(msg.playerId);
-                    if (tank != clientsUDP.end()) {
+void game_server::ProcessMessageUDP(MessageReader& packet, const std::optional<sf::IpAddress>& senderIP, unsigned short senderPort)
+{
+    uint8_t typeValue;
+    if (!(packet >> typeValue)) return;
 
-                        // This logic handles if the client has poor network and the server stops receving info about it
-                        // it will wait the timeout duration before kicking it out, we restart the heartbeat when we receive new packets
-                        tank->second.lastHeartbeat.restart();
-                    }
+    metrics.CountInbound(typeValue);
 
-                    HandleTankUpdate(msg);
-                }
-                break;
-            }
+    MessageTypeProtocole type = static_cast<MessageTypeProtocole>(typeValue);
 
-            case MessageTypeProtocole::DISCONNECT: {
-                int playerId;
-                if (packet >> playerId) {
-                    HandleDisconnect(playerId);
-                }
-                break;
-            }
+    switch (type) {
 
-        case MessageTypeProtocole::PickUP_HIT:{
+    case MessageTypeProtocole::TANK_UPDATE: {
+            AckHeader header;
+            PingHeader ping;
+            TankMessage msg;
+            if (packet >> header >> ping >> msg) {
 
-                PickUpHitMessage msg;
+                if (ConnectedClient* client = clientsUDP.Find(msg.playerId)) {
 
-                if (packet >> msg)
-                {
-                    HandlePickUpsUpdate(msg);
+                    // This logic handles if the client has poor network and the server stops receving info about it
+                    // it will wait the timeout duration before kicking it out, we restart the heartbeat when we receive new packets
+                    client->lastHeartbeatTick = tick;
+                    client->channel.OnAckHeader(header, Now());
+                    client->stats.OnPingHeader(ping, Now());
                 }
 
-                break;
+                HandleTankUpdate(msg);
+            }
+            break;
+        }
+
+        case MessageTypeProtocole::DISCONNECT: {
+            DisconnectMessage msg;
+            if (packet >> msg) {
+                HandleDisconnect(msg.playerId);
             }
+            break;
+        }
+
+        case MessageTypeProtocole::RELIABLE: {
+            uint16_t sequence;
+            ConnectedClient* client = senderIP ? FindClient(*senderIP, senderPort) : nullptr;
 
-            default:
-                Utils::printMsg("Unknown UDP message, enum value: " + std::to_string(typeValue), warning);
-                break;
+            if (client && packet >> sequence) {
+                client->channel.OnReceive(sequence, packet.GetRemainingData(), packet.GetRemainingSize());
+            }
+            break;
         }
+
+        default:
+            PRINT_MSGF(warning, "Unknown UDP message, enum value: %d", typeValue);
+            break;
     }
 }
 
-void game_server::ProcessMessagesTCP(sf::TcpSocket& socket,MessageTypeProtocole type, sf::Packet& packet)
+// Handlers here must not add or remove clients, they run while iterating clientsUDP
+void game_server::ProcessReliableMessage(MessageReader& packet)
+{
+    uint8_t typeValue;
+    if (!(packet >> typeValue)) return;
+
+    metrics.CountInbound(typeValue);
+
+    // Clients send nothing reliable at the moment, pickups are decided here since PICKUP_HIT went
+    PRINT_MSGF(warning, "Unexpected reliable message, enum value: %d", typeValue);
+}
+
+void game_server::ProcessMessagesTCP(int connection, MessageTypeProtocole type, sf::Packet& packet)
 {
     if (type ==  MessageTypeProtocole::JOIN_REQUEST)
     {
         JoinRequestMessage message;
         if (packet >> message)
         {
-            HandleJoinRequestTCP(socket, message);
+            HandleJoinRequestTCP(connection, message);
         }
     }
 }
 
-void game_server::HandleJoinRequestTCP(sf::TcpSocket& socket, JoinRequestMessage msg)
+void game_server::HandleJoinRequestTCP(int connection, JoinRequestMessage msg)
 {
-    if (clientsUDP.size() >= availableColors.size())
+    if (clientsUDP.size() >= maxPlayers)
     {
         // Server full
         JoinRejectedMessage rejectMsg;
 
-        rejectMsg.message = "Server is full (4/4 players), try later mate...";
+        rejectMsg.message = "Server is full (" + std::to_string(maxPlayers) + "/" + std::to_string(maxPlayers) +
+                            " players), try later mate...";
 
         sf::Packet rejectPacket;
-        rejectPacket << static_cast<uint8_t>(MessageTypeProtocole::JOIN_REJECTED) << rejectMsg;
+        WriteMessage(rejectPacket, rejectMsg);
 
-        if (socket.send(rejectPacket) != sf::Socket::Status::Done)
+        if (!transport->SendTCP(connection, rejectPacket))
         {
             Utils::printMsg("Failed to send reject request", error);
         }
@@ -196,344 +406,562 @@ void game_server::HandleJoinRequestTCP(sf::TcpSocket& socket, JoinRequestMessage
         return;
     }
 
-    int playerId = nextPlayerId++;
+    std::optional<sf::IpAddress> address = transport->GetRemoteAddress(connection);
+    if (!address) {
+        Utils::printMsg("Join request from a closed connection, ignored", warning);
+        return;
+    }
 
-    std::string color = AssignColor();
+    int playerId = nextPlayerId++;
 
+    const RenderHandle color = AssignColor();
 
     // Create client info
-    clientsUDP.try_emplace(
+    ConnectedClient& client = clientsUDP.Emplace(
         playerId,
-        socket.getRemoteAddress().value(),
+        *address,
         msg.udpPort,
         playerId,
-        msg.playerName
+        msg.playerName,
+        maxPayload
     );
-
-    clientsUDP.at(playerId).lastHeartbeat.restart();
+    client.lastHeartbeatTick = tick;
 
     Utils::printMsg("Client UDP port:" + std::to_string(msg.udpPort), debug);
-    tanks[playerId] = std::make_unique<Tank>(color);
-    tanks[playerId]->position = {640, 480};
+    client.tank = tanks.Create(EntityKind::Tank, playerId, SpawnPointFor(map.get(), collisionManager.GetLayout(), playerId));
+
+    const std::size_t index = tanks.IndexOf(client.tank);
+    tanks.health[index] = Tank::MAX_HEALTH;
+    tanks.ammo[index] = Tank::MAX_AMMO;
+    tanks.render[index] = color;
+    if (deterministic) {
+        SnapToFixed(tanks, index);
+    }
 
     // Send acceptance to joining client
     JoinAcceptedMessage acceptMsg;
     acceptMsg.assignedPlayerId = playerId;
-    acceptMsg.tankColor = color;
+    acceptMsg.tankColor = availableColors[color];
 
     sf::Packet acceptPacket;
-    acceptPacket << static_cast<uint8_t>(MessageTypeProtocole::JOIN_ACCEPTED) << acceptMsg;
+    WriteMessage(acceptPacket, acceptMsg);
 
-    if (socket.send(acceptPacket) != sf::Socket::Status::Done)
+    if (!transport->SendTCP(connection, acceptPacket))
     {
         Utils::printMsg("Failed to send join acceptance", error);
     }
 
-    SendObstacleSeedTCP(socket);
-    SendPickUpsPositionTCP(socket);
+    SendObstacleSeedTCP(connection);
+    SendPickUpsPositionTCP(connection);
 
     // Notify all other clients about new player
     PlayerJoinedMessage joinMsg;
     joinMsg.playerId = playerId;
-    joinMsg.color = color;
+    joinMsg.color = availableColors[color];
 
-    sf::Packet joinPacket;
-    joinPacket << static_cast<uint8_t>(MessageTypeProtocole::PLAYER_JOINED) << joinMsg;
-    BroadcastMessageTCP(joinPacket);
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, joinMsg);
+    BroadcastReliable(writer);
 }
 
 void game_server::HandleTankUpdate(TankMessage msg) {
 
-    auto tankIt = tanks.find(msg.playerId);
-    if (tankIt == tanks.end()) return;
-
-    Tank* tank = tankIt->second.get();
+    // Check if player just died and isn't already pending respawn
+    ConnectedClient* client = clientsUDP.Find(msg.playerId);
+    if (client && tanks.Contains(client->tank)) {
+        // The position indexes chunks and the pickup grid, a NaN or a huge value from a client
+        // must never get that far
+        if (!std::isfinite(msg.x) || !std::isfinite(msg.y) ||
+            !std::isfinite(msg.rotationBody) || !std::isfinite(msg.rotationBarrel)) {
+            PRINT_MSGF(warning, "Tank update with a broken pose from player %d, ignored", msg.playerId);
+            return;
+        }
 
-    tank->position = {msg.x, msg.y};
-    tank->bodyRotation = sf::degrees(msg.rotationBody);
-    tank->barrelRotation = sf::degrees(msg.rotationBarrel);
+        const sf::Vector2f worldSize = collisionManager.GetWorldSize();
+        const std::size_t tank = tanks.IndexOf(client->tank);
+        tanks.position[tank] = {std::clamp(msg.x, 0.f, worldSize.x), std::clamp(msg.y, 0.f, worldSize.y)};
+        tanks.bodyRotation[tank] = std::remainder(msg.rotationBody, 360.f);
+        tanks.barrelRotation[tank] = std::remainder(msg.rotationBarrel, 360.f);
+        if (deterministic) {
+            SnapToFixed(tanks, tank);
+        }
 
-    // Check if player just died and isn't already pending respawn
-    auto clientIt = clientsUDP.find(msg.playerId);
-    if (clientIt != clientsUDP.end()) {
-        if (!msg.isAlive && !clientIt->second.isPendingRespawn) {
-            Utils::printMsg("Player " + std::to_string(msg.playerId) + " died", error);
+        if (!msg.isAlive && !client->isPendingRespawn) {
+            PRINT_MSGF(error, "Player %d died", msg.playerId);
 
-            clientIt->second.isPendingRespawn = true;
+            client->isPendingRespawn = true;
 
             // Broadcast death
             PlayerDiedMessage diedMsg;
             diedMsg.victimId = msg.playerId;
 
-            sf::Packet deathPacket;
-            deathPacket << static_cast<uint8_t>(MessageTypeProtocole::PLAYER_DIED) << diedMsg;
-            BroadcastMessageTCP(deathPacket);
+            MessageWriter writer(GetSendBuffer());
+            WriteMessage(writer, diedMsg);
+            BroadcastReliable(writer);
 
             // Add to respawn queue, 2 second timer
-            pendingRespawns.emplace_back(msg.playerId, -1);
+            pendingRespawns.emplace_back(msg.playerId, -1, tick);
         }
 
         // Perform shooting just once per press
-        bool prevState = clientIt->second.prevShootState;
-        if (msg.shootPressed && !prevState && tank->getAmmo() > 0) {
-            SpawnBullet(msg.playerId);
+        bool prevState = client->prevShootState;
+        if (msg.shootPressed && !prevState && tanks.ammo[tank] > 0) {
+            SpawnBullet(msg.playerId, client->tank);
         }
-        clientIt->second.prevShootState = msg.shootPressed;
+        client->prevShootState = msg.shootPressed;
     }
 }
 
 void game_server::HandleDisconnect(int playerId) {
-    auto client = clientsUDP.find(playerId);
-    if (client == clientsUDP.end()) return;
+    ConnectedClient* client = clientsUDP.Find(playerId);
+    if (!client) return;
 
-    auto tank = tanks.find(playerId);
-    if (tank != tanks.end()) {
-        FreeColor(tank->second->GetColor());
-        tanks.erase(tank);
+    if (tanks.Contains(client->tank)) {
+        FreeColor(tanks.render[tanks.IndexOf(client->tank)]);
+        tanks.Destroy(client->tank);
     }
 
-    clientsUDP.erase(client);
+    clientsUDP.Remove(playerId);
 
     // Notify all clientsUDP
     PlayerLeftMessage leftMsg;
     leftMsg.playerId = playerId;
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::PLAYER_LEFT) << leftMsg;
-    BroadcastMessageTCP(packet);
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, leftMsg);
+    BroadcastReliable(writer);
 
-    Utils::printMsg("Player " + std::to_string(playerId) + " disconnected", warning);
+    PRINT_MSGF(warning, "Player %d disconnected", playerId);
 }
 
-void game_server::SpawnBullet(int ownerId) {
-    auto tankIt = tanks.find(ownerId);
-    if (tankIt == tanks.end()) return;
-
-    Tank* tank = tankIt->second.get();
-    if (tank->getAmmo() <= 0) return;
-
-    // Calculate bullet spawn position
-    const float tipRotation = (tank->barrelRotation + sf::degrees(90)).asRadians();
-    sf::Vector2f barrelTip = tank->position + sf::Vector2f{
-        std::cos(tipRotation) * 30.f,  // barrel length
-        std::sin(tipRotation) * 30.f
-    };
-
+void game_server::SpawnBullet(int ownerId, EntityId tankId) {
+    if (!tanks.Contains(tankId)) return;
+
+    const std::size_t tank = tanks.IndexOf(tankId);
+    if (tanks.ammo[tank] <= 0) return;
+
+    // Calculate bullet spawn position, the barrel tip is rotation + 90
+    const float barrelRotation = tanks.barrelRotation[tank];
+    const float tipRotation = (barrelRotation + 90.f) * 3.14159265f / 180.f;
+    const sf::Vector2f direction = {std::cos(tipRotation), std::sin(tipRotation)};
+    sf::Vector2f barrelTip = tanks.position[tank] + direction * 30.f;  // barrel length
+
+    // The columns keep their capacity, only a new high of bullets in flight allocates
+    const int bulletId = nextBulletId++;
+    const std::size_t bullet = bullets.IndexOf(bullets.Create(EntityKind::Bullet, bulletId, barrelTip));
+    bullets.owner[bullet] = ownerId;
+    bullets.bodyRotation[bullet] = barrelRotation;
+    bullets.velocity[bullet] = direction * BULLET_SPEED;
+
+    if (deterministic) {
+        // The same from the fixed columns, the message then carries the quantised spawn
+        const FixedVec fixedDirection = FixedDirection(static_cast<FixedAngle>(tanks.fixedBarrel[tank] + ANGLE_QUARTER));
+        bullets.fixedPosition[bullet] = tanks.fixedPosition[tank] + fixedDirection * (30 * FIXED_ONE);
+        bullets.fixedVelocity[bullet] = fixedDirection * ToFixed(BULLET_SPEED / TICK_RATE);
+        bullets.fixedBody[bullet] = tanks.fixedBarrel[tank];
+        SyncFromFixed(bullets, bullet);
+    }
 
-    Bullet bullet;
-    bullet.bulletId = nextBulletId++;
-    bullet.ownerId = ownerId;
-    bullet.bulletPrefab = std::make_unique<class bullet>(barrelTip, tank->barrelRotation);
-    int bulletId = bullet.bulletId;
-    bullets.push_back(std::move(bullet));
+    // Clients take one off on BULLET_SPAWNED too, so the ammo pickups top up agrees
+    tanks.ammo[tank]--;
 
 
     // Broadcast bullet spawn
     BulletSpawnedMessage msg;
     msg.bulletId = bulletId;
-    msg.x = barrelTip.x;
-    msg.y = barrelTip.y;
-    msg.rotation = tank->barrelRotation.asDegrees();
+    msg.x = bullets.position[bullet].x;
+    msg.y = bullets.position[bullet].y;
+    msg.rotation = bullets.bodyRotation[bullet];
     msg.ownerId = ownerId;
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::BULLET_SPAWNED) << msg;
-    BroadcastMessage(packet);
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, msg);
+    BroadcastMessage(writer);
 
-    Utils::printMsg("Player " + std::to_string(ownerId) + " fired bullet number " +
-                   std::to_string(bullet.bulletId), debug);
+    PRINT_MSGF(debug, "Player %d fired bullet number %d", ownerId, bulletId);
 }
 
-void game_server::SendGameSnapShot() {
-    GameSnapMessage state = BuildGameSnap();
+// Only chunks near a player are simulated. Clearing goes through the list of the last tick,
+// so the cost follows the players and not the size of the world
+void game_server::UpdateActiveChunks() {
+    for (int chunk : activeChunks) {
+        chunkActive[chunk] = 0;
+    }
+    activeChunks.clear();
+
+    const ChunkLayout& chunks = collisionManager.GetLayout();
+    for (const sf::Vector2f& position : tanks.position) {
+        chunks.ForEach(chunks.Overlapping({position, {0.f, 0.f}}, ACTIVE_CHUNK_RINGS), [this](int chunk) {
+            if (!chunkActive[chunk]) {
+                chunkActive[chunk] = 1;
+                activeChunks.push_back(chunk);
+            }
+        });
+    }
+}
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::GAME_STATE) << state;
+// Moves the bullets one tick, a bullet that hits a wall or a bot or leaves every player's
+// range is destroyed and its place taken by the last one
+void game_server::UpdateBullets() {
+    const ChunkLayout& chunks = collisionManager.GetLayout();
 
-    BroadcastMessage(packet);
+    // Moving and the checks against rocks only read the static colliders and write the bullet's
+    // own columns, so they run on the jobs. A flag per bullet is what comes back
+    ArenaVector<uint8_t> spent(bullets.GetCount(), 0, ArenaAllocator<uint8_t>(tickArena));
+
+    jobs.ParallelFor(bullets.GetCount(), ENTITY_GRAIN, [&](std::size_t begin, std::size_t end) {
+        if (deterministic)
+            IntegrateFixedVelocities(bullets, begin, end);
+        else
+            IntegrateVelocities(bullets, 1.0f / TICK_RATE, begin, end);
+
+        for (std::size_t i = begin; i < end; i++) {
+            sf::Vector2f pushback;
+            spent[i] = !chunkActive[chunks.IndexAt(bullets.position[i])] ||
+                       collisionManager.CheckCollision(BoundsOf(bullets, i, BULLET_SIZE), pushback);
+        }
+    });
+
+    // Bots taking hits and bullets changing places stay in column order, same as one thread
+    for (std::size_t i = 0; i < bullets.GetCount();) {
+        if (spent[i] || HitServerBots(i)) {
+            bullets.DestroyAt(i);
+            spent[i] = spent[bullets.GetCount()];  // the last bullet moved into i
+        } else {
+            i++;
+        }
+    }
 }
 
-GameSnapMessage game_server::BuildGameSnap() {
+void game_server::SendGameSnapShot() {
+    const GameSnapMessage& state = BuildGameSnap();
+
+    // Split by entity so every part fits in one datagram and can be used on its own
+    ArenaVector<SnapshotPart> parts{ArenaAllocator<SnapshotPart>(tickArena)};
+    parts.reserve(state.players.size() + state.bullets.size() + 1);
+    SplitSnapshot(state, maxPayload, [&](const SnapshotPart& part) { parts.push_back(part); });
+
+    SnapshotPartHeader header;
+    header.snapshotId = nextSnapshotId++;
+    header.partCount = static_cast<uint8_t>(parts.size());
+    header.stateHash = static_cast<uint32_t>(stateHash);
+
+    // Every part encoded once into its own maxPayload slice (SplitSnapshot keeps them that small),
+    // the same bytes go to every client and the ack header is left empty here. Size 0 is a part
+    // that did not fit
+    std::byte* encoded = static_cast<std::byte*>(tickArena.Allocate(parts.size() * maxPayload, alignof(std::max_align_t)));
+    ArenaVector<std::size_t> partSizes(parts.size(), 0, ArenaAllocator<std::size_t>(tickArena));
+
+    jobs.ParallelFor(parts.size(), SNAPSHOT_PART_GRAIN, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; p++) {
+            SnapshotPartHeader partHeader = header;
+            partHeader.part = static_cast<uint8_t>(p);
+
+            MessageWriter writer(encoded + p * maxPayload, maxPayload);
+            WriteSnapshotPart(writer, state, parts[p], partHeader);
+            partSizes[p] = writer ? writer.GetSize() : 0;
+        }
+    });
+
+    std::size_t snapshotBytes = 0;
+    for (std::size_t size : partSizes) {
+        if (size == 0) {
+            PRINT_MSG("Snapshot part too big to send, dropped", error);
+        }
+        snapshotBytes += size;
+    }
+
+    // Each client on one job, the parts copied into that thread's send buffer and patched
+    const float now = Now();
+    jobs.ParallelFor(clientsUDP.size(), CLIENT_GRAIN, [&](std::size_t begin, std::size_t end) {
+        MessageBuffer& buffer = GetSendBuffer();
+
+        for (std::size_t c = begin; c < end; c++) {
+            ConnectedClient& client = clientsUDP[c];
+
+            for (std::size_t p = 0; p < parts.size(); p++) {
+                if (partSizes[p] == 0) {
+                    continue;
+                }
+
+                MessageWriter writer(buffer);
+                writer.Append(encoded + p * maxPayload, partSizes[p]);
+
+                // Only the acks and ping differ between clients, patch them in place right after the type byte
+                MessageWriter perClient(buffer.data() + 1, ACK_HEADER_SIZE + PING_HEADER_SIZE);
+                perClient << client.channel.GetAckHeader() << client.stats.MakePingHeader(now);
+
+                StageBatched(client, writer);
+            }
+        }
+    });
 
-    GameSnapMessage snapShot;
+    // The transports are not thread safe, the datagrams go out here in client order. Every
+    // client gets the same snapshot, only the headers differ
+    for (ConnectedClient& client : clientsUDP) {
+        SendOutbox(client);
+        metrics.snapshotBytes.Observe(static_cast<double>(snapshotBytes));
+    }
+}
 
-    // Add all players
-    for (const auto& [id, tank] : tanks) {
-        GameSnapMessage::Player player;
-        player.playerId = id;
-        player.x = tank->position.x;
-        player.y = tank->position.y;
-        player.rotationBody = tank->bodyRotation.asDegrees();
-        player.rotationBarrel = tank->barrelRotation.asDegrees();
-        player.health = tank->getHealth();
-        player.ammo = tank->getAmmo();
-        player.isAlive = tank->IsAlive();
-        player.color = tank->GetColor();
-        snapShot.players.push_back(player);
+const GameSnapMessage& game_server::BuildGameSnap() {
+    PROFILE_ZONE("BuildGameSnap");
+
+    snapShot.players.resize(tanks.GetCount());
+    snapShot.bullets.clear();
+
+    // Straight down the columns
+    for (std::size_t i = 0; i < tanks.GetCount(); i++) {
+        GameSnapMessage::Player& player = snapShot.players[i];
+        player.playerId = static_cast<uint8_t>(tanks.netId[i]);
+        player.x = tanks.position[i].x;
+        player.y = tanks.position[i].y;
+        player.rotationBody = tanks.bodyRotation[i];
+        player.rotationBarrel = tanks.barrelRotation[i];
+        player.health = static_cast<uint8_t>(std::max<int16_t>(tanks.health[i], 0));
+        player.ammo = static_cast<uint8_t>(std::max<int16_t>(tanks.ammo[i], 0));
+        player.isAlive = tanks.health[i] > 0;
+        player.color = availableColors[tanks.render[i]];
     }
 
     return snapShot;
 }
 
 void game_server::CheckClientTimeouts() {
-    std::vector<int> timedOutclientsUDP;
+    ArenaVector<int> timedOutClients{ArenaAllocator<int>(tickArena)};
+    timedOutClients.reserve(clientsUDP.size());
 
-    for (const auto& [id, client] : clientsUDP) {
-        if (client.lastHeartbeat.getElapsedTime().asSeconds() > CLIENT_TIMEOUT) {
-            timedOutclientsUDP.push_back(id);
+    for (const ConnectedClient& client : clientsUDP) {
+        if (tick - client.lastHeartbeatTick > SecondsToTicks(CLIENT_TIMEOUT)) {
+            timedOutClients.push_back(client.playerId);
         }
     }
 
-    for (int id : timedOutclientsUDP) {
-        Utils::printMsg("Player " + std::to_string(id) + " timed out", warning);
+    for (int id : timedOutClients) {
+        PRINT_MSGF(warning, "Player %d timed out", id);
+        metrics.timeouts.Add();
         HandleDisconnect(id);
     }
 }
 
-void game_server::BroadcastMessage(sf::Packet& packet) {
-    for (const auto& [id, client] : clientsUDP) {
-        socketUDP.send(packet, client.ipAddress, client.port);
+void game_server::LogClientStats() {
+    for (const ConnectedClient& client : clientsUDP) {
+        const LinkStats& stats = client.stats;
+        PRINT_MSGF(debug, "Player %d rtt %d ms, jitter %d ms, loss %d%%, in %d B/s (%d pkt/s), out %d B/s (%d pkt/s)",
+                   client.playerId,
+                   static_cast<int>(stats.GetRtt() * 1000.f), static_cast<int>(stats.GetJitter() * 1000.f),
+                   static_cast<int>(stats.GetLoss() * 100.f),
+                   static_cast<int>(stats.GetBytesInRate()), static_cast<int>(stats.GetPacketsInRate()),
+                   static_cast<int>(stats.GetBytesOutRate()), static_cast<int>(stats.GetPacketsOutRate()));
     }
 }
 
-void game_server::BroadcastMessageTCP(sf::Packet& packet) {
-    for (const auto& client : clientsTCP) {
-        if (client->send(packet) != sf::Socket::Status::Done)
-        {
-            Utils::printMsg("Error broadcasting player: " + std::to_string(client->getRemotePort()), warning);
+void game_server::BroadcastMessage(const MessageWriter& message) {
+    if (!message) {
+        PRINT_MSG("Message too big to broadcast, dropped", error);
+        return;
+    }
+
+    for (ConnectedClient& client : clientsUDP) {
+        SendBatched(client, message);
+    }
+}
+
+void game_server::BroadcastReliable(const MessageWriter& message) {
+    for (ConnectedClient& client : clientsUDP) {
+        if (!client.channel.Send(message)) {
+            PRINT_MSGF(error, "Reliable message too big for player %d, dropped", client.playerId);
         }
     }
 }
 
-// Method that helps me to send data to an specific client
-void game_server::SendToClient(int playerId, sf::Packet& packet) {
-    auto client = clientsUDP.find(playerId);
-    if (client != clientsUDP.end()) {
-        socketUDP.send(packet, client->second.ipAddress, client->second.port);
+// Sends every reliable message that is new or waited longer than the resend timer
+void game_server::FlushReliable() {
+    const float now = Now();
+
+    for (ConnectedClient& client : clientsUDP) {
+        client.channel.Flush(now, [&](const MessageWriter& message) {
+            SendBatched(client, message);
+        });
+    }
+}
+
+// Everything for a client during a tick is queued in its batch and packed together
+void game_server::SendBatched(ConnectedClient& client, const MessageWriter& message) {
+    client.batch.Add(message, [&](const std::byte* data, std::size_t size) {
+        transport->SendUDP(data, size, client.ipAddress, client.port);
+        client.stats.OnSent(size);
+        metrics.bytesOut.Add(size);
+    });
+}
+
+void game_server::StageBatched(ConnectedClient& client, const MessageWriter& message) {
+    client.batch.Add(message, [&](const std::byte* data, std::size_t size) {
+        client.outbox.insert(client.outbox.end(), data, data + size);
+        client.outboxSizes.push_back(size);
+    });
+}
+
+void game_server::SendOutbox(ConnectedClient& client) {
+    const std::byte* data = client.outbox.data();
+
+    for (std::size_t size : client.outboxSizes) {
+        transport->SendUDP(data, size, client.ipAddress, client.port);
+        client.stats.OnSent(size);
+        metrics.bytesOut.Add(size);
+        data += size;
+    }
+
+    client.outbox.clear();
+    client.outboxSizes.clear();
+}
+
+void game_server::FlushBatches() {
+    for (ConnectedClient& client : clientsUDP) {
+        client.batch.Flush([&](const std::byte* data, std::size_t size) {
+            transport->SendUDP(data, size, client.ipAddress, client.port);
+            client.stats.OnSent(size);
+            metrics.bytesOut.Add(size);
+        });
     }
 }
 
-std::string game_server::AssignColor() {
-    for (size_t i = 0; i < availableColors.size(); i++) {
-        if (!colorUsed[i]) {
-            colorUsed[i] = true;
-            return availableColors[i];
+ConnectedClient* game_server::FindClient(const sf::IpAddress& address, unsigned short port) {
+    for (ConnectedClient& client : clientsUDP) {
+        if (client.ipAddress == address && client.port == port) {
+            return &client;
         }
     }
+    return nullptr;
+}
 
-    Utils::printMsg("NO COLOR AVILABLE", error);
-    return "blue";
+// Method that helps me to send data to an specific client
+void game_server::SendToClient(int playerId, const MessageWriter& message) {
+    if (ConnectedClient* client = clientsUDP.Find(playerId)) {
+        SendBatched(*client, message);
+    }
 }
 
-void game_server::FreeColor(const std::string& color) {
-    for (size_t i = 0; i < availableColors.size(); i++) {
-        if (availableColors[i] == color) {
-            colorUsed[i] = false;
-            break;
+// Least used colour, so with more than four players they are shared evenly
+RenderHandle game_server::AssignColor() {
+    size_t best = 0;
+    for (size_t i = 1; i < availableColors.size(); i++) {
+        if (colorUsers[i] < colorUsers[best]) {
+            best = i;
         }
     }
+
+    colorUsers[best]++;
+    return static_cast<RenderHandle>(best);
+}
+
+void game_server::FreeColor(RenderHandle color) {
+    if (colorUsers[color] > 0) {
+        colorUsers[color]--;
+    }
 }
 
 void game_server::CreatePickUps()
 {
-    int numHealthKits = 2;
-    int numAmmoBoxes = 4;
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> posX(0.f, 800.f);
-    std::uniform_real_distribution<float> posY(0.f, 600.f);
-
-    // Create health kits
-    for (int i = 0; i < numHealthKits; i++)
+    // A map places one pickup on each of its sites, health kits first like the ids expect
+    if (map && !map->GetPickupSites().empty())
     {
-        sf::Vector2f pos;
-        bool validPosition = false;
-
-        while (!validPosition)
+        for (uint8_t type : {uint8_t(1), uint8_t(0)})
         {
-            pos = { posX(gen), posY(gen) };
-            validPosition = true;
-
-            for (auto& obs : obstacles)
+            for (const MapPickupSite& site : map->GetPickupSites())
             {
-                float distToSpawn = std::sqrt(
-                    std::pow(pos.x - obs->GetPosition().x, 2) +
-                    std::pow(pos.y - obs->GetPosition().y, 2)
-                );
-
-                if (distToSpawn < ROCK_SPACE) {
-                    validPosition = false;
-                    break;  // No need to check other obstacles
-                }
+                if (site.type != type || pickups.GetCount() >= MAX_PICKUPS)
+                    continue;
+
+                AddPickUp(type == 1 ? EntityKind::HealthKit : EntityKind::AmmoBox, {site.x, site.y});
             }
         }
+        return;
+    }
+
+    // Two health kits and four ammo boxes on the original twelve chunks, as many per chunk on
+    // bigger worlds while the ids fit in a byte
+    const int chunkCount = collisionManager.GetLayout().GetCount();
+    int numHealthKits = std::max(2, chunkCount / 6);
+    int numAmmoBoxes = std::max(4, chunkCount / 3);
 
+    const int maxPickups = static_cast<int>(MAX_PICKUPS);
+    if (numHealthKits + numAmmoBoxes > maxPickups) {
+        numHealthKits = maxPickups / 3;
+        numAmmoBoxes = maxPickups - numHealthKits;
+    }
 
-        auto healthKit = std::make_unique<class healthKit>(pos);
-        healthKits.push_back(std::move(healthKit));
+    // Create health kits
+    for (int i = 0; i < numHealthKits; i++)
+    {
+        AddPickUp(EntityKind::HealthKit, RandomFreePosition());
     }
 
     // Create ammo boxes with same logic
     for (int i = 0; i < numAmmoBoxes; i++)
     {
-        sf::Vector2f pos;
-        bool validPosition = false;
-
-        while (!validPosition)
-        {
-            pos = { posX(gen), posY(gen) };
-            validPosition = true;
-
-            for (auto& obs : obstacles)
-            {
-                float distToSpawn = std::sqrt(
-                    std::pow(pos.x - obs->GetPosition().x, 2) +
-                    std::pow(pos.y - obs->GetPosition().y, 2)
-                );
-
-                if (distToSpawn < ROCK_SPACE) {
-                    validPosition = false;
-                    break;
-                }
-            }
-        }
-
-        auto ammoBox = std::make_unique<class ammoBox>(pos);
-        ammoBoxes.push_back(std::move(ammoBox));
+        AddPickUp(EntityKind::AmmoBox, RandomFreePosition());
     }
 }
 
-void game_server::SendPickUpsPositionTCP(sf::TcpSocket& socket)
+void game_server::AddPickUp(EntityKind kind, sf::Vector2f position)
 {
-    PickUpMessage msg;
+    const EntityId id = pickups.Create(kind, static_cast<int>(pickups.GetCount()), position);
+    if (deterministic)
+        SnapToFixed(pickups, pickups.IndexOf(id));
+}
 
-    for (size_t i = 0; i < healthKits.size(); i++)
-    {
+// A single draw from the baked free cells, no retry loop. The grid only fills up with a
+// broken layout, then the spawn point is still better than nothing
+sf::Vector2f game_server::RandomFreePosition()
+{
+    if (auto pos = spawnGrid.SampleFree(rng))
+        return *pos;
 
-        PickUpMessage::PickUpData data;
-        data.pickUpId = i;
-        data.pickUpType = 1; // HealthKit
-        data.x = healthKits[i]->GetPosition().x;
-        data.y = healthKits[i]->GetPosition().y;
+    PRINT_MSG("No free cell left for a pickup", warning);
+    return collisionManager.GetLayout().GetSpawnPoint();
+}
 
-        msg.pickUps.push_back(data);
+sf::Vector2f game_server::RandomPickupPosition(uint8_t pickUpType)
+{
+    if (!map)
+        return RandomFreePosition();
+
+    // Sites of the type are few, counting them on a pickup is cheaper than keeping lists
+    const MapSpan<MapPickupSite> sites = map->GetPickupSites();
+    const auto count = static_cast<uint32_t>(std::count_if(sites.begin(), sites.end(), [pickUpType](const MapPickupSite& site) {
+        return site.type == pickUpType;
+    }));
+    if (count == 0)
+        return RandomFreePosition();
+
+    uint32_t pick = static_cast<uint32_t>(rng()) % count;
+    for (const MapPickupSite& site : sites)
+    {
+        if (site.type == pickUpType && pick-- == 0)
+            return {site.x, site.y};
     }
+    return RandomFreePosition();
+}
+
+void game_server::SendPickUpsPositionTCP(int connection)
+{
+    PickUpMessage msg;
 
-    for (size_t i = 0; i < ammoBoxes.size(); i++)
+    for (size_t i = 0; i < pickups.GetCount(); i++)
     {
         PickUpMessage::PickUpData data;
-        data.pickUpId = healthKits.size() + i;
-        data.pickUpType = 0; // AmmoBox
-        data.x = ammoBoxes[i]->GetPosition().x;
-        data.y = ammoBoxes[i]->GetPosition().y;
+        data.pickUpId = static_cast<uint8_t>(pickups.netId[i]);
+        data.pickUpType = pickups.kind[i] == EntityKind::HealthKit ? 1 : 0;
+        data.x = pickups.position[i].x;
+        data.y = pickups.position[i].y;
         msg.pickUps.push_back(data);
     }
 
     sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::PickUP_DATA) << msg;
+    WriteMessage(packet, msg);
 
-    if (socket.send(packet) != sf::Socket::Status::Done)
+    if (!transport->SendTCP(connection, packet))
     {
         Utils::printMsg("Error sending the pickups pos",error);
     } else
@@ -542,15 +970,21 @@ void game_server::SendPickUpsPositionTCP(sf::TcpSocket& socket)
     }
 }
 
-void game_server::SendObstacleSeedTCP(sf::TcpSocket& socket)
+void game_server::SendObstacleSeedTCP(int connection)
 {
     ObstacleSeedMessage obs;
     obs.seed = SEED;
+    obs.chunkColumns = static_cast<uint16_t>(collisionManager.GetLayout().GetColumns());
+    obs.chunkRows = static_cast<uint16_t>(collisionManager.GetLayout().GetRows());
+    if (map) {
+        obs.mapName = map->GetName().substr(0, MAX_MAP_NAME_LENGTH);
+        obs.mapChecksum = map->GetHeader().checksum;
+    }
 
     sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::OBSTACLE_SEED) << obs;
+    WriteMessage(packet, obs);
 
-    if (socket.send(packet) != sf::Socket::Status::Done)
+    if (!transport->SendTCP(connection, packet))
     {
         Utils::printMsg("Error sending the seed",error);
     }
@@ -563,7 +997,7 @@ void game_server::CheckPendingRespawns()
 {
     for (auto i = pendingRespawns.begin(); i != pendingRespawns.end();)
     {
-        if (i->deathTimer.getElapsedTime().asSeconds() >= RESPAWN_TIME)
+        if (tick - i->deathTick >= SecondsToTicks(RESPAWN_TIME))
         {
             RespawnPlayer(i->victimId);
             i = pendingRespawns.erase(i);
@@ -575,25 +1009,28 @@ void game_server::CheckPendingRespawns()
 }
 
 void game_server::RespawnPlayer(int playerId) {
-    auto tankPlayer = tanks.find(playerId);
-    if (tankPlayer == tanks.end()) {
-        Utils::printMsg("Tank with id:  " + std::to_string(playerId) + " - not found in the vector", error);
+    const EntityId tankId = TankOf(playerId);
+    if (!tanks.Contains(tankId)) {
+        PRINT_MSGF(error, "Tank with id:  %d - not found in the vector", playerId);
         return;
     }
 
-    Tank* tank = tankPlayer->second.get();
-
     // Respawn at center
-    sf::Vector2f respawnPosition = {640.f, 480.f};
-    tank->position = respawnPosition;
+    const std::size_t tank = tanks.IndexOf(tankId);
+    sf::Vector2f respawnPosition = SpawnPointFor(map.get(), collisionManager.GetLayout(), playerId);
+    tanks.position[tank] = respawnPosition;
+    tanks.health[tank] = Tank::MAX_HEALTH;
+    tanks.ammo[tank] = Tank::MAX_AMMO;
+    if (deterministic) {
+        SnapToFixed(tanks, tank);
+    }
 
-    auto client = clientsUDP.find(playerId);
-    if (client != clientsUDP.end()) {
-        client->second.prevShootState = false;
-        client->second.isPendingRespawn = false;
+    if (ConnectedClient* client = clientsUDP.Find(playerId)) {
+        client->prevShootState = false;
+        client->isPendingRespawn = false;
     }
 
-    Utils::printMsg("Tank with id: " + std::to_string(playerId) + " back in action", success);
+    PRINT_MSGF(success, "Tank with id: %d back in action", playerId);
 
     // Send respawn notification to all clientsUDP
     PlayerRespawnedMessage respawnMsg;
@@ -601,62 +1038,330 @@ void game_server::RespawnPlayer(int playerId) {
     respawnMsg.x = respawnPosition.x;
     respawnMsg.y = respawnPosition.y;
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::PLAYER_RESPAWNED) << respawnMsg;
-    BroadcastMessageTCP(packet);
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, respawnMsg);
+    BroadcastReliable(writer);
 }
 
-void game_server::HandlePickUpsUpdate(PickUpHitMessage msg)
+EntityId game_server::TankOf(int playerId) const
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> posX(0.f, 800.f);
-    std::uniform_real_distribution<float> posY(0.f, 600.f);
+    if (const ConnectedClient* client = clientsUDP.Find(playerId))
+        return client->tank;
+
+    for (const ServerBot& bot : bots)
+    {
+        if (bot.playerId == playerId)
+            return bot.tank;
+    }
+    return NO_ENTITY;
+}
 
-    Utils::printMsg("Moving pikcup to a new position", debug);
+void game_server::CollectPickUps()
+{
+    PROFILE_ZONE("CollectPickUps");
 
-    sf::Vector2f newPos;
-    bool validPosition = false;
+    // Ids a tank touched this tick
+    ArenaVector<int> pickupHits{ArenaAllocator<int>(tickArena)};
+    pickupHits.reserve(pickups.GetCount());
 
-    while (!validPosition)
+    for (std::size_t tank = 0; tank < tanks.GetCount(); tank++)
     {
-        newPos = { posX(gen), posY(gen) };
-        validPosition = true;
+        // Players die on their own client, bots on the server
+        const ConnectedClient* client = clientsUDP.Find(tanks.netId[tank]);
+        const bool dead = client ? client->isPendingRespawn : tanks.health[tank] <= 0;
+        if (dead)
+            continue;
+
+        // Collected after the query, a pickup that moves must not be seen twice in it
+        const sf::FloatRect bounds = BoundsOf(tanks, tank, TANK_SIZE);
+        pickupHits.clear();
+        pickupIndex.ForEachNear(bounds, [&](int pickup) {
+            if (BoundsOf(pickups, static_cast<std::size_t>(pickup), PICKUP_SIZE).findIntersection(bounds))
+                pickupHits.push_back(pickup);
+        });
+
+        for (int pickup : pickupHits)
+        {
+            GivePickUp(tank, static_cast<std::size_t>(pickup));
+        }
+    }
+}
 
-        for (auto& obs : obstacles)
+void game_server::GivePickUp(std::size_t tank, std::size_t pickup)
+{
+    // 0 is ammo box, 1 is health kit
+    const uint8_t pickUpType = pickups.kind[pickup] == EntityKind::HealthKit ? 1 : 0;
+    if (pickUpType == 1)
+        tanks.health[tank] = static_cast<int16_t>(std::min(tanks.health[tank] + HEALTH_KIT_AMOUNT, Tank::MAX_HEALTH));
+    else
+        tanks.ammo[tank] = static_cast<int16_t>(std::min(tanks.ammo[tank] + AMMO_BOX_AMOUNT, Tank::MAX_AMMO));
+
+    const sf::Vector2f newPos = RandomPickupPosition(pickUpType);
+    pickups.position[pickup] = newPos;
+    if (deterministic)
+        SnapToFixed(pickups, pickup);
+    pickupIndex.Move(static_cast<int>(pickup), newPos);
+    metrics.pickupsCollected.Add();
+
+    const int playerId = tanks.netId[tank];
+    PRINT_MSGF(debug, "Player %d collected pickup %zu", playerId, pickup);
+
+    // Broadcast to all players
+    PickUpUpdatedMessage updateMsg;
+    updateMsg.pickUpId = static_cast<uint8_t>(pickups.netId[pickup]);
+    updateMsg.pickUpType = pickUpType;
+    updateMsg.x = newPos.x;
+    updateMsg.y = newPos.y;
+    updateMsg.collectorId = static_cast<uint8_t>(playerId);
+
+    MessageWriter writer(GetSendBuffer());
+    WriteMessage(writer, updateMsg);
+    BroadcastReliable(writer);
+}
+
+void game_server::CreateServerBots(std::size_t count)
+{
+    bots.reserve(count);
+    tanks.Reserve(count + maxPlayers);
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const int playerId = nextPlayerId++;
+
+        // Shots spread over the first second so a room of bots does not fire in volleys
+        ServerBot bot;
+        bot.playerId = playerId;
+        bot.tank = tanks.Create(EntityKind::Tank, playerId, RandomFreePosition());
+        bot.nextShotTick = static_cast<uint32_t>(i) % SecondsToTicks(BOT_FIRE_INTERVAL);
+        bots.push_back(bot);
+
+        const std::size_t index = tanks.IndexOf(bot.tank);
+        tanks.health[index] = Tank::MAX_HEALTH;
+        tanks.ammo[index] = Tank::MAX_AMMO;
+        tanks.render[index] = AssignColor();
+        if (deterministic)
+            SnapToFixed(tanks, index);
+    }
+}
+
+void game_server::UpdateServerBots()
+{
+    if (bots.empty())
+        return;
+
+    PROFILE_ZONE("UpdateServerBots");
+
+    const float dt = 1.0f / TICK_RATE;
+    const uint32_t targetInterval = SecondsToTicks(BOT_TARGET_INTERVAL);
+
+    for (std::size_t i = 0; i < bots.size(); i++)
+    {
+        ServerBot& bot = bots[i];
+        const std::size_t tank = tanks.IndexOf(bot.tank);
+        tanks.velocity[tank] = {0.f, 0.f};
+        tanks.fixedVelocity[tank] = {};
+        if (tanks.health[tank] <= 0)
+            continue;
+
+        // Targets are picked again every interval, a different tick for each bot
+        if (!IsBotTarget(bot.targetId) || (tick + i) % targetInterval == 0)
+            PickBotTarget(bot, tanks.position[tank]);
+
+        if (!IsBotTarget(bot.targetId))
+            continue;
+
+        const sf::Vector2f targetPosition = tanks.position[tanks.IndexOf(TankOf(bot.targetId))];
+        const sf::Vector2f toTarget = targetPosition - tanks.position[tank];
+        const float distance = std::sqrt(toTarget.x * toTarget.x + toTarget.y * toTarget.y);
+
+        std::optional<sf::Vector2f> drive;
+        if (distance > BOT_STOP_DISTANCE)
+        {
+            // Straight at the target when the field has no way from here (pushed into a rock)
+            const FlowField& field = flowFields.Get(navGrid, bot.targetId, targetPosition, tick);
+            drive = field.GetDirection(navGrid, tanks.position[tank]).value_or(toTarget / distance);
+        }
+
+        if (deterministic)
+            SteerBotFixed(tank, toTarget, drive);
+        else
+            SteerBot(tank, toTarget, drive);
+
+        if (distance < BOT_FIRE_RANGE && tick >= bot.nextShotTick)
+        {
+            SpawnBullet(bot.playerId, bot.tank);
+            bot.nextShotTick = tick + SecondsToTicks(BOT_FIRE_INTERVAL);
+        }
+    }
+
+    // Players have no velocity here, their clients move them
+    jobs.ParallelFor(tanks.GetCount(), ENTITY_GRAIN, [&](std::size_t begin, std::size_t end)
+    {
+        if (deterministic)
+            IntegrateFixedVelocities(tanks, begin, end);
+        else
+            IntegrateVelocities(tanks, dt, begin, end);
+    });
+
+    // Pushed back out of rocks like Tank::Update does on the clients. Every bot only moves its
+    // own tank and the rocks never change, so the bots are split over the jobs
+    jobs.ParallelFor(bots.size(), BOT_GRAIN, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
         {
-            float distToSpawn = std::sqrt(
-                std::pow(newPos.x - obs->GetPosition().x, 2) +
-                std::pow(newPos.y - obs->GetPosition().y, 2)
-            );
-
-            if (distToSpawn < ROCK_SPACE) {
-                validPosition = false;
-                break;
+            const std::size_t tank = tanks.IndexOf(bots[i].tank);
+            sf::Vector2f pushback;
+            if (!collisionManager.CheckCollision(BoundsOf(tanks, tank, TANK_SIZE), pushback))
+                continue;
+
+            if (deterministic)
+            {
+                tanks.fixedPosition[tank] += FixedVec{ToFixed(pushback.x), ToFixed(pushback.y)};
+                SyncFromFixed(tanks, tank);
+            }
+            else
+            {
+                tanks.position[tank] += pushback;
             }
         }
+    });
+
+    // Fields of players nobody chased for a while go
+    const uint32_t keep = SecondsToTicks(2.0f);
+    flowFields.Prune(tick > keep ? tick - keep : 0);
+    metrics.flowFieldBuilds.Add(flowFields.TakeBuildCount());
+}
+
+void game_server::PickBotTarget(ServerBot& bot, sf::Vector2f position)
+{
+    bot.targetId = -1;
+    float closest = 0.f;
+
+    for (const ConnectedClient& client : clientsUDP)
+    {
+        if (!IsBotTarget(client.playerId))
+            continue;
+
+        const sf::Vector2f offset = tanks.position[tanks.IndexOf(client.tank)] - position;
+        const float distance = offset.x * offset.x + offset.y * offset.y;
+        if (bot.targetId < 0 || distance < closest)
+        {
+            bot.targetId = client.playerId;
+            closest = distance;
+        }
     }
+}
+
+void game_server::SteerBot(std::size_t tank, sf::Vector2f toTarget, std::optional<sf::Vector2f> drive)
+{
+    // The barrel tip is rotation + 90, like SpawnBullet
+    tanks.barrelRotation[tank] = std::atan2(toTarget.y, toTarget.x) * 180.f / 3.14159265f - 90.f;
 
-    if (msg.pickUpType == 0)
+    if (!drive)
+        return;
+
+    // Driving forward goes along rotation + 90 (Tank::Update), turn at a player's speed
+    // and only drive once roughly facing the way
+    const float heading = std::atan2(drive->y, drive->x) * 180.f / 3.14159265f - 90.f;
+    const float turn = std::remainder(heading - tanks.bodyRotation[tank], 360.f);
+    const float maxTurn = Tank::ROTATION_SPEED / TICK_RATE;
+
+    float& rotation = tanks.bodyRotation[tank];
+    rotation = std::remainder(rotation + std::clamp(turn, -maxTurn, maxTurn), 360.f);
+
+    if (std::abs(turn) < 60.f)
     {
-        // AmmoBox
-        size_t ammoBoxIndex = msg.pickUpId - healthKits.size();
-        ammoBoxes[ammoBoxIndex]->SetPosition(newPos);
+        const float forward = (rotation + 90.f) * 3.14159265f / 180.f;
+        tanks.velocity[tank] = sf::Vector2f{std::cos(forward), std::sin(forward)} * Tank::MOVEMENT_SPEED;
     }
-    else if (msg.pickUpType == 1)
+}
+
+// SteerBot in fixed point, the angles come from FixedAtan2 and the velocity from the sine table
+void game_server::SteerBotFixed(std::size_t tank, sf::Vector2f toTarget, std::optional<sf::Vector2f> drive)
+{
+    tanks.fixedBarrel[tank] = static_cast<FixedAngle>(FixedAtan2(ToFixed(toTarget.y), ToFixed(toTarget.x)) - ANGLE_QUARTER);
+
+    if (drive)
     {
-        // HealthKit
-        healthKits[msg.pickUpId]->SetPosition(newPos);
+        const FixedAngle heading = static_cast<FixedAngle>(FixedAtan2(ToFixed(drive->y), ToFixed(drive->x)) - ANGLE_QUARTER);
+        const int turn = AngleDelta(tanks.fixedBody[tank], heading);
+        const int maxTurn = AngleFromDegrees(Tank::ROTATION_SPEED / TICK_RATE);
+
+        FixedAngle& rotation = tanks.fixedBody[tank];
+        rotation = static_cast<FixedAngle>(rotation + std::clamp(turn, -maxTurn, maxTurn));
+
+        if (std::abs(turn) < AngleFromDegrees(60.f))
+        {
+            const FixedVec forward = FixedDirection(static_cast<FixedAngle>(rotation + ANGLE_QUARTER));
+            tanks.fixedVelocity[tank] = forward * ToFixed(Tank::MOVEMENT_SPEED / TICK_RATE);
+        }
     }
 
-    // Broadcast to all players
-    PickUpUpdatedMessage updateMsg;
-    updateMsg.pickUpId = msg.pickUpId;
-    updateMsg.pickUpType = msg.pickUpType;
-    updateMsg.x = newPos.x;
-    updateMsg.y = newPos.y;
+    SyncFromFixed(tanks, tank);
+}
 
-    sf::Packet packet;
-    packet << static_cast<uint8_t>(MessageTypeProtocole::PickUp_UPDATE) << updateMsg;
-    BroadcastMessageTCP(packet);
-}
\ No newline at end of file
+// Only players are chased, and not while they wait to respawn
+bool game_server::IsBotTarget(int playerId) const
+{
+    const ConnectedClient* client = clientsUDP.Find(playerId);
+    return client && !client->isPendingRespawn && tanks.Contains(client->tank);
+}
+
+sf::FloatRect game_server::BoundsOf(const EntityStore& store, std::size_t index, float size) const
+{
+    if (deterministic)
+        return FixedEntityBounds(store.fixedPosition[index], size, store.fixedBody[index]);
+
+    return EntityBounds(store.position[index], size, store.bodyRotation[index]);
+}
+
+// Tanks, bullets and pickups in column order, which only depends on what happened before
+void game_server::HashState()
+{
+    StateHash hash;
+    hash.Add(tick);
+    HashEntities(hash, tanks);
+    HashEntities(hash, bullets);
+    HashEntities(hash, pickups);
+    stateHash = hash.Get();
+
+    StateHash run;
+    run.Add(static_cast<uint32_t>(runHash));
+    run.Add(static_cast<uint32_t>(runHash >> 32));
+    run.Add(static_cast<uint32_t>(stateHash));
+    run.Add(static_cast<uint32_t>(stateHash >> 32));
+    runHash = run.Get();
+}
+
+// Players take hits on their own client, the server only decides for its bots
+bool game_server::HitServerBots(std::size_t bullet)
+{
+    if (bots.empty())
+        return false;
+
+    const sf::FloatRect bounds = BoundsOf(bullets, bullet, BULLET_SIZE);
+
+    for (const ServerBot& bot : bots)
+    {
+        const std::size_t tank = tanks.IndexOf(bot.tank);
+        if (bot.playerId == bullets.owner[bullet] || tanks.health[tank] <= 0)
+            continue;
+        if (!BoundsOf(tanks, tank, TANK_SIZE).findIntersection(bounds))
+            continue;
+
+        tanks.health[tank] = static_cast<int16_t>(tanks.health[tank] - BULLET_DAMAGE);
+        if (tanks.health[tank] <= 0)
+        {
+            PlayerDiedMessage diedMsg;
+            diedMsg.victimId = static_cast<uint8_t>(bot.playerId);
+
+            MessageWriter writer(GetSendBuffer());
+            WriteMessage(writer, diedMsg);
+            BroadcastReliable(writer);
+
+            pendingRespawns.emplace_back(bot.playerId, bullets.owner[bullet], tick);
+        }
+        return true;
+    }
+    return false;
+}
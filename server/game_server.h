@@ -9,42 +9,76 @@
 
 #include "../game/ammoBox.h"
 #include "../game/collision_manager.h"
+#include "../game/entity_store.h"
+#include "../game/slot_map.h"
 #include "../game/healthKit.h"
 #include "../game/obstacle.h"
 #include "../game/tank.h"
+#include "../game/world_gen.h"
+#include "../game/map_file.h"
 #include "../game/protocole_message.h"
+#include "../game/message_stream.h"
+#include "../game/reliable_channel.h"
+#include "../game/message_batch.h"
+#include "../game/snapshot_parts.h"
+#include "../game/job_system.h"
+#include "server_transport.h"
+#include "packet_capture.h"
+#include "pickup_index.h"
+#include "tick_arena.h"
+#include "flow_field.h"
+#include "server_metrics.h"
 
 
 struct ConnectedClient {
     sf::IpAddress ipAddress;
     unsigned short port;
     int playerId;
-    bool isPendingRespawn;
+    bool isPendingRespawn = false;
 
     std::string playerName;
 
-    sf::Clock lastHeartbeat;  // For timeout detection
+    uint32_t lastHeartbeatTick = 0;  // For timeout detection
+
+    // Events (joins, deaths, pickups...) both ways, acks ride on snapshots and tank updates
+    ReliableChannel channel;
+
+    // The player's tank in game_server::tanks
+    EntityId tank = NO_ENTITY;
+
+    // RTT, loss and bandwidth of this client's link
+    LinkStats stats;
+
+    // Messages queued during the tick, packed into as few datagrams as possible
+    MessageBatch batch;
+
+    // Datagrams the batch filled on a job thread, sent from the tick thread in client order.
+    // Kept between ticks so they stop allocating once grown
+    std::vector<std::byte> outbox;
+    std::vector<std::size_t> outboxSizes;
+
     bool prevShootState = false;  // Track previous shoot state for edge detection
 
-    ConnectedClient(sf::IpAddress address, unsigned short port, int playerId, std::string playerName)
-    : ipAddress(address), port(port), playerId(playerId), playerName(playerName),prevShootState(false) {}
+    ConnectedClient(sf::IpAddress address, unsigned short port, int playerId, std::string playerName, std::size_t maxPayload)
+    : ipAddress(address), port(port), playerId(playerId), playerName(playerName), batch(maxPayload), prevShootState(false) {}
 };
 
-struct Bullet {
-    int bulletId;
-    std::unique_ptr<bullet> bulletPrefab;
-    int ownerId;
+// Tank the server drives, it has no client and chases the closest player
+struct ServerBot
+{
+    int playerId;
+    EntityId tank;
+    int targetId = -1;
+    uint32_t nextShotTick = 0;
 };
 
 struct RespawnClient
 {
     int victimId;
     int killerId;
-    sf::Clock deathTimer;
+    uint32_t deathTick;
 
-    RespawnClient(int pId, int kId) : victimId(pId), killerId(kId) {
-        deathTimer.restart();
-    }
+    RespawnClient(int pId, int kId, uint32_t tick) : victimId(pId), killerId(kId), deathTick(tick) {}
 };
 
 
@@ -52,22 +86,49 @@ class game_server
 {
     public:
         explicit game_server(unsigned short port);
+        game_server(std::unique_ptr<ServerTransport> transport, uint16_t seed);
 
         void Update();
 
+        // One fixed step and the sends after it, Update calls these and so does the replay driver
+        void Tick();
+        void SendUpdates();
+
+        // Record every inbound message to a capture file for replay
+        void StartCapture(const std::string& path);
+
+        // Serve the metrics as Prometheus text on a local port and/or a file (0 / empty is off)
+        void StartMetrics(unsigned short port, const std::string& filePath, float fileInterval);
+
+        // Deterministic mode only (DETERMINISTIC_SIM), 0 otherwise. The state after the last tick,
+        // and all the ticks so far folded together: two runs of a capture match when these do
+        uint64_t GetStateHash() const { return stateHash; }
+        uint64_t GetRunHash() const { return runHash; }
+
     private:
         // Networking
 
-        sf::TcpListener listenerTCP;
-        sf::SocketSelector selectorTCP;
-        std::vector<std::unique_ptr<sf::TcpSocket>> clientsTCP;
+        std::unique_ptr<ServerTransport> transport;
+        std::unique_ptr<PacketRecorder> recorder;
+
+        // Updated on the tick with relaxed atomics, read by the exporter thread
+        ServerMetrics metrics;
+        std::unique_ptr<MetricsExporter> metricsExporter;
+
+        // By player id, packed so the per tick walks over every client are a linear scan
+        PlayerSlots<ConnectedClient> clientsUDP;
 
-        sf::UdpSocket socketUDP;
-        std::unordered_map<int, ConnectedClient> clientsUDP;
+        // Game state, one store per kind so every system walks only its own columns.
+        // Players and bots are both tanks, netId is the player id
+        EntityStore tanks;
+        EntityStore bullets;
+        void UpdateBullets();
 
-        // Game state
-        std::unordered_map<int, std::unique_ptr<Tank>> tanks;
-        std::vector<Bullet> bullets;
+        // Player or bot, NO_ENTITY when the id has no tank
+        EntityId TankOf(int playerId) const;
+
+        // Handcrafted map from MAP_FILE, null for a world generated from SEED
+        std::unique_ptr<MapFile> map;
         CollisionManager collisionManager;
 
         // ID management
@@ -76,20 +137,48 @@ class game_server
 
         // possible colors
         std::vector<std::string> availableColors = {"blue", "red", "green", "black"};
-        std::vector<bool> colorUsed = {false, false, false, false};
+        std::vector<int> colorUsers = {0, 0, 0, 0};
 
         // Server settings
         const float TICK_RATE = 60.0f;  // ticks per second, based on how valve has tickrate for csgo https://developer.valvesoftware.com/wiki/Source_Multiplayer_Networking
         const float CLIENT_TIMEOUT = 10.0f;  // seconds timeout
         const float RESPAWN_TIME = 2.0f; // 2 seconds
         const int SLEEP_TIME = 10; // miliseconds
+        const float STATS_LOG_INTERVAL = 10.0f; // seconds between link stats in the log
+
+        // Scratch memory, reset at the end of every Tick and after every snapshot is sent, so
+        // several ticks run back to back never pile up in it
+        static constexpr std::size_t TICK_ARENA_SIZE = 64 * 1024;
+        TickArena tickArena{TICK_ARENA_SIZE};
+        void ResetTickArena();
+
+        // Workers for the loops over entities and clients (config JOB_THREADS). Only the tick
+        // thread calls it, and the tick arena is never used from inside a job
+        JobSystem jobs;
+
+        // Entities (or clients, or snapshot parts) per job, fewer stay on the tick thread
+        static constexpr std::size_t ENTITY_GRAIN = 256;
+        static constexpr std::size_t BOT_GRAIN = 16;
+        static constexpr std::size_t CLIENT_GRAIN = 8;
+        static constexpr std::size_t SNAPSHOT_PART_GRAIN = 4;
+
+        // Fixed steps run so far, timeouts and respawns count in ticks so a replay matches the match
+        uint32_t tick = 0;
+        uint32_t SecondsToTicks(float seconds) const { return static_cast<uint32_t>(seconds * TICK_RATE); }
+
+        // Time base for the reliable channel resend timers
+        sf::Clock serverClock;
+        float Now() const { return serverClock.getElapsedTime().asSeconds(); }
 
         // Obstacles
         std::vector<std::unique_ptr<obstacle>> obstacles;
 
-        // PickUps
-        std::vector<std::unique_ptr<ammoBox>> ammoBoxes;
-        std::vector<std::unique_ptr<healthKit>> healthKits;
+        // PickUps are never destroyed, so the column index is the pickup id. Health kits take the
+        // first ids and ammo boxes the ones after
+        EntityStore pickups;
+
+        // Where every pickup is, so a tank only checks the few around it
+        PickupIndex pickupIndex;
 
         // array to store respowning tanks
         std::vector<RespawnClient> pendingRespawns;
@@ -97,37 +186,121 @@ class game_server
 
         // Methods
         void ProcessMessages();
-        void ProcessMessagesTCP(sf::TcpSocket& socket, MessageTypeProtocole type, sf::Packet& packet);
+        void ProcessMessagesTCP(int connection, MessageTypeProtocole type, sf::Packet& packet);
         void SendGameSnapShot();
         void CheckClientTimeouts();
+        void LogClientStats();
 
-        void BroadcastMessageTCP(sf::Packet& packet);
-        void BroadcastMessage(sf::Packet& packet);
+        void BroadcastMessage(const MessageWriter& message);
+        void BroadcastReliable(const MessageWriter& message);
+        void FlushReliable();
+        void SendBatched(ConnectedClient& client, const MessageWriter& message);
 
-        void SendObstacleSeedTCP(sf::TcpSocket& socket);
+        // SendBatched for job threads, the datagrams wait in the client's outbox for SendOutbox
+        void StageBatched(ConnectedClient& client, const MessageWriter& message);
+        void SendOutbox(ConnectedClient& client);
+        void FlushBatches();
+        void ProcessMessageUDP(MessageReader& packet, const std::optional<sf::IpAddress>& senderIP, unsigned short senderPort);
+        void ProcessReliableMessage(MessageReader& packet);
 
-        void SendPickUpsPositionTCP(sf::TcpSocket& socket);
+        ConnectedClient* FindClient(const sf::IpAddress& address, unsigned short port);
 
-        void HandleJoinRequestTCP(sf::TcpSocket& ,JoinRequestMessage msg);
+        void SendObstacleSeedTCP(int connection);
+
+        void SendPickUpsPositionTCP(int connection);
+
+        void HandleJoinRequestTCP(int connection, JoinRequestMessage msg);
         void HandleTankUpdate(TankMessage msg);
-        void HandlePickUpsUpdate(PickUpHitMessage msg);
         void HandleDisconnect(int playerId);
 
-        void SpawnBullet(int ownerId);
+        void SpawnBullet(int ownerId, EntityId tank);
 
         void CreatePickUps();
+        void AddPickUp(EntityKind kind, sf::Vector2f position);
+
+        // Tanks that drive over a pickup get it, checked here and never trusted from a client
+        void CollectPickUps();
+        void GivePickUp(std::size_t tank, std::size_t pickup);
 
-        void SendToClient(int playerId, sf::Packet& packet);
+        void SendToClient(int playerId, const MessageWriter& message);
 
         void CheckPendingRespawns();
         void RespawnPlayer(int playerId);
 
-        std::string AssignColor();
-        void FreeColor(const std::string& color);
+        // Index into availableColors, it is the render handle of the tank
+        RenderHandle AssignColor();
+        void FreeColor(RenderHandle color);
+
+        // Chunks around a player that are simulated, enough to cover what the client sees
+        static constexpr int ACTIVE_CHUNK_RINGS = 2;
+
+        // Largest world accepted from the config, in chunks on each side
+        static constexpr int MAX_WORLD_CHUNKS = 256;
+
+        // Chunks with a player close enough, bullets anywhere else are retired
+        std::vector<uint8_t> chunkActive;
+        std::vector<int> activeChunks;
+        void UpdateActiveChunks();
 
-        const float ROCK_SPACE = 64.0;
+        // Room kept between a pickup and a rock, and from the edge of the world
+        static constexpr float ROCK_SPACE = 32.f;
+        static constexpr float SPAWN_CELL_SIZE = 32.f;
 
         uint16_t SEED;
 
-        GameSnapMessage BuildGameSnap();
+        // Every random choice the server makes comes from here, seeded with SEED
+        std::mt19937 rng;
+
+        // Deterministic simulation (config DETERMINISTIC_SIM): bots and bullets step in fixed
+        // point with table trigonometry, and the state is hashed after every tick
+        bool deterministic;
+        uint64_t stateHash = 0;
+        uint64_t runHash = 0;
+        void HashState();
+
+        // EntityBounds of one entity of the store, from the fixed columns in deterministic mode
+        sf::FloatRect BoundsOf(const EntityStore& store, std::size_t index, float size) const;
+
+        // Free space for pickups, baked once from the rocks
+        OccupancyGrid spawnGrid;
+        sf::Vector2f RandomFreePosition();
+
+        // Server bots (config SERVER_BOTS). They drive over navGrid, the static colliders grown
+        // by half a tank, and every bot after the same player follows one shared flow field
+        static constexpr float NAV_CELL_SIZE = 32.f;
+        static constexpr float BOT_CLEARANCE = 20.f;
+        static constexpr float BOT_STOP_DISTANCE = 120.f;   // close enough, stop and shoot
+        static constexpr float BOT_FIRE_RANGE = 350.f;
+        static constexpr float BOT_FIRE_INTERVAL = 1.0f;    // seconds
+        static constexpr float BOT_TARGET_INTERVAL = 1.0f;  // seconds between picking a target
+
+        std::vector<ServerBot> bots;
+        OccupancyGrid navGrid;
+        FlowFieldCache flowFields;
+
+        void CreateServerBots(std::size_t count);
+        void UpdateServerBots();
+        void PickBotTarget(ServerBot& bot, sf::Vector2f position);
+        bool IsBotTarget(int playerId) const;
+
+        // Aims at the target and, given a way to drive, turns and sets off along it
+        void SteerBot(std::size_t tank, sf::Vector2f toTarget, std::optional<sf::Vector2f> drive);
+        void SteerBotFixed(std::size_t tank, sf::Vector2f toTarget, std::optional<sf::Vector2f> drive);
+
+        // True when the bullet at that index hit a bot, the bot took the damage
+        bool HitServerBots(std::size_t bullet);
+
+        // A random pickup site of that type from the map, or a free position
+        sf::Vector2f RandomPickupPosition(uint8_t pickUpType);
+
+        // Payload limit for every datagram, snapshots are split to fit (config MAX_PAYLOAD)
+        std::size_t maxPayload;
+
+        // Players accepted before joins get rejected, colours are shared past the fourth
+        std::size_t maxPlayers;
+        uint16_t nextSnapshotId = 0;
+
+        // Reused every tick so the players vector keeps its capacity
+        GameSnapMessage snapShot;
+        const GameSnapMessage& BuildGameSnap();
 };
\ No newline at end of file
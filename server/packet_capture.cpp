@@ -0,0 +1,181 @@
+#include "packet_capture.h"
+#include "../game/message_stream.h"
+#include "../game/utils.h"
+#include <array>
+#include <cstring>
+
+static constexpr char CAPTURE_MAGIC[4] = {'T', 'N', 'K', 'C'};
+static constexpr std::size_t CAPTURE_HEADER_SIZE = sizeof(CAPTURE_MAGIC) + 2 * sizeof(uint16_t);
+static constexpr std::size_t RECORD_HEADER_SIZE = 3 * sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint32_t);
+
+// Big enough that a busy tick only hits the disk once
+static constexpr std::size_t CAPTURE_FILE_BUFFER = 1 << 16;
+
+PacketRecorder::PacketRecorder(const std::string& path, uint16_t seed)
+    : fileBuffer(CAPTURE_FILE_BUFFER)
+{
+    file.rdbuf()->pubsetbuf(fileBuffer.data(), static_cast<std::streamsize>(fileBuffer.size()));
+    file.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        Utils::printMsg("Failed to open capture file " + path, error);
+        return;
+    }
+
+    std::array<std::byte, CAPTURE_HEADER_SIZE> header;
+    MessageWriter writer(header.data(), header.size());
+    writer.Append(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    writer << CAPTURE_VERSION << seed;
+
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(writer.GetSize()));
+    Utils::printMsg("Capturing inbound traffic to " + path, info);
+}
+
+void PacketRecorder::RecordTCP(uint32_t tick, int connection, const std::optional<sf::IpAddress>& address, const sf::Packet& packet)
+{
+    Write(tick, CaptureChannel::Tcp, static_cast<uint32_t>(connection), address, 0, packet.getData(), packet.getDataSize());
+}
+
+void PacketRecorder::RecordUDP(uint32_t tick, const std::optional<sf::IpAddress>& address, unsigned short port,
+                               const std::byte* data, std::size_t size)
+{
+    Write(tick, CaptureChannel::Udp, 0, address, port, data, size);
+}
+
+void PacketRecorder::Write(uint32_t tick, CaptureChannel channel, uint32_t connection, const std::optional<sf::IpAddress>& address,
+                           uint16_t port, const void* data, std::size_t size)
+{
+    if (!file.is_open())
+        return;
+
+    std::array<std::byte, RECORD_HEADER_SIZE> header;
+    MessageWriter writer(header.data(), header.size());
+    writer << tick << static_cast<uint8_t>(channel) << connection
+           << (address ? address->toInteger() : 0u) << port << static_cast<uint32_t>(size);
+
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(writer.GetSize()));
+    file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+bool ReplayTransport::Load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        Utils::printMsg("Failed to open capture file " + path, error);
+        return false;
+    }
+
+    data.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    MessageReader reader(data.data(), data.size());
+
+    char magic[sizeof(CAPTURE_MAGIC)] = {};
+    uint16_t version = 0;
+    if (data.size() >= sizeof(magic))
+        std::memcpy(magic, data.data(), sizeof(magic));
+    reader.Skip(sizeof(magic));
+    reader >> version >> seed;
+
+    if (!reader || std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0 || version != CAPTURE_VERSION) {
+        Utils::printMsg("Not a capture file or wrong version: " + path, error);
+        return false;
+    }
+
+    records.clear();
+    connectionAddresses.clear();
+    nextRecord = 0;
+
+    while (!reader.EndOfMessage())
+    {
+        Record record;
+        uint8_t channel;
+        uint32_t connection;
+        uint32_t size;
+
+        if (!(reader >> record.tick >> channel >> connection >> record.address >> record.port >> size) ||
+            size > reader.GetRemainingSize() || channel > static_cast<uint8_t>(CaptureChannel::Udp)) {
+            // A capture cut short (server killed mid write), keep what is complete
+            Utils::printMsg("Capture truncated after " + std::to_string(records.size()) + " records", warning);
+            break;
+        }
+
+        record.channel = static_cast<CaptureChannel>(channel);
+        record.connection = static_cast<int>(connection);
+        record.offset = data.size() - reader.GetRemainingSize();
+        record.size = size;
+        reader.Skip(size);
+
+        records.push_back(record);
+    }
+
+    Utils::printMsg("Loaded " + std::to_string(records.size()) + " records, " +
+                    std::to_string(GetLastTick() + 1) + " ticks", success);
+    return true;
+}
+
+const ReplayTransport::Record* ReplayTransport::NextRecord(CaptureChannel channel)
+{
+    if (nextRecord >= records.size())
+        return nullptr;
+
+    const Record& record = records[nextRecord];
+    if (record.tick > currentTick || record.channel != channel)
+        return nullptr;
+
+    nextRecord++;
+    return &record;
+}
+
+bool ReplayTransport::ReceiveTCP(int& connection, sf::Packet& packet)
+{
+    const Record* record = NextRecord(CaptureChannel::Tcp);
+    if (!record)
+        return false;
+
+    if (record->connection >= 0 && static_cast<std::size_t>(record->connection) >= connectionAddresses.size())
+        connectionAddresses.resize(record->connection + 1, 0);
+    if (record->connection >= 0)
+        connectionAddresses[record->connection] = record->address;
+
+    connection = record->connection;
+    packet.clear();
+    packet.append(data.data() + record->offset, record->size);
+    return true;
+}
+
+bool ReplayTransport::SendTCP(int, sf::Packet& packet)
+{
+    bytesSent += packet.getDataSize();
+    packetsSent++;
+    return true;
+}
+
+std::optional<sf::IpAddress> ReplayTransport::GetRemoteAddress(int connection) const
+{
+    if (connection < 0 || static_cast<std::size_t>(connection) >= connectionAddresses.size())
+        return std::nullopt;
+
+    return sf::IpAddress(connectionAddresses[connection]);
+}
+
+bool ReplayTransport::ReceiveUDP(std::byte* buffer, std::size_t capacity, std::size_t& received,
+                                 std::optional<sf::IpAddress>& address, unsigned short& port)
+{
+    const Record* record = NextRecord(CaptureChannel::Udp);
+    if (!record)
+        return false;
+
+    received = record->size < capacity ? record->size : capacity;
+    std::memcpy(buffer, data.data() + record->offset, received);
+    address = sf::IpAddress(record->address);
+    port = record->port;
+    return true;
+}
+
+void ReplayTransport::SendUDP(const std::byte*, std::size_t size, const sf::IpAddress&, unsigned short)
+{
+    bytesSent += size;
+    packetsSent++;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "server_transport.h"
+
+// Capture file: header [magic "TNKC"][uint16 version][uint16 seed], then one record per
+// inbound message in the order the server processed it:
+// [uint32 tick][uint8 channel][uint32 connection][uint32 address][uint16 port][uint32 size][bytes]
+// TCP records hold the whole sf::Packet, UDP records the whole datagram (bundles included)
+constexpr uint16_t CAPTURE_VERSION = 1;
+
+enum class CaptureChannel : uint8_t { Tcp = 0, Udp = 1 };
+
+// Writes everything the server receives so a match can be replayed later
+class PacketRecorder
+{
+public:
+    PacketRecorder(const std::string& path, uint16_t seed);
+
+    bool IsOpen() const { return file.is_open(); }
+
+    void RecordTCP(uint32_t tick, int connection, const std::optional<sf::IpAddress>& address, const sf::Packet& packet);
+    void RecordUDP(uint32_t tick, const std::optional<sf::IpAddress>& address, unsigned short port,
+                   const std::byte* data, std::size_t size);
+
+private:
+    // Declared before file so it is destroyed after it, closing the file flushes what is still in it
+    std::vector<char> fileBuffer;
+    std::ofstream file;
+
+    void Write(uint32_t tick, CaptureChannel channel, uint32_t connection, const std::optional<sf::IpAddress>& address,
+               uint16_t port, const void* data, std::size_t size);
+};
+
+// In memory transport fed from a capture file. The driver sets the tick and the server
+// receives exactly what it received on that tick, sends are only counted
+class ReplayTransport : public ServerTransport
+{
+public:
+    bool Load(const std::string& path);
+
+    void SetTick(uint32_t tick) { currentTick = tick; }
+    uint32_t GetLastTick() const { return records.empty() ? 0 : records.back().tick; }
+    uint16_t GetSeed() const { return seed; }
+
+    std::size_t GetRecordCount() const { return records.size(); }
+    std::size_t GetBytesSent() const { return bytesSent; }
+    std::size_t GetPacketsSent() const { return packetsSent; }
+
+    bool ReceiveTCP(int& connection, sf::Packet& packet) override;
+    bool SendTCP(int connection, sf::Packet& packet) override;
+    std::optional<sf::IpAddress> GetRemoteAddress(int connection) const override;
+
+    bool ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                    std::optional<sf::IpAddress>& address, unsigned short& port) override;
+    void SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) override;
+
+private:
+    struct Record
+    {
+        uint32_t tick;
+        CaptureChannel channel;
+        int connection;
+        uint32_t address;
+        uint16_t port;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    // Whole file in memory, records point into it
+    std::vector<std::byte> data;
+    std::vector<Record> records;
+    std::size_t nextRecord = 0;
+
+    uint16_t seed = 0;
+    uint32_t currentTick = 0;
+
+    // Address each TCP connection last sent from, for GetRemoteAddress
+    std::vector<uint32_t> connectionAddresses;
+
+    std::size_t bytesSent = 0;
+    std::size_t packetsSent = 0;
+
+    const Record* NextRecord(CaptureChannel channel);
+};
@@ -0,0 +1,48 @@
+#include "pickup_index.h"
+#include <algorithm>
+#include <cmath>
+
+void PickupIndex::Reset(sf::Vector2f worldSize, std::size_t pickupCount)
+{
+    columns = std::max(1, static_cast<int>(std::ceil(worldSize.x / CELL_SIZE)));
+    rows = std::max(1, static_cast<int>(std::ceil(worldSize.y / CELL_SIZE)));
+
+    cellHead.assign(static_cast<std::size_t>(columns) * rows, NONE);
+    next.assign(pickupCount, NONE);
+    cellOf.assign(pickupCount, NONE);
+}
+
+void PickupIndex::Move(int id, sf::Vector2f position)
+{
+    Unlink(id);
+
+    const int cell = RowAt(position.y) * columns + ColumnAt(position.x);
+    next[id] = cellHead[cell];
+    cellHead[cell] = id;
+    cellOf[id] = cell;
+}
+
+int PickupIndex::ColumnAt(float x) const
+{
+    return std::clamp(static_cast<int>(std::floor(x / CELL_SIZE)), 0, columns - 1);
+}
+
+int PickupIndex::RowAt(float y) const
+{
+    return std::clamp(static_cast<int>(std::floor(y / CELL_SIZE)), 0, rows - 1);
+}
+
+void PickupIndex::Unlink(int id)
+{
+    if (cellOf[id] == NONE)
+        return;
+
+    // Cells hold a handful of pickups, walking one is cheaper than keeping back links
+    int* link = &cellHead[cellOf[id]];
+    while (*link != id)
+        link = &next[*link];
+
+    *link = next[id];
+    next[id] = NONE;
+    cellOf[id] = NONE;
+}
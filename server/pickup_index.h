@@ -0,0 +1,57 @@
+#pragma once
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+// Uniform grid of pickup ids over the world. A pickup sits in the cell of its centre and is
+// smaller than a cell, so a tank only looks at the cells it touches plus one ring. The cells
+// are linked lists through the id arrays, moving a pickup never allocates
+class PickupIndex
+{
+public:
+    static constexpr float CELL_SIZE = 64.f;
+
+    // Empty grid for ids [0, pickupCount)
+    void Reset(sf::Vector2f worldSize, std::size_t pickupCount);
+
+    // Puts the pickup in the cell of position, taking it out of its old one first
+    void Move(int id, sf::Vector2f position);
+
+    // Calls function(id) for every pickup that can overlap rect
+    template <typename Function>
+    void ForEachNear(const sf::FloatRect& rect, Function&& function) const;
+
+private:
+    static constexpr int NONE = -1;
+
+    int columns = 0;
+    int rows = 0;
+
+    std::vector<int> cellHead;   // first id of each cell
+    std::vector<int> next;       // next id in the same cell
+    std::vector<int> cellOf;     // cell each id is in
+
+    int ColumnAt(float x) const;
+    int RowAt(float y) const;
+    void Unlink(int id);
+};
+
+template <typename Function>
+void PickupIndex::ForEachNear(const sf::FloatRect& rect, Function&& function) const
+{
+    const int minX = ColumnAt(rect.position.x - CELL_SIZE);
+    const int maxX = ColumnAt(rect.position.x + rect.size.x + CELL_SIZE);
+    const int minY = RowAt(rect.position.y - CELL_SIZE);
+    const int maxY = RowAt(rect.position.y + rect.size.y + CELL_SIZE);
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            for (int id = cellHead[y * columns + x]; id != NONE; id = next[id])
+            {
+                function(id);
+            }
+        }
+    }
+}
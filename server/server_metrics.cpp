@@ -0,0 +1,216 @@
+#include "server_metrics.h"
+#include "../game/utils.h"
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// How long the exporter waits on the listener before checking the file timer again
+static constexpr float EXPORTER_POLL = 0.2f;
+
+MetricHistogram::MetricHistogram(std::initializer_list<double> bounds, double scale)
+    : scale(scale)
+{
+    for (double bound : bounds)
+    {
+        if (bucketCount == MAX_BUCKETS)
+            break;
+        this->bounds[bucketCount++] = bound;
+    }
+}
+
+void MetricHistogram::Observe(double value)
+{
+    std::size_t bucket = 0;
+    while (bucket < bucketCount && value > bounds[bucket])
+        bucket++;
+
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    scaledSum.fetch_add(static_cast<uint64_t>(value * scale), std::memory_order_relaxed);
+}
+
+void MetricHistogram::Render(std::string& out, const char* name, const char* help) const
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    out += line;
+
+    // Prometheus buckets are cumulative, ours are not
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < bucketCount; i++)
+    {
+        cumulative += counts[i].load(std::memory_order_relaxed);
+        std::snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", name, bounds[i],
+                      static_cast<unsigned long long>(cumulative));
+        out += line;
+    }
+
+    cumulative += counts[bucketCount].load(std::memory_order_relaxed);
+    std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %g\n%s_count %llu\n",
+                  name, static_cast<unsigned long long>(cumulative),
+                  name, static_cast<double>(scaledSum.load(std::memory_order_relaxed)) / scale,
+                  name, static_cast<unsigned long long>(cumulative));
+    out += line;
+}
+
+static void RenderValue(std::string& out, const char* name, const char* type, const char* help, long long value)
+{
+    char line[200];
+    std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %lld\n", name, help, name, type, name, value);
+    out += line;
+}
+
+std::string ServerMetrics::RenderPrometheus() const
+{
+    std::string out;
+    out.reserve(4096);
+
+    tickDuration.Render(out, "tank_tick_duration_seconds", "Time spent in one server tick");
+    RenderValue(out, "tank_ticks_total", "counter", "Server ticks run", static_cast<long long>(ticks.Get()));
+    RenderValue(out, "tank_tick_overruns_total", "counter", "Ticks that took longer than the tick interval",
+                static_cast<long long>(tickOverruns.Get()));
+
+    RenderValue(out, "tank_connected_players", "gauge", "Players connected", connectedPlayers.Get());
+    RenderValue(out, "tank_bullets_alive", "gauge", "Bullets in the world", bulletsAlive.Get());
+    RenderValue(out, "tank_active_chunks", "gauge", "World chunks simulated this tick", activeChunks.Get());
+    RenderValue(out, "tank_client_timeouts_total", "counter", "Clients dropped for not sending anything",
+                static_cast<long long>(timeouts.Get()));
+    RenderValue(out, "tank_pickups_collected_total", "counter", "Pickups tanks drove over",
+                static_cast<long long>(pickupsCollected.Get()));
+    RenderValue(out, "tank_flow_fields", "gauge", "Flow fields kept for server bots, one per player chased", flowFields.Get());
+    RenderValue(out, "tank_flow_field_builds_total", "counter", "Flow field searches run",
+                static_cast<long long>(flowFieldBuilds.Get()));
+    RenderValue(out, "tank_tick_arena_high_water_bytes", "gauge", "Most tick arena memory one tick used",
+                tickArenaHighWater.Get());
+
+    snapshotBytes.Render(out, "tank_snapshot_bytes", "Bytes of one snapshot sent to one client");
+    RenderValue(out, "tank_udp_bytes_in_total", "counter", "UDP bytes received", static_cast<long long>(bytesIn.Get()));
+    RenderValue(out, "tank_udp_bytes_out_total", "counter", "UDP bytes sent", static_cast<long long>(bytesOut.Get()));
+
+    out += "# HELP tank_inbound_messages_total Messages received, by type\n# TYPE tank_inbound_messages_total counter\n";
+    char line[128];
+    for (std::size_t i = 0; i <= MESSAGE_TYPES; i++)
+    {
+        const char* type = i < MESSAGE_TYPES ? MessageTypeName(static_cast<MessageTypeProtocole>(i)) : "UNKNOWN";
+        std::snprintf(line, sizeof(line), "tank_inbound_messages_total{type=\"%s\"} %llu\n", type,
+                      static_cast<unsigned long long>(inboundMessages[i].Get()));
+        out += line;
+    }
+
+    return out;
+}
+
+MetricsExporter::MetricsExporter(const ServerMetrics& metrics, unsigned short port, std::string filePath, float fileInterval)
+    : metrics(metrics), filePath(std::move(filePath)), fileInterval(fileInterval)
+{
+    if (port != 0)
+    {
+        // Local only, this is for a scraper on the same box
+        if (listener.listen(port, sf::IpAddress::LocalHost) == sf::Socket::Status::Done)
+        {
+            listening = true;
+            Utils::printMsg("Metrics on http://127.0.0.1:" + std::to_string(port) + "/metrics", info);
+        }
+        else
+        {
+            Utils::printMsg("Failed to listen for metrics on port " + std::to_string(port), error);
+        }
+    }
+
+    if (!this->filePath.empty())
+        Utils::printMsg("Metrics written to " + this->filePath + " every " + std::to_string(fileInterval) + " s", info);
+
+    if (listening || !this->filePath.empty())
+        thread = std::thread(&MetricsExporter::Run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    running.store(false, std::memory_order_relaxed);
+    if (thread.joinable())
+        thread.join();
+}
+
+void MetricsExporter::Run()
+{
+    sf::SocketSelector selector;
+    if (listening)
+        selector.add(listener);
+
+    sf::Clock fileTimer;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (listening)
+        {
+            if (selector.wait(sf::seconds(EXPORTER_POLL)) && selector.isReady(listener))
+                ServeRequest();
+        }
+        else
+        {
+            sf::sleep(sf::seconds(EXPORTER_POLL));
+        }
+
+        if (!filePath.empty() && fileTimer.getElapsedTime().asSeconds() >= fileInterval)
+        {
+            WriteFile();
+            fileTimer.restart();
+        }
+    }
+}
+
+void MetricsExporter::ServeRequest()
+{
+    sf::TcpSocket client;
+    if (listener.accept(client) != sf::Socket::Status::Done)
+        return;
+
+    // We answer every request the same way, only read enough to clear the socket.
+    // A client that never sends gets its answer after a second anyway
+    sf::SocketSelector selector;
+    selector.add(client);
+
+    char request[1024];
+    std::size_t received = 0;
+    if (selector.wait(sf::seconds(1)))
+        client.receive(request, sizeof(request), received);
+
+    const std::string body = metrics.RenderPrometheus();
+    const std::string response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+
+    client.send(response.data(), response.size());
+    client.disconnect();
+}
+
+void MetricsExporter::WriteFile() const
+{
+    // Write next to it and rename so a reader never sees half a file
+    const std::string temporary = filePath + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file.is_open())
+        {
+            Utils::printMsg("Failed to write metrics to " + filePath, error);
+            return;
+        }
+        file << metrics.RenderPrometheus();
+    }
+
+    // std::rename will not replace an existing file on Windows
+#ifdef _WIN32
+    const bool renamed = MoveFileExA(temporary.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool renamed = std::rename(temporary.c_str(), filePath.c_str()) == 0;
+#endif
+
+    if (!renamed)
+        Utils::printMsg("Failed to replace metrics file " + filePath, error);
+}
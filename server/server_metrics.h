@@ -0,0 +1,113 @@
+#pragma once
+#include <SFML/Network.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "../game/protocole_message.h"
+
+// Counters, gauges and histograms the tick updates with relaxed atomics only, an
+// exporter thread reads them and serves Prometheus text (HTTP and/or a file)
+
+class MetricCounter
+{
+public:
+    void Add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge
+{
+public:
+    void Set(int64_t amount) { value.store(amount, std::memory_order_relaxed); }
+    int64_t Get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// Fixed buckets given at construction (upper bounds, ascending), +Inf is implicit.
+// The sum is kept in whole units of 1/scale so it can be an integer atomic
+class MetricHistogram
+{
+public:
+    static constexpr std::size_t MAX_BUCKETS = 12;
+
+    MetricHistogram(std::initializer_list<double> bounds, double scale);
+
+    void Observe(double value);
+
+    void Render(std::string& out, const char* name, const char* help) const;
+
+private:
+    std::array<double, MAX_BUCKETS> bounds = {};
+    std::size_t bucketCount = 0;
+    double scale;
+
+    std::array<std::atomic<uint64_t>, MAX_BUCKETS + 1> counts = {};
+    std::atomic<uint64_t> scaledSum{0};
+};
+
+struct ServerMetrics
+{
+    // Seconds, a tick has 1/60 s
+    MetricHistogram tickDuration{{0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066}, 1e6};
+    MetricCounter tickOverruns;
+    MetricCounter ticks;
+
+    MetricGauge connectedPlayers;
+    MetricGauge bulletsAlive;
+    MetricGauge activeChunks;
+    MetricCounter timeouts;
+    MetricCounter pickupsCollected;
+    MetricGauge flowFields;
+    MetricCounter flowFieldBuilds;
+    MetricGauge tickArenaHighWater;
+
+    // Bytes of one snapshot for one client, every part included
+    MetricHistogram snapshotBytes{{128, 256, 512, 1024, 2048, 4096, 8192, 16384}, 1};
+
+    MetricCounter bytesIn;
+    MetricCounter bytesOut;
+
+    // Indexed by MessageTypeProtocole, the last one counts unknown types
+    static constexpr std::size_t MESSAGE_TYPES = static_cast<std::size_t>(MessageTypeProtocole::BUNDLE) + 1;
+    std::array<MetricCounter, MESSAGE_TYPES + 1> inboundMessages;
+
+    void CountInbound(uint8_t type) { inboundMessages[type < MESSAGE_TYPES ? type : MESSAGE_TYPES].Add(); }
+
+    std::string RenderPrometheus() const;
+};
+
+// Background thread that serves /metrics on a local port and/or rewrites a file every few
+// seconds. Port 0 and an empty path turn the matching output off
+class MetricsExporter
+{
+public:
+    MetricsExporter(const ServerMetrics& metrics, unsigned short port, std::string filePath, float fileInterval);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+private:
+    const ServerMetrics& metrics;
+
+    sf::TcpListener listener;
+    bool listening = false;
+
+    std::string filePath;
+    float fileInterval;
+
+    std::atomic<bool> running{true};
+    std::thread thread;
+
+    void Run();
+    void ServeRequest();
+    void WriteFile() const;
+};
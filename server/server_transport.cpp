@@ -0,0 +1,121 @@
+#include "server_transport.h"
+#include "../game/utils.h"
+
+SocketTransport::SocketTransport(unsigned short port)
+{
+    if (socketUDP.bind(port) != sf::Socket::Status::Done) {
+        Utils::printMsg("Failed to bind server to port " + std::to_string(port), error);
+        throw std::runtime_error("Server bind failed");
+    }
+
+    socketUDP.setBlocking(false);
+    if (listenerTCP.listen(port) != sf::Socket::Status::Done)
+    {
+        Utils::printMsg("Failed to listen tcp on port " + std::to_string(port), error);
+    } else
+    {
+        Utils::printMsg("Server listening on port " + std::to_string(port), debug);
+    }
+
+    listenerTCP.setBlocking(false);
+    selectorTCP.add(listenerTCP);
+}
+
+bool SocketTransport::ReceiveTCP(int& connection, sf::Packet& packet)
+{
+    // Same as before the transport existed: one selector wait per round, then either
+    // accept a client or read every client that is ready
+    if (!pollingTCP)
+    {
+        if (!selectorTCP.wait(sf::milliseconds(10)))
+            return false;
+
+        if (selectorTCP.isReady(listenerTCP))
+        {
+            auto client = std::make_unique<sf::TcpSocket>();
+            if (listenerTCP.accept(*client) == sf::Socket::Status::Done)
+            {
+                client->setBlocking(false);
+                selectorTCP.add(*client);
+                clientsTCP.push_back(std::move(client));
+                Utils::printMsg("New TCP client connected", success);
+            }
+            return false;
+        }
+
+        pollingTCP = true;
+        nextReadyTCP = 0;
+    }
+
+    while (nextReadyTCP < clientsTCP.size())
+    {
+        const std::size_t index = nextReadyTCP++;
+        sf::TcpSocket& client = *clientsTCP[index];
+
+        if (selectorTCP.isReady(client) && client.receive(packet) == sf::Socket::Status::Done)
+        {
+            connection = static_cast<int>(index);
+            return true;
+        }
+    }
+
+    pollingTCP = false;
+    return false;
+}
+
+bool SocketTransport::SendTCP(int connection, sf::Packet& packet)
+{
+    if (connection < 0 || static_cast<std::size_t>(connection) >= clientsTCP.size())
+        return false;
+
+    // A message that broke its schema while encoding, see schema::MarkInvalid
+    if (!packet)
+        return false;
+
+    return clientsTCP[connection]->send(packet) == sf::Socket::Status::Done;
+}
+
+std::optional<sf::IpAddress> SocketTransport::GetRemoteAddress(int connection) const
+{
+    if (connection < 0 || static_cast<std::size_t>(connection) >= clientsTCP.size())
+        return std::nullopt;
+
+    return clientsTCP[connection]->getRemoteAddress();
+}
+
+bool SocketTransport::ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                                 std::optional<sf::IpAddress>& address, unsigned short& port)
+{
+    return socketUDP.receive(data, capacity, received, address, port) == sf::Socket::Status::Done;
+}
+
+void SocketTransport::SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port)
+{
+    socketUDP.send(data, size, address, port);
+}
+
+EmulatedTransport::EmulatedTransport(std::unique_ptr<ServerTransport> inner, const NetworkConditions& conditions)
+    : inner(std::move(inner)), emulator(conditions)
+{
+}
+
+bool EmulatedTransport::ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                                   std::optional<sf::IpAddress>& address, unsigned short& port)
+{
+    // Called every tick, a good place to let delayed datagrams out even when nothing new is sent
+    ReleaseDue();
+    return inner->ReceiveUDP(data, capacity, received, address, port);
+}
+
+void EmulatedTransport::SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port)
+{
+    emulator.Queue(data, size, address, port);
+    ReleaseDue();
+}
+
+void EmulatedTransport::ReleaseDue()
+{
+    emulator.Release([this](const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) {
+        inner->SendUDP(data, size, address, port);
+    });
+}
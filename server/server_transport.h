@@ -0,0 +1,71 @@
+#pragma once
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "../game/network_emulator.h"
+
+// Everything the server reads from or writes to the network goes through here, so the
+// same game_server can run on real sockets or on a recorded capture (see packet_capture.h)
+class ServerTransport
+{
+public:
+    virtual ~ServerTransport() = default;
+
+    // Next packet from any TCP client. connection stays the same for a client while it is connected
+    virtual bool ReceiveTCP(int& connection, sf::Packet& packet) = 0;
+    virtual bool SendTCP(int connection, sf::Packet& packet) = 0;
+    virtual std::optional<sf::IpAddress> GetRemoteAddress(int connection) const = 0;
+
+    virtual bool ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                            std::optional<sf::IpAddress>& address, unsigned short& port) = 0;
+    virtual void SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) = 0;
+};
+
+// The live one, TCP listener + selector and the UDP socket
+class SocketTransport : public ServerTransport
+{
+public:
+    explicit SocketTransport(unsigned short port);
+
+    bool ReceiveTCP(int& connection, sf::Packet& packet) override;
+    bool SendTCP(int connection, sf::Packet& packet) override;
+    std::optional<sf::IpAddress> GetRemoteAddress(int connection) const override;
+
+    bool ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                    std::optional<sf::IpAddress>& address, unsigned short& port) override;
+    void SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) override;
+
+private:
+    sf::TcpListener listenerTCP;
+    sf::SocketSelector selectorTCP;
+    std::vector<std::unique_ptr<sf::TcpSocket>> clientsTCP;
+
+    sf::UdpSocket socketUDP;
+
+    // Clients the selector marked ready and we still have to read, one wait per round
+    bool pollingTCP = false;
+    std::size_t nextReadyTCP = 0;
+};
+
+// Wraps another transport and passes outgoing UDP through a NetworkEmulator, TCP is untouched
+class EmulatedTransport : public ServerTransport
+{
+public:
+    EmulatedTransport(std::unique_ptr<ServerTransport> inner, const NetworkConditions& conditions);
+
+    bool ReceiveTCP(int& connection, sf::Packet& packet) override { return inner->ReceiveTCP(connection, packet); }
+    bool SendTCP(int connection, sf::Packet& packet) override { return inner->SendTCP(connection, packet); }
+    std::optional<sf::IpAddress> GetRemoteAddress(int connection) const override { return inner->GetRemoteAddress(connection); }
+
+    bool ReceiveUDP(std::byte* data, std::size_t capacity, std::size_t& received,
+                    std::optional<sf::IpAddress>& address, unsigned short& port) override;
+    void SendUDP(const std::byte* data, std::size_t size, const sf::IpAddress& address, unsigned short port) override;
+
+private:
+    std::unique_ptr<ServerTransport> inner;
+    NetworkEmulator emulator;
+
+    void ReleaseDue();
+};
@@ -0,0 +1,41 @@
+#include "tick_arena.h"
+#include <algorithm>
+
+TickArena::TickArena(std::size_t capacity)
+    : block(std::make_unique<std::byte[]>(capacity)), capacity(capacity)
+{
+}
+
+void* TickArena::Allocate(std::size_t size, std::size_t alignment)
+{
+    const std::size_t start = (used + alignment - 1) & ~(alignment - 1);
+
+    if (overflow.empty() && start + size <= capacity)
+    {
+        used = start + size;
+        highWater = std::max(highWater, used);
+        return block.get() + start;
+    }
+
+    // Out of block, counted as if the block went on so the high water is what a tick needs
+    overflow.push_back(std::make_unique<std::byte[]>(size + alignment));
+    overflowBytes += size + alignment;
+    highWater = std::max(highWater, used + overflowBytes);
+
+    const auto address = reinterpret_cast<std::uintptr_t>(overflow.back().get());
+    return overflow.back().get() + ((alignment - address % alignment) % alignment);
+}
+
+void TickArena::Reset()
+{
+    if (!overflow.empty())
+    {
+        overflow.clear();
+        overflowBytes = 0;
+
+        capacity = std::max(capacity * 2, highWater);
+        block = std::make_unique<std::byte[]>(capacity);
+    }
+
+    used = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for whatever only lives for one tick (scratch lists, snapshot parts...).
+// Allocating moves a pointer and freeing does nothing, Reset at the end of the tick gives it
+// all back at once. A tick that needs more than the block still gets its memory from the heap,
+// and the next Reset grows the block to that peak so it happens once per new peak only
+class TickArena
+{
+public:
+    explicit TickArena(std::size_t capacity);
+
+    void* Allocate(std::size_t size, std::size_t alignment);
+
+    // Nothing handed out since the last Reset may be used after it
+    void Reset();
+
+    std::size_t GetCapacity() const { return capacity; }
+    std::size_t GetHighWater() const { return highWater; }
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    std::size_t capacity;
+    std::size_t used = 0;
+    std::size_t highWater = 0;
+
+    // Past the block, freed on Reset
+    std::vector<std::unique_ptr<std::byte[]>> overflow;
+    std::size_t overflowBytes = 0;
+};
+
+// Standard allocator on top of a TickArena, for containers that die before the arena resets
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(TickArena& arena) : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t count) { return static_cast<T*>(arena->Allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    TickArena* arena;
+};
+
+// Reserve up front, a vector that grows leaves its old storage in the arena until the reset
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
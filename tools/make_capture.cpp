@@ -0,0 +1,136 @@
+// tank_make_capture: writes a scripted match as a capture file, the input tank_game replays
+// for its checks (tank_game --replay <capture> --alloc-check)
+//
+//   tank_make_capture <output.cap>
+//
+// Two players join during the allocation warm-up, then drive laps over the whole default
+// world, shoot twice a second and die once each. The script never reads what the server
+// sends back, so the same file comes out on every machine. Everything after the warm-up is
+// what a normal match does over and over: moves, shots, pickups, deaths, respawns and the
+// link stats that are logged every 10 seconds
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "../game/link_stats.h"
+#include "../game/message_stream.h"
+#include "../game/protocole_message.h"
+#include "../game/reliable_channel.h"
+#include "../game/utils.h"
+#include "../game/world_chunks.h"
+#include "../server/packet_capture.h"
+
+static constexpr float PI = 3.14159265f;
+
+// Same tick rate as the server, a tank update from every player on every tick like client_main
+static constexpr uint32_t TICK_RATE = 60;
+
+// 25 seconds, the link stats are logged twice after the 300 tick warm-up
+static constexpr uint32_t MATCH_TICKS = 1500;
+
+// Seed of the obstacles, written in the capture header
+static constexpr uint16_t WORLD_SEED = 1234;
+
+// Ticks a lap of the world takes
+static constexpr float LAP_TICKS = 600.f;
+
+struct ScriptedPlayer
+{
+    const char* name;
+    int connection;          // TCP connection id, also the player id the server hands out
+    unsigned short udpPort;
+    uint32_t joinTick;
+    uint32_t deathTick;      // says it is dead for a second from here, the server respawns it after two
+    float phase;             // where on the lap it starts
+    uint16_t pingSequence = 0;
+};
+
+static void WriteJoin(PacketRecorder& recorder, uint32_t tick, const ScriptedPlayer& player, const sf::IpAddress& address)
+{
+    JoinRequestMessage joinMsg;
+    joinMsg.playerName = player.name;
+    joinMsg.udpPort = player.udpPort;
+
+    sf::Packet packet;
+    WriteMessage(packet, joinMsg);
+    recorder.RecordTCP(tick, player.connection, address, packet);
+}
+
+static void WriteTankUpdate(PacketRecorder& recorder, uint32_t tick, ScriptedPlayer& player, const sf::IpAddress& address)
+{
+    const sf::Vector2f worldSize = ChunkLayout().GetWorldSize();
+    const sf::Vector2f center = worldSize / 2.f;
+
+    // Figure of eight over most of the world, so the tanks cross chunks and pickups
+    const float angle = 2.f * PI * static_cast<float>(tick) / LAP_TICKS + player.phase;
+    const float radiusX = center.x - 80.f;
+    const float radiusY = center.y - 80.f;
+
+    TankMessage msg;
+    msg.playerId = static_cast<uint8_t>(player.connection);
+    msg.x = center.x + std::cos(angle) * radiusX;
+    msg.y = center.y + std::sin(2.f * angle) * radiusY;
+
+    // Body forward is rotation - 90 like Tank, so point it along the path
+    const float dx = -std::sin(angle) * radiusX;
+    const float dy = 2.f * std::cos(2.f * angle) * radiusY;
+    msg.rotationBody = std::atan2(dy, dx) * 180.f / PI + 90.f;
+    msg.rotationBarrel = std::fmod(static_cast<float>(tick) * 3.f, 360.f);
+
+    // One update with the button down is one shot, half a second apart and the players out of step
+    msg.shootPressed = tick % (TICK_RATE / 2) == static_cast<uint32_t>(player.connection) * (TICK_RATE / 4);
+    msg.isAlive = tick < player.deathTick || tick >= player.deathTick + TICK_RATE;
+
+    // Nothing is read back, so the ack claims half the sequence space: every reliable message
+    // of the server counts as delivered once sent, and nothing piles up in its queues
+    AckHeader ack;
+    ack.ack = 0x7FFF;
+
+    PingHeader ping;
+    ping.sequence = player.pingSequence++;
+    ping.time = tick * 1000 / TICK_RATE;
+
+    MessageWriter writer(GetSendBuffer());
+    writer << static_cast<uint8_t>(TankMessage::ID) << ack << ping << msg;
+    recorder.RecordUDP(tick, address, player.udpPort, writer.GetData(), writer.GetSize());
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        Utils::printMsg("Usage: tank_make_capture <output.cap>", error);
+        Logger::Flush();
+        return 1;
+    }
+
+    PacketRecorder recorder(argv[1], WORLD_SEED);
+    if (!recorder.IsOpen())
+    {
+        Logger::Flush();
+        return 1;
+    }
+
+    const sf::IpAddress address = sf::IpAddress::LocalHost;
+
+    // Joined in this order the server gives them ids 0 and 1, the same as their connections
+    ScriptedPlayer players[] = {
+        {"scripted_0", 0, 50000, 10, 700, 0.f},
+        {"scripted_1", 1, 50001, 20, 1100, PI},
+    };
+
+    for (uint32_t tick = 0; tick < MATCH_TICKS; tick++)
+    {
+        for (ScriptedPlayer& player : players)
+        {
+            if (tick == player.joinTick)
+                WriteJoin(recorder, tick, player, address);
+            else if (tick > player.joinTick)
+                WriteTankUpdate(recorder, tick, player, address);
+        }
+    }
+
+    Utils::printMsg(std::string(argv[1]) + ": " + std::to_string(MATCH_TICKS) + " ticks, 2 players", success);
+    Logger::Flush();
+    return 0;
+}
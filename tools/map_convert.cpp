@@ -0,0 +1,335 @@
+// tank_map_convert: turns a text map into the binary .tmap the game maps from disk
+//
+//   tank_map_convert <source.txt> <output.tmap>
+//
+// Source format, one statement per line, # starts a comment:
+//
+//   size <chunk columns> <chunk rows>     320 px chunks, 10 x 10 tiles of 32 px each
+//   layer                                 tile rows follow until "end", one character per
+//   ....ss..o...                          tile: . none, s sand, - horizontal fence,
+//   end                                   | vertical fence, o rock. Short rows are padded
+//   collider <x> <y> <width> <height>     extra invisible wall, in pixels
+//   spawn <x> <y>
+//   ammo <x> <y>
+//   health <x> <y>
+//
+// Fences and rocks are solid, every run of them on a row becomes a collider. Colliders are
+// cut at chunk borders, the game keeps them by chunk and none may be bigger than one
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../game/map_format.h"
+#include "../game/utils.h"
+
+static constexpr float CHUNK_PIXELS = MAP_TILE_SIZE * MAP_TILES_PER_CHUNK;
+
+// Sizes above this are almost certainly a typo, and the header keeps them in 16 bits
+static constexpr int MAX_CHUNKS = 256;
+
+struct MapSource
+{
+    int chunkColumns = 0;
+    int chunkRows = 0;
+    std::vector<std::vector<uint8_t>> layers;
+    std::vector<MapRect> colliders;
+    std::vector<MapPoint> spawns;
+    std::vector<MapPickupSite> pickups;
+};
+
+static bool TileFromChar(char c, MapTile& tile)
+{
+    switch (c)
+    {
+        case '.': case ' ': tile = MapTile::None; return true;
+        case 's': tile = MapTile::Sand; return true;
+        case '-': tile = MapTile::HorizontalFence; return true;
+        case '|': tile = MapTile::VerticalFence; return true;
+        case 'o': tile = MapTile::Rock; return true;
+        default: return false;
+    }
+}
+
+static bool IsSolid(MapTile tile)
+{
+    return tile == MapTile::HorizontalFence || tile == MapTile::VerticalFence || tile == MapTile::Rock;
+}
+
+static bool Fail(const std::string& source, int line, const std::string& reason)
+{
+    Utils::printMsg(source + ":" + std::to_string(line) + ": " + reason, error);
+    return false;
+}
+
+static bool ReadSource(const std::string& path, MapSource& map)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        Utils::printMsg("Could not open " + path, error);
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    int layerRow = -1;   // row being read, -1 when not inside a layer
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (layerRow >= 0)
+        {
+            if (line == "end")
+            {
+                layerRow = -1;
+                continue;
+            }
+
+            const int columns = map.chunkColumns * MAP_TILES_PER_CHUNK;
+            if (layerRow >= map.chunkRows * MAP_TILES_PER_CHUNK)
+                return Fail(path, lineNumber, "more rows than the map has");
+            if (static_cast<int>(line.size()) > columns)
+                return Fail(path, lineNumber, "row longer than the map");
+
+            for (std::size_t x = 0; x < line.size(); x++)
+            {
+                MapTile tile;
+                if (!TileFromChar(line[x], tile))
+                    return Fail(path, lineNumber, std::string("unknown tile '") + line[x] + "'");
+
+                map.layers.back()[static_cast<std::size_t>(layerRow) * columns + x] = static_cast<uint8_t>(tile);
+            }
+            layerRow++;
+            continue;
+        }
+
+        const std::string code = line.substr(0, line.find('#'));
+        std::istringstream words(code);
+        std::string keyword;
+        if (!(words >> keyword))
+            continue;
+
+        if (keyword == "size")
+        {
+            if (!(words >> map.chunkColumns >> map.chunkRows) || map.chunkColumns < 1 || map.chunkRows < 1 ||
+                map.chunkColumns > MAX_CHUNKS || map.chunkRows > MAX_CHUNKS)
+                return Fail(path, lineNumber, "size wants two chunk counts from 1 to " + std::to_string(MAX_CHUNKS));
+            if (!map.layers.empty())
+                return Fail(path, lineNumber, "size must come before the layers");
+            continue;
+        }
+
+        if (map.chunkColumns == 0)
+            return Fail(path, lineNumber, "size must come first");
+
+        if (keyword == "layer")
+        {
+            const std::size_t tiles = static_cast<std::size_t>(map.chunkColumns) * map.chunkRows *
+                                      MAP_TILES_PER_CHUNK * MAP_TILES_PER_CHUNK;
+            map.layers.emplace_back(tiles, static_cast<uint8_t>(MapTile::None));
+            layerRow = 0;
+        }
+        else if (keyword == "collider")
+        {
+            MapRect rect;
+            if (!(words >> rect.x >> rect.y >> rect.width >> rect.height) || rect.width <= 0.f || rect.height <= 0.f)
+                return Fail(path, lineNumber, "collider wants x y width height");
+            map.colliders.push_back(rect);
+        }
+        else if (keyword == "spawn")
+        {
+            MapPoint point;
+            if (!(words >> point.x >> point.y))
+                return Fail(path, lineNumber, "spawn wants x y");
+            map.spawns.push_back(point);
+        }
+        else if (keyword == "ammo" || keyword == "health")
+        {
+            MapPickupSite site = {};
+            site.type = keyword == "health" ? 1 : 0;
+            if (!(words >> site.x >> site.y))
+                return Fail(path, lineNumber, keyword + " wants x y");
+            map.pickups.push_back(site);
+        }
+        else
+        {
+            return Fail(path, lineNumber, "unknown statement '" + keyword + "'");
+        }
+    }
+
+    if (layerRow >= 0)
+        return Fail(path, lineNumber, "layer without end");
+    if (map.chunkColumns == 0)
+        return Fail(path, lineNumber, "no size");
+
+    return true;
+}
+
+// Runs of solid tiles on each row, stopping at chunk borders
+static void AddTileColliders(MapSource& map)
+{
+    const int columns = map.chunkColumns * MAP_TILES_PER_CHUNK;
+    const int rows = map.chunkRows * MAP_TILES_PER_CHUNK;
+
+    for (const auto& layer : map.layers)
+    {
+        for (int y = 0; y < rows; y++)
+        {
+            int x = 0;
+            while (x < columns)
+            {
+                if (!IsSolid(static_cast<MapTile>(layer[static_cast<std::size_t>(y) * columns + x])))
+                {
+                    x++;
+                    continue;
+                }
+
+                const int start = x;
+                const int chunkEnd = (x / MAP_TILES_PER_CHUNK + 1) * MAP_TILES_PER_CHUNK;
+                while (x < chunkEnd && IsSolid(static_cast<MapTile>(layer[static_cast<std::size_t>(y) * columns + x])))
+                    x++;
+
+                map.colliders.push_back({start * MAP_TILE_SIZE, y * MAP_TILE_SIZE, (x - start) * MAP_TILE_SIZE, MAP_TILE_SIZE});
+            }
+        }
+    }
+}
+
+// Cut every collider at chunk borders and clip it to the world
+static std::vector<MapRect> SplitByChunk(const MapSource& map)
+{
+    const float worldWidth = map.chunkColumns * CHUNK_PIXELS;
+    const float worldHeight = map.chunkRows * CHUNK_PIXELS;
+
+    std::vector<MapRect> pieces;
+    for (const MapRect& rect : map.colliders)
+    {
+        const float left = std::max(0.f, rect.x);
+        const float top = std::max(0.f, rect.y);
+        const float right = std::min(worldWidth, rect.x + rect.width);
+        const float bottom = std::min(worldHeight, rect.y + rect.height);
+
+        for (float y = top; y < bottom;)
+        {
+            const float nextY = std::min(bottom, (std::floor(y / CHUNK_PIXELS) + 1.f) * CHUNK_PIXELS);
+            for (float x = left; x < right;)
+            {
+                const float nextX = std::min(right, (std::floor(x / CHUNK_PIXELS) + 1.f) * CHUNK_PIXELS);
+                pieces.push_back({x, y, nextX - x, nextY - y});
+                x = nextX;
+            }
+            y = nextY;
+        }
+    }
+    return pieces;
+}
+
+static uint32_t Align(std::size_t offset)
+{
+    return static_cast<uint32_t>((offset + 3) / 4 * 4);
+}
+
+template <typename T>
+static void Append(std::vector<std::byte>& out, uint32_t offset, const T* data, std::size_t count)
+{
+    out.resize(offset + sizeof(T) * count);
+    if (count > 0)
+        std::memcpy(out.data() + offset, data, sizeof(T) * count);
+}
+
+static std::vector<std::byte> Build(const MapSource& map)
+{
+    const int chunkCount = map.chunkColumns * map.chunkRows;
+
+    // Group the colliders by the chunk their centre is in, the same rule as CollisionManager
+    std::vector<MapRect> pieces = SplitByChunk(map);
+    auto chunkOf = [&map](const MapRect& rect) {
+        const int x = std::clamp(static_cast<int>((rect.x + rect.width / 2.f) / CHUNK_PIXELS), 0, map.chunkColumns - 1);
+        const int y = std::clamp(static_cast<int>((rect.y + rect.height / 2.f) / CHUNK_PIXELS), 0, map.chunkRows - 1);
+        return y * map.chunkColumns + x;
+    };
+    std::stable_sort(pieces.begin(), pieces.end(), [&chunkOf](const MapRect& a, const MapRect& b) {
+        return chunkOf(a) < chunkOf(b);
+    });
+
+    std::vector<uint32_t> chunkIndex(static_cast<std::size_t>(chunkCount) + 1, 0);
+    for (const MapRect& piece : pieces)
+        chunkIndex[chunkOf(piece) + 1]++;
+    for (int i = 0; i < chunkCount; i++)
+        chunkIndex[i + 1] += chunkIndex[i];
+
+    MapHeader header = {};
+    std::memcpy(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+    header.byteOrder = MAP_BYTE_ORDER;
+    header.version = MAP_VERSION;
+    header.chunkColumns = static_cast<uint16_t>(map.chunkColumns);
+    header.chunkRows = static_cast<uint16_t>(map.chunkRows);
+    header.layerCount = static_cast<uint16_t>(map.layers.size());
+
+    std::vector<std::byte> out(sizeof(MapHeader));
+
+    header.layers = {Align(out.size()), static_cast<uint32_t>(map.layers.size())};
+    uint32_t offset = header.layers.offset;
+    for (const auto& layer : map.layers)
+    {
+        Append(out, offset, layer.data(), layer.size());
+        offset = static_cast<uint32_t>(out.size());
+    }
+
+    header.chunkColliders = {Align(out.size()), static_cast<uint32_t>(chunkIndex.size())};
+    Append(out, header.chunkColliders.offset, chunkIndex.data(), chunkIndex.size());
+
+    header.colliders = {Align(out.size()), static_cast<uint32_t>(pieces.size())};
+    Append(out, header.colliders.offset, pieces.data(), pieces.size());
+
+    header.spawns = {Align(out.size()), static_cast<uint32_t>(map.spawns.size())};
+    Append(out, header.spawns.offset, map.spawns.data(), map.spawns.size());
+
+    header.pickups = {Align(out.size()), static_cast<uint32_t>(map.pickups.size())};
+    Append(out, header.pickups.offset, map.pickups.data(), map.pickups.size());
+
+    header.checksum = MapChecksum(out.data() + sizeof(MapHeader), out.size() - sizeof(MapHeader));
+    std::memcpy(out.data(), &header, sizeof(MapHeader));
+    return out;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        Utils::printMsg("Usage: tank_map_convert <source.txt> <output.tmap>", error);
+        Logger::Flush();
+        return 1;
+    }
+
+    MapSource map;
+    if (!ReadSource(argv[1], map))
+    {
+        Logger::Flush();
+        return 1;
+    }
+
+    AddTileColliders(map);
+    const std::vector<std::byte> data = Build(map);
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    if (!out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())))
+    {
+        Utils::printMsg(std::string("Could not write ") + argv[2], error);
+        Logger::Flush();
+        return 1;
+    }
+
+    Utils::printMsg(std::string(argv[2]) + ": " + std::to_string(map.chunkColumns) + " x " + std::to_string(map.chunkRows) +
+                    " chunks, " + std::to_string(map.layers.size()) + " layers, " + std::to_string(map.spawns.size()) +
+                    " spawns, " + std::to_string(map.pickups.size()) + " pickup sites, " + std::to_string(data.size()) + " bytes", success);
+    Logger::Flush();
+    return 0;
+}